@@ -0,0 +1,449 @@
+import Foundation
+
+// CPU model of the AO rays in the render process. Traces the rays of one tile
+// in two orders, and measures how coherent each order is:
+// - pixel order: the GPU today, where a SIMD covers 8x4 pixels and each lane
+//   traces the i-th AO ray of its pixel in lockstep
+// - binned order: all rays of the tile generated up front, then sorted by
+//   direction octant and origin cell, traced in batches of 32 and scattered
+//   back to their pixels
+//
+// Coherence is reported per batch of 32 rays, as if each batch were one SIMD:
+// - lane utilization: (DDA steps of all rays) / (32 * longest ray)
+// - distinct 0.25 nm cells read by the batch, a proxy for cache lines
+//
+// The traversal mirrors 'intersectAO', walking 0.25 nm cells until the ray
+// has traveled past the AO cutoff. Both orders must produce the same hits.
+
+// MARK: - User-Facing Options
+
+let tileSize: Int = 64
+let sampleCount: Int = 15
+let batchSize: Int = 32
+let trialCount: Int = 5
+
+// The scene is a rough slab of carbon-like atoms, viewed from above at an
+// angle. Pits in the surface create the occluded regions AO resolves.
+let slabSize: Double = 8
+let slabDepth: Double = 1.5
+let atomRadius: Double = 0.1426
+let pitCount: Int = 24
+
+// MARK: - Scene
+
+struct SplitMix64: RandomNumberGenerator {
+  var state: UInt64
+  
+  mutating func next() -> UInt64 {
+    state &+= 0x9E37_79B9_7F4A_7C15
+    var z = state
+    z = (z ^ (z >> 30)) &* 0xBF58_476D_1CE4_E5B9
+    z = (z ^ (z >> 27)) &* 0x94D0_49BB_1331_11EB
+    return z ^ (z >> 31)
+  }
+}
+
+func createAtoms(generator: inout SplitMix64) -> [SIMD3<Double>] {
+  var pits: [SIMD3<Double>] = []
+  for _ in 0..<pitCount {
+    let x = Double.random(in: -slabSize / 2..<slabSize / 2, using: &generator)
+    let y = Double.random(in: -slabSize / 2..<slabSize / 2, using: &generator)
+    pits.append(SIMD3(x, y, 0))
+  }
+  
+  // Jittered cubic lattice with 0.25 nm spacing.
+  let spacing: Double = 0.25
+  let lateralCount = Int(slabSize / spacing)
+  let verticalCount = Int(slabDepth / spacing)
+  var output: [SIMD3<Double>] = []
+  for z in 0..<verticalCount {
+    for y in 0..<lateralCount {
+      for x in 0..<lateralCount {
+        var position = SIMD3(Double(x), Double(y), -Double(z)) * spacing
+        position.x -= slabSize / 2
+        position.y -= slabSize / 2
+        position += SIMD3<Double>.random(in: -0.03..<0.03, using: &generator)
+        
+        // Carve a 0.6 nm hemisphere around each pit.
+        let isCarved = pits.contains { pit in
+          let delta = position - pit
+          return (delta * delta).sum() < 0.6 * 0.6
+        }
+        if !isCarved {
+          output.append(position)
+        }
+      }
+    }
+  }
+  return output
+}
+
+// MARK: - Small Cell Grid
+
+struct SmallCellGrid {
+  var atoms: [SIMD3<Double>]
+  var cells: [SIMD3<Int32>: [UInt32]] = [:]
+  
+  init(atoms: [SIMD3<Double>]) {
+    self.atoms = atoms
+    for atomID in atoms.indices {
+      let atom = atoms[atomID]
+      let lowerCorner = Self.cellCoords(atom - atomRadius)
+      let upperCorner = Self.cellCoords(atom + atomRadius)
+      for z in lowerCorner.z...upperCorner.z {
+        for y in lowerCorner.y...upperCorner.y {
+          for x in lowerCorner.x...upperCorner.x {
+            cells[SIMD3(x, y, z), default: []].append(UInt32(atomID))
+          }
+        }
+      }
+    }
+  }
+  
+  static func cellCoords(_ position: SIMD3<Double>) -> SIMD3<Int32> {
+    SIMD3<Int32>((position / 0.25).rounded(.down))
+  }
+  
+  func intersectAtom(
+    _ atomID: UInt32,
+    origin: SIMD3<Double>,
+    direction: SIMD3<Double>
+  ) -> Double? {
+    let oc = origin - atoms[Int(atomID)]
+    let b = (oc * direction).sum()
+    let c = (oc * oc).sum() - atomRadius * atomRadius
+    let discriminant = b * b - c
+    guard discriminant >= 0 else {
+      return nil
+    }
+    let t = -b - discriminant.squareRoot()
+    return (t > 0) ? t : nil
+  }
+  
+  // Returns the hit atom, and records every non-empty cell that was read.
+  func intersect(
+    origin: SIMD3<Double>,
+    direction: SIMD3<Double>,
+    maximumDistance: Double,
+    visitedCells: inout Set<SIMD3<Int32>>
+  ) -> (stepCount: Int, atomID: UInt32?) {
+    var t: Double = .zero
+    var stepCount: Int = .zero
+    
+    while t < maximumDistance {
+      let position = origin + (t + 1e-9) * direction
+      let cellCoords = Self.cellCoords(position)
+      stepCount += 1
+      
+      // Time at which the ray leaves the current cell.
+      var nextTime = Double.greatestFiniteMagnitude
+      for dim in 0..<3 where direction[dim] != 0 {
+        var border = Double(cellCoords[dim])
+        if direction[dim] > 0 {
+          border += 1
+        }
+        border *= 0.25
+        nextTime = min(nextTime, (border - origin[dim]) / direction[dim])
+      }
+      
+      if let cellAtoms = cells[cellCoords] {
+        visitedCells.insert(cellCoords)
+        var closestHit: (Double, UInt32)?
+        for atomID in cellAtoms {
+          guard let hitTime = intersectAtom(
+            atomID, origin: origin, direction: direction) else {
+            continue
+          }
+          if hitTime < (closestHit?.0 ?? nextTime) {
+            closestHit = (hitTime, atomID)
+          }
+        }
+        if let closestHit, closestHit.0 < maximumDistance {
+          return (stepCount, closestHit.1)
+        }
+      }
+      t = nextTime
+    }
+    return (stepCount, nil)
+  }
+}
+
+// MARK: - Ray Generation
+
+struct PrimaryHit {
+  var pixelID: Int
+  var point: SIMD3<Double>
+  var normal: SIMD3<Double>
+}
+
+struct AORay {
+  var pixelID: Int
+  var sampleID: Int
+  var origin: SIMD3<Double>
+  var direction: SIMD3<Double>
+}
+
+func normalize(_ vector: SIMD3<Double>) -> SIMD3<Double> {
+  vector / (vector * vector).sum().squareRoot()
+}
+
+func cross(_ lhs: SIMD3<Double>, _ rhs: SIMD3<Double>) -> SIMD3<Double> {
+  let x = lhs.y * rhs.z - lhs.z * rhs.y
+  let y = lhs.z * rhs.x - lhs.x * rhs.z
+  let z = lhs.x * rhs.y - lhs.y * rhs.x
+  return SIMD3(x, y, z)
+}
+
+// Camera 6 nm above the slab, tilted 30° from the vertical.
+func createPrimaryHits(grid: SmallCellGrid) -> [PrimaryHit] {
+  let origin = SIMD3<Double>(0, -3, 6)
+  let forward = normalize(SIMD3(0, 0.5, -1))
+  let right = SIMD3<Double>(1, 0, 0)
+  let up = cross(right, forward)
+  
+  var output: [PrimaryHit] = []
+  var visitedCells: Set<SIMD3<Int32>> = []
+  for y in 0..<tileSize {
+    for x in 0..<tileSize {
+      var screenCoords = SIMD2(Double(x), Double(y)) + 0.5
+      screenCoords /= Double(tileSize)
+      screenCoords = screenCoords * 2 - 1
+      screenCoords *= 0.4
+      let direction = normalize(
+        forward + screenCoords.x * right - screenCoords.y * up)
+      
+      let (_, atomID) = grid.intersect(
+        origin: origin,
+        direction: direction,
+        maximumDistance: 20,
+        visitedCells: &visitedCells)
+      guard let atomID else {
+        continue
+      }
+      let atom = grid.atoms[Int(atomID)]
+      let hitTime = grid.intersectAtom(
+        atomID, origin: origin, direction: direction)!
+      let point = origin + hitTime * direction
+      output.append(PrimaryHit(
+        pixelID: y * tileSize + x,
+        point: point,
+        normal: normalize(point - atom)))
+    }
+  }
+  return output
+}
+
+// Same sequence as 'GenerationContext.secondaryRayDirection', with the
+// stratified 'random1' and an 8-bit seed per pixel.
+func radinv2(_ n: UInt32) -> Double {
+  Double(n.bitSwapped) / Double(1 << 32)
+}
+
+func radinv3(_ n: UInt32) -> Double {
+  var n = n
+  var output: Double = .zero
+  var invBi: Double = 1.0 / 3
+  while n > 0 {
+    output += Double(n % 3) * invBi
+    n /= 3
+    invBi /= 3
+  }
+  return min(output, 1)
+}
+
+extension UInt32 {
+  var bitSwapped: UInt32 {
+    var input = self
+    var output: UInt32 = .zero
+    for _ in 0..<32 {
+      output = (output << 1) | (input & 1)
+      input >>= 1
+    }
+    return output
+  }
+}
+
+func createAORays(hits: [PrimaryHit]) -> [AORay] {
+  var output: [AORay] = []
+  for hit in hits {
+    var seed = UInt32(truncatingIfNeeded: hit.pixelID &* 2654435761) % 256
+    
+    // Basis around the normal, as in 'RayGeneration.createAxes'.
+    let z = hit.normal
+    var y: SIMD3<Double>
+    if abs(z.z) > 0.999 {
+      y = SIMD3(-z.x * z.y, 1 - z.y * z.y, -z.y * z.z)
+    } else {
+      y = SIMD3(-z.x * z.z, -z.y * z.z, 1 - z.z * z.z)
+    }
+    y = normalize(y)
+    let x = cross(y, z)
+    
+    for sampleID in 0..<sampleCount {
+      var random1 = radinv3(seed)
+      let random2 = radinv2(seed)
+      seed = (seed + 1) % 256
+      random1 = (Double(sampleID) + random1) / Double(sampleCount)
+      
+      let phi = 2 * Double.pi * random1
+      let sinTheta = (1 - random2).squareRoot()
+      let local = SIMD3(
+        cos(phi) * sinTheta, sin(phi) * sinTheta, random2.squareRoot())
+      let direction = local.x * x + local.y * y + local.z * z
+      output.append(AORay(
+        pixelID: hit.pixelID,
+        sampleID: sampleID,
+        origin: hit.point + 1e-4 * hit.normal,
+        direction: direction))
+    }
+  }
+  return output
+}
+
+// MARK: - Batching
+
+// One batch per (SIMD, sample index), as in the render shader.
+func pixelOrderBatches(_ rays: [AORay]) -> [[AORay]] {
+  var batches: [Int: [AORay]] = [:]
+  for ray in rays {
+    let x = ray.pixelID % tileSize
+    let y = ray.pixelID / tileSize
+    let simdID = (y / 4) * (tileSize / 8) + (x / 8)
+    batches[simdID * sampleCount + ray.sampleID, default: []].append(ray)
+  }
+  return batches.keys.sorted().map { batches[$0]! }
+}
+
+// Sort key: 3-bit direction octant, then the Morton code of the 0.5 nm cell
+// containing the origin. Sorting by octant first keeps the DDA step
+// directions uniform within a batch. Finer origin cells improve the memory
+// locality, until the batches no longer fill up with similar rays.
+func binKey(_ ray: AORay) -> UInt64 {
+  var octant: UInt64 = .zero
+  for dim in 0..<3 where ray.direction[dim] < 0 {
+    octant |= 1 << UInt64(dim)
+  }
+  
+  var mortonCode: UInt64 = .zero
+  let cellCoords = SIMD3<Int64>((ray.origin / 0.5 + 512).rounded(.down))
+  for bit in 0..<12 {
+    for dim in 0..<3 {
+      let value = UInt64(cellCoords[dim] >> Int64(bit)) & 1
+      mortonCode |= value << UInt64(bit * 3 + dim)
+    }
+  }
+  return (octant << 36) | mortonCode
+}
+
+func binnedBatches(_ rays: [AORay]) -> [[AORay]] {
+  let keys = rays.map(binKey)
+  let order = rays.indices.sorted { keys[$0] < keys[$1] }
+  let sortedRays = order.map { rays[$0] }
+  return stride(from: 0, to: sortedRays.count, by: batchSize).map {
+    Array(sortedRays[$0..<min($0 + batchSize, sortedRays.count)])
+  }
+}
+
+// MARK: - Benchmark
+
+struct TraceResult {
+  var laneUtilization: Double
+  var cellsPerBatch: Double
+  var latency: Double
+  
+  // Hit atom of every ray, indexed by pixel and sample.
+  var hits: [Int: [UInt32?]]
+}
+
+func trace(grid: SmallCellGrid, batches: [[AORay]]) -> TraceResult {
+  let cutoffAO = 1 + 0.25 * Double(3).squareRoot()
+  var activeSteps: Int = .zero
+  var lockstepSteps: Int = .zero
+  var visitedCellCount: Int = .zero
+  var hits: [Int: [UInt32?]] = [:]
+  
+  let start = Date()
+  for batch in batches {
+    var maximumSteps: Int = .zero
+    var visitedCells: Set<SIMD3<Int32>> = []
+    
+    for ray in batch {
+      let (stepCount, atomID) = grid.intersect(
+        origin: ray.origin,
+        direction: ray.direction,
+        maximumDistance: cutoffAO,
+        visitedCells: &visitedCells)
+      activeSteps += stepCount
+      maximumSteps = max(maximumSteps, stepCount)
+      
+      // Scatter the result back to its pixel.
+      var pixelHits = hits[ray.pixelID] ??
+      Array(repeating: nil, count: sampleCount)
+      pixelHits[ray.sampleID] = atomID
+      hits[ray.pixelID] = pixelHits
+    }
+    lockstepSteps += batchSize * maximumSteps
+    visitedCellCount += visitedCells.count
+  }
+  let latency = Date().timeIntervalSince(start)
+  
+  return TraceResult(
+    laneUtilization: Double(activeSteps) / Double(lockstepSteps),
+    cellsPerBatch: Double(visitedCellCount) / Double(batches.count),
+    latency: latency,
+    hits: hits)
+}
+
+var generator = SplitMix64(state: 2025)
+let grid = SmallCellGrid(atoms: createAtoms(generator: &generator))
+let primaryHits = createPrimaryHits(grid: grid)
+let rays = createAORays(hits: primaryHits)
+print("atoms:", grid.atoms.count)
+print("pixels hit:", primaryHits.count, "of", tileSize * tileSize)
+print("AO rays:", rays.count)
+print()
+
+var binningLatency: Double = .zero
+var pixelLatency: Double = .zero
+var binnedLatency: Double = .zero
+var pixelResult: TraceResult?
+var binnedResult: TraceResult?
+for _ in 0..<trialCount {
+  let binningStart = Date()
+  let batches = binnedBatches(rays)
+  binningLatency += Date().timeIntervalSince(binningStart)
+  
+  let result1 = trace(grid: grid, batches: pixelOrderBatches(rays))
+  let result2 = trace(grid: grid, batches: batches)
+  pixelLatency += result1.latency
+  binnedLatency += result2.latency
+  pixelResult = result1
+  binnedResult = result2
+}
+
+// Reordering the rays must never change what they hit.
+guard pixelResult!.hits == binnedResult!.hits else {
+  fatalError("Binned rays did not match pixel-order rays.")
+}
+
+func rayThroughput(_ latency: Double) -> String {
+  let raysPerSecond = Double(rays.count * trialCount) / latency
+  return String(format: "%.2f M/s", raysPerSecond / 1e6)
+}
+
+print("| order  | lane utilization | cells per batch | throughput |")
+print("| ------ | ---------------: | --------------: | ---------: |")
+for (name, result, latency) in [
+  ("pixel", pixelResult!, pixelLatency),
+  ("binned", binnedResult!, binnedLatency),
+] {
+  let row = [
+    name.padding(toLength: 6, withPad: " ", startingAt: 0),
+    String(format: "%.1f%%", result.laneUtilization * 100),
+    String(format: "%.1f", result.cellsPerBatch),
+    rayThroughput(latency),
+  ]
+  print("| " + row.joined(separator: " | ") + " |")
+}
+print()
+print("binning overhead:", rayThroughput(binningLatency))
@@ -0,0 +1,216 @@
+import Foundation
+
+// CPU model of the DDA in 'fillMemoryTape', counting the loop iterations of
+// primary rays. Compares the default occupancy hierarchy (8 nm and 32 nm
+// marks) against the optional 128 nm level.
+//
+// The scene is a fixed cluster of nanoparts near the origin. Rays that miss
+// the cluster travel to the edge of the world, which is where the coarser
+// level pays off. As the world dimension grows, the number of jumps through
+// empty space scales with (world dimension) / (largest group spacing).
+//
+// Each ray stops at the first occupied 2 nm voxel. On the GPU, the ray keeps
+// collecting up to 8 large voxels before testing atoms, but that part of the
+// traversal is the same for both hierarchies.
+
+// MARK: - User-Facing Options
+
+let worldDimensions: [Float] = [256, 512, 1024, 2048]
+let cameraDistance: Double = 100
+let fieldOfView: Double = 60
+let rayCount: Int = 16384
+
+// The nanoparts are 16 nm cubes, scattered within a 128 nm region.
+let nanopartCount: Int = 48
+let nanopartFillFraction: Double = 0.3
+let regionSize: Double = 128
+
+// MARK: - Occupancy Hierarchy
+
+struct OccupancyHierarchy {
+  var worldDimension: Double
+  var marks2: Set<SIMD3<Int32>> = []
+  var marks8: Set<SIMD3<Int32>> = []
+  var marks32: Set<SIMD3<Int32>> = []
+  var marks128: Set<SIMD3<Int32>> = []
+  
+  // Mirrors 'rebuildProcess3', which marks every level for each occupied
+  // 2 nm voxel.
+  init(worldDimension: Float, occupiedCorners: [SIMD3<Double>]) {
+    self.worldDimension = Double(worldDimension)
+    for corner in occupiedCorners {
+      let voxelCoords = self.voxelCoords(corner + 1)
+      marks2.insert(voxelCoords)
+      marks8.insert(voxelCoords / 4)
+      marks32.insert(voxelCoords / 16)
+      marks128.insert(voxelCoords / 64)
+    }
+  }
+  
+  func voxelCoords(_ position: SIMD3<Double>) -> SIMD3<Int32> {
+    var coordinates = position + worldDimension / 2
+    coordinates /= 2
+    return SIMD3<Int32>(coordinates.rounded(.down))
+  }
+  
+  func isOutOfBounds(_ position: SIMD3<Double>) -> Bool {
+    let lhs = position .< -worldDimension / 2
+    let rhs = position .>= worldDimension / 2
+    return any(lhs .| rhs)
+  }
+  
+  // Returns the number of loop iterations, and the first occupied voxel.
+  func traverse(
+    origin: SIMD3<Double>,
+    direction: SIMD3<Double>,
+    usesCoarseOccupancy: Bool
+  ) -> (Int, SIMD3<Int32>?) {
+    var t: Double = .zero
+    var stepCount: Int = .zero
+    
+    while true {
+      // Nudge the position into the cell on the far side of the border.
+      let position = origin + (t + 1e-6) * direction
+      guard !isOutOfBounds(position) else {
+        return (stepCount, nil)
+      }
+      stepCount += 1
+      
+      // Branch on the marks, from finest to coarsest.
+      let voxelCoords = self.voxelCoords(position)
+      var groupSpacing: Double
+      if marks8.contains(voxelCoords / 4) {
+        if marks2.contains(voxelCoords) {
+          return (stepCount, voxelCoords)
+        }
+        groupSpacing = 2
+      } else if marks32.contains(voxelCoords / 16) {
+        groupSpacing = 8
+      } else if !usesCoarseOccupancy {
+        groupSpacing = 32
+      } else if marks128.contains(voxelCoords / 64) {
+        groupSpacing = 32
+      } else {
+        groupSpacing = 128
+      }
+      
+      // Jump to the border of the current group.
+      var nextTime = Double.greatestFiniteMagnitude
+      for dim in 0..<3 where direction[dim] != 0 {
+        var border = (position[dim] / groupSpacing).rounded(.down)
+        if direction[dim] > 0 {
+          border += 1
+        }
+        border *= groupSpacing
+        
+        let time = (border - origin[dim]) / direction[dim]
+        nextTime = min(nextTime, time)
+      }
+      t = nextTime
+    }
+  }
+}
+
+// MARK: - Scene
+
+struct SplitMix64: RandomNumberGenerator {
+  var state: UInt64
+  
+  mutating func next() -> UInt64 {
+    state &+= 0x9E37_79B9_7F4A_7C15
+    var z = state
+    z = (z ^ (z >> 30)) &* 0xBF58_476D_1CE4_E5B9
+    z = (z ^ (z >> 27)) &* 0x94D0_49BB_1331_11EB
+    return z ^ (z >> 31)
+  }
+}
+
+// Lower corners of the occupied 2 nm voxels, aligned to the 2 nm grid.
+func createScene(generator: inout SplitMix64) -> [SIMD3<Double>] {
+  var output: [SIMD3<Double>] = []
+  for _ in 0..<nanopartCount {
+    var center = SIMD3<Double>.random(
+      in: -regionSize / 2..<regionSize / 2, using: &generator)
+    center = (center / 2).rounded(.down) * 2
+    
+    for z in -4..<4 {
+      for y in -4..<4 {
+        for x in -4..<4 {
+          guard Double.random(in: 0..<1, using: &generator)
+                  < nanopartFillFraction else {
+            continue
+          }
+          let offset = SIMD3<Double>(Double(x), Double(y), Double(z)) * 2
+          output.append(center + offset)
+        }
+      }
+    }
+  }
+  return output
+}
+
+// Primary rays from a camera on the +Z axis, looking toward the origin.
+func createRays(generator: inout SplitMix64) -> [SIMD3<Double>] {
+  let tangent = tan(fieldOfView / 2 * Double.pi / 180)
+  var output: [SIMD3<Double>] = []
+  for _ in 0..<rayCount {
+    let x = Double.random(in: -1..<1, using: &generator) * tangent
+    let y = Double.random(in: -1..<1, using: &generator) * tangent
+    var direction = SIMD3<Double>(x, y, -1)
+    direction /= (direction * direction).sum().squareRoot()
+    output.append(direction)
+  }
+  return output
+}
+
+// MARK: - Benchmark
+
+var generator = SplitMix64(state: 2025)
+let occupiedCorners = createScene(generator: &generator)
+let rayDirections = createRays(generator: &generator)
+let cameraPosition = SIMD3<Double>(0, 0, cameraDistance)
+print("occupied voxels:", occupiedCorners.count)
+print("rays:", rayDirections.count)
+print()
+print("steps per ray:")
+print("| world (nm) | 8/32 nm | 8/32/128 nm | reduction |")
+print("| ---------: | ------: | ----------: | --------: |")
+
+var mismatchCount: Int = .zero
+for worldDimension in worldDimensions {
+  let hierarchy = OccupancyHierarchy(
+    worldDimension: worldDimension,
+    occupiedCorners: occupiedCorners)
+  
+  var defaultSteps: Int = .zero
+  var coarseSteps: Int = .zero
+  for direction in rayDirections {
+    let (steps1, hit1) = hierarchy.traverse(
+      origin: cameraPosition,
+      direction: direction,
+      usesCoarseOccupancy: false)
+    let (steps2, hit2) = hierarchy.traverse(
+      origin: cameraPosition,
+      direction: direction,
+      usesCoarseOccupancy: true)
+    defaultSteps += steps1
+    coarseSteps += steps2
+    
+    // Skipping empty space must never change which voxel is hit.
+    if hit1 != hit2 {
+      mismatchCount += 1
+    }
+  }
+  
+  let defaultAverage = Double(defaultSteps) / Double(rayCount)
+  let coarseAverage = Double(coarseSteps) / Double(rayCount)
+  let row = [
+    "\(Int(worldDimension))",
+    String(format: "%.1f", defaultAverage),
+    String(format: "%.1f", coarseAverage),
+    String(format: "%.2fx", defaultAverage / coarseAverage),
+  ]
+  print("| " + row.joined(separator: " | ") + " |")
+}
+print()
+print("rays with mismatched hits:", mismatchCount)
@@ -0,0 +1,425 @@
+import Foundation
+import MolecularRenderer
+
+// Round trip through the hand-written encoders in 'ImageExporter'. Exports
+// two frames as raw RGBA, PNG, and GIF, then decodes the files and compares
+// them against the raw pixels:
+// - rendered frame: PNG must match exactly
+// - test pattern: PNG and GIF must both match exactly
+//
+// The test pattern has 256 colors, each in a different bin of the GIF
+// quantizer, so the median cut assigns every color its own palette entry.
+// Half of the pattern is random, which fills the LZW dictionary and forces
+// several clear codes per frame.
+
+// MARK: - User-Facing Options
+
+let frameBufferSize = SIMD2<Int>(128, 128)
+let exportPath = FileManager.default.currentDirectoryPath + "/.build/export"
+
+// MARK: - Render Frame
+
+@MainActor
+func createApplication() -> Application {
+  // Set up the device.
+  var deviceDesc = DeviceDescriptor()
+  deviceDesc.deviceID = Device.fastestDeviceID
+  let device = Device(descriptor: deviceDesc)
+  
+  // Set up the display. Omitting the monitor ID selects offline rendering.
+  var displayDesc = DisplayDescriptor()
+  displayDesc.device = device
+  displayDesc.frameBufferSize = frameBufferSize
+  let display = Display(descriptor: displayDesc)
+  
+  // Set up the application.
+  var applicationDesc = ApplicationDescriptor()
+  applicationDesc.device = device
+  applicationDesc.display = display
+  applicationDesc.upscaleFactor = 1
+  
+  applicationDesc.addressSpaceSize = 10_000
+  applicationDesc.voxelAllocationSize = 100_000_000
+  applicationDesc.worldDimension = 32
+  let application = Application(descriptor: applicationDesc)
+  
+  return application
+}
+let application = createApplication()
+
+// A 4 x 4 x 4 grid of carbon atoms, 0.2 nm apart.
+do {
+  var atomID: Int = .zero
+  for z in 0..<4 {
+    for y in 0..<4 {
+      for x in 0..<4 {
+        var position = SIMD3<Float>(Float(x), Float(y), Float(z))
+        position = (position - 1.5) * 0.2
+        application.atoms[atomID] = SIMD4(position, 6)
+        atomID += 1
+      }
+    }
+  }
+  application.camera.position = SIMD3(0, 0, 2)
+}
+let renderedImage = application.render()
+
+// MARK: - Test Pattern
+
+// 8 levels of red and green, 4 levels of blue. The values are multiples of
+// 1/255, which survive the round trip through Float16.
+func createPatternColor(index: Int) -> SIMD4<Float16> {
+  let r = (index % 8) * 32 + 8
+  let g = (index / 8 % 8) * 32 + 8
+  let b = (index / 64) * 64 + 8
+  let color = SIMD4<Float>(Float(r), Float(g), Float(b), 255) / 255
+  return SIMD4<Float16>(color)
+}
+
+@MainActor
+func createPatternImage() -> Image {
+  var output = renderedImage
+  var state: UInt32 = 1
+  for pixelID in output.pixels.indices {
+    // Random colors in the top half, 8 x 8 tiles in the bottom half.
+    let x = pixelID % frameBufferSize[0]
+    let y = pixelID / frameBufferSize[0]
+    var index: Int
+    if y < frameBufferSize[1] / 2 {
+      state = state &* 1_664_525 &+ 1_013_904_223
+      index = Int(state >> 24)
+    } else {
+      index = (y / 8 * 16 + x / 8) % 256
+    }
+    output.pixels[pixelID] = createPatternColor(index: index)
+  }
+  return output
+}
+let patternImage = createPatternImage()
+
+// MARK: - Export
+
+@MainActor
+func export(format: ExportFormat, path: String) {
+  var exporterDesc = ImageExporterDescriptor()
+  exporterDesc.format = format
+  exporterDesc.path = path
+  exporterDesc.frameBufferSize = frameBufferSize
+  exporterDesc.frameRate = 20
+  let exporter = ImageExporter(descriptor: exporterDesc)
+  exporter.append(image: renderedImage)
+  exporter.append(image: patternImage)
+  exporter.finish()
+}
+try! FileManager.default.createDirectory(
+  atPath: exportPath, withIntermediateDirectories: true)
+export(format: .rgba, path: "\(exportPath)/frames.rgba")
+export(format: .png, path: "\(exportPath)/png")
+export(format: .gif, path: "\(exportPath)/frames.gif")
+
+func readFile(path: String) -> [UInt8] {
+  guard let data = FileManager.default.contents(atPath: path) else {
+    fatalError("Could not read file.")
+  }
+  return [UInt8](data)
+}
+
+// PNG stores integers in big-endian order.
+func readUInt32(_ bytes: [UInt8], _ address: Int) -> UInt32 {
+  var output: UInt32 = .zero
+  for i in 0..<4 {
+    output = (output << 8) | UInt32(bytes[address + i])
+  }
+  return output
+}
+
+// MARK: - Decode PNG
+
+// Only accepts what 'PNGEncoding' writes: 8-bit RGB, stored deflate blocks,
+// and no row filters. Checks every CRC and the Adler-32 checksum.
+func decodePNG(_ bytes: [UInt8]) -> [SIMD3<UInt8>] {
+  var crcTable: [UInt32] = []
+  for i in 0..<256 {
+    var value = UInt32(i)
+    for _ in 0..<8 {
+      if value & 1 != 0 {
+        value = 0xEDB8_8320 ^ (value >> 1)
+      } else {
+        value >>= 1
+      }
+    }
+    crcTable.append(value)
+  }
+  
+  let signature: [UInt8] = [0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A]
+  guard Array(bytes[0..<8]) == signature else {
+    fatalError("PNG signature was incorrect.")
+  }
+  
+  // Collect the chunks.
+  var header: [UInt8] = []
+  var stream: [UInt8] = []
+  var address = 8
+  while address < bytes.count {
+    let length = Int(readUInt32(bytes, address))
+    let typeAndData = Array(bytes[(address + 4)..<(address + 8 + length)])
+    var crc: UInt32 = 0xFFFF_FFFF
+    for byte in typeAndData {
+      let index = Int((crc ^ UInt32(byte)) & 0xFF)
+      crc = crcTable[index] ^ (crc >> 8)
+    }
+    guard ~crc == readUInt32(bytes, address + 8 + length) else {
+      fatalError("PNG chunk had an incorrect CRC.")
+    }
+    
+    let type = String(decoding: typeAndData[0..<4], as: UTF8.self)
+    let data = typeAndData[4...]
+    switch type {
+    case "IHDR": header = Array(data)
+    case "IDAT": stream += data
+    case "IEND": break
+    default: fatalError("Unexpected PNG chunk '\(type)'.")
+    }
+    address += 12 + length
+  }
+  
+  let width = Int(readUInt32(header, 0))
+  let height = Int(readUInt32(header, 4))
+  guard SIMD2(width, height) == frameBufferSize,
+        Array(header[8...]) == [8, 2, 0, 0, 0] else {
+    fatalError("PNG header was incorrect.")
+  }
+  
+  // Inflate the stored blocks.
+  guard (Int(stream[0]) << 8 | Int(stream[1])) % 31 == 0,
+        stream[0] & 0x0F == 8 else {
+    fatalError("Zlib header was incorrect.")
+  }
+  var rawData: [UInt8] = []
+  var streamAddress = 2
+  var isFinalBlock = false
+  while !isFinalBlock {
+    let blockHeader = stream[streamAddress]
+    guard blockHeader >> 1 == 0 else {
+      fatalError("Deflate block was not stored.")
+    }
+    isFinalBlock = blockHeader & 1 == 1
+    let length = Int(stream[streamAddress + 1]) |
+      Int(stream[streamAddress + 2]) << 8
+    let lengthComplement = Int(stream[streamAddress + 3]) |
+      Int(stream[streamAddress + 4]) << 8
+    guard length ^ lengthComplement == 0xFFFF else {
+      fatalError("Stored block length was corrupted.")
+    }
+    streamAddress += 5
+    rawData += stream[streamAddress..<(streamAddress + length)]
+    streamAddress += length
+  }
+  
+  var a: UInt32 = 1
+  var b: UInt32 = 0
+  for byte in rawData {
+    a = (a + UInt32(byte)) % 65521
+    b = (b + a) % 65521
+  }
+  let checksum = readUInt32(stream, streamAddress)
+  guard (b << 16) | a == checksum else {
+    fatalError("Adler-32 checksum was incorrect.")
+  }
+  
+  // Remove the filter byte from each row.
+  guard rawData.count == height * (1 + 3 * width) else {
+    fatalError("PNG image data had the wrong size.")
+  }
+  var output: [SIMD3<UInt8>] = []
+  for y in 0..<height {
+    let rowStart = y * (1 + 3 * width)
+    guard rawData[rowStart] == 0 else {
+      fatalError("Unexpected PNG row filter.")
+    }
+    for x in 0..<width {
+      let pixelStart = rowStart + 1 + 3 * x
+      output.append(SIMD3(
+        rawData[pixelStart],
+        rawData[pixelStart + 1],
+        rawData[pixelStart + 2]))
+    }
+  }
+  return output
+}
+
+// MARK: - Decode GIF
+
+// Standard variable-length LZW decoder, for 8-bit symbols.
+func decompressLZW(_ bytes: [UInt8]) -> [UInt8] {
+  let clearCode = 256
+  let endCode = 257
+  
+  var bitAddress = 0
+  var codeSize = 9
+  func readCode() -> Int {
+    var output = 0
+    for bitID in 0..<codeSize {
+      let byte = bytes[bitAddress / 8]
+      let bit = Int(byte >> UInt8(bitAddress % 8)) & 1
+      output |= bit << bitID
+      bitAddress += 1
+    }
+    return output
+  }
+  
+  var output: [UInt8] = []
+  var table: [[UInt8]] = []
+  var previousCode: Int?
+  while true {
+    let code = readCode()
+    if code == clearCode {
+      table = (0..<256).map { [UInt8($0)] } + [[], []]
+      codeSize = 9
+      previousCode = nil
+      continue
+    }
+    if code == endCode {
+      break
+    }
+    guard table.count > 0 else {
+      fatalError("LZW stream did not start with a clear code.")
+    }
+    guard let lastCode = previousCode else {
+      output += table[code]
+      previousCode = code
+      continue
+    }
+    
+    var entry: [UInt8]
+    if code < table.count {
+      entry = table[code]
+      table.append(table[lastCode] + [entry[0]])
+    } else if code == table.count {
+      entry = table[lastCode] + [table[lastCode][0]]
+      table.append(entry)
+    } else {
+      fatalError("LZW code was out of range.")
+    }
+    output += entry
+    previousCode = code
+    if table.count >= (1 << codeSize), codeSize < 12 {
+      codeSize += 1
+    }
+  }
+  return output
+}
+
+// Only accepts what 'GIFEncoding' writes: full-frame images with a local
+// color table of 256 entries.
+func decodeGIF(_ bytes: [UInt8]) -> [[SIMD3<UInt8>]] {
+  func readUInt16(_ address: Int) -> Int {
+    Int(bytes[address]) | Int(bytes[address + 1]) << 8
+  }
+  guard Array(bytes[0..<6]) == Array("GIF89a".utf8),
+        SIMD2(readUInt16(6), readUInt16(8)) == frameBufferSize else {
+    fatalError("GIF header was incorrect.")
+  }
+  
+  // Concatenates the sub-blocks, up to the terminator.
+  var address = 13
+  func readSubBlocks() -> [UInt8] {
+    var output: [UInt8] = []
+    while bytes[address] > 0 {
+      let length = Int(bytes[address])
+      output += bytes[(address + 1)..<(address + 1 + length)]
+      address += 1 + length
+    }
+    address += 1
+    return output
+  }
+  
+  var output: [[SIMD3<UInt8>]] = []
+  while true {
+    let blockType = bytes[address]
+    address += 1
+    switch blockType {
+    case 0x21:
+      // Extension: skip the label and the sub-blocks.
+      address += 1
+      _ = readSubBlocks()
+    case 0x2C:
+      let origin = SIMD2(readUInt16(address), readUInt16(address + 2))
+      let size = SIMD2(readUInt16(address + 4), readUInt16(address + 6))
+      guard origin == .zero,
+            size == frameBufferSize,
+            bytes[address + 8] == 0x87 else {
+        fatalError("GIF image descriptor was incorrect.")
+      }
+      address += 9
+      var palette: [SIMD3<UInt8>] = []
+      for _ in 0..<256 {
+        palette.append(SIMD3(
+          bytes[address], bytes[address + 1], bytes[address + 2]))
+        address += 3
+      }
+      guard bytes[address] == 8 else {
+        fatalError("GIF minimum code size was incorrect.")
+      }
+      address += 1
+      
+      let indices = decompressLZW(readSubBlocks())
+      guard indices.count == frameBufferSize[0] * frameBufferSize[1] else {
+        fatalError("GIF frame had the wrong number of pixels.")
+      }
+      output.append(indices.map { palette[Int($0)] })
+    case 0x3B:
+      return output
+    default:
+      fatalError("Unexpected GIF block.")
+    }
+  }
+}
+
+// MARK: - Compare
+
+let pixelCount = frameBufferSize[0] * frameBufferSize[1]
+let rgbaBytes = readFile(path: "\(exportPath)/frames.rgba")
+guard rgbaBytes.count == 2 * 4 * pixelCount else {
+  fatalError("RGBA file had the wrong size.")
+}
+var referenceFrames: [[SIMD3<UInt8>]] = []
+for frameID in 0..<2 {
+  var frame: [SIMD3<UInt8>] = []
+  for pixelID in 0..<pixelCount {
+    let address = 4 * (frameID * pixelCount + pixelID)
+    frame.append(SIMD3(
+      rgbaBytes[address], rgbaBytes[address + 1], rgbaBytes[address + 2]))
+  }
+  referenceFrames.append(frame)
+}
+
+// The test pattern must go through the float conversion unchanged.
+for pixelID in 0..<pixelCount {
+  let color = SIMD4<Float>(patternImage.pixels[pixelID]) * 255
+  let expected = SIMD3<UInt8>(
+    UInt8(color[0].rounded()),
+    UInt8(color[1].rounded()),
+    UInt8(color[2].rounded()))
+  guard referenceFrames[1][pixelID] == expected else {
+    fatalError("Test pattern did not survive the pixel conversion.")
+  }
+}
+
+for frameID in 0..<2 {
+  let path = "\(exportPath)/png/frame-0000\(frameID).png"
+  let pixels = decodePNG(readFile(path: path))
+  guard pixels == referenceFrames[frameID] else {
+    fatalError("PNG frame \(frameID) did not match the raw pixels.")
+  }
+}
+print("PNG round trip: PASS")
+
+let gifFrames = decodeGIF(readFile(path: "\(exportPath)/frames.gif"))
+guard gifFrames.count == 2 else {
+  fatalError("GIF had the wrong number of frames.")
+}
+guard gifFrames[1] == referenceFrames[1] else {
+  fatalError("GIF test pattern did not match the raw pixels.")
+}
+print("GIF round trip: PASS")
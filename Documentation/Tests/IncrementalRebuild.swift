@@ -0,0 +1,250 @@
+import Foundation
+
+// CPU reference for rebuilding the 0.25 nm cells of a single 2 nm voxel.
+// Mirrors the data layout of 'rebuildProcess2':
+// - 32-bit list: atoms in the 2 nm voxel, addressed by their index
+// - small headers: [start, end) range of each 0.25 nm cell in the 16-bit list
+// - 16-bit list: indices into the 32-bit list
+//
+// Compares the full rebuild against an incremental rebuild, which only
+// recomputes the small cells overlapped by the previous or current bounding
+// cube of a moved atom. All other cell lists are copied verbatim, with their
+// offsets patched by a prefix sum over the new cell sizes.
+//
+// The incremental rebuild is only valid when the indices in the 32-bit list
+// are stable. This is true for atoms moving within their voxel footprint,
+// which keep their place in the reference lists. It is not true after the
+// remove process compacts the 32-bit list, which is why the GPU kernel still
+// rebuilds tagged voxels from scratch.
+
+// MARK: - User-Facing Options
+
+let atomCount: Int = 1400
+let changedAtomCounts: [Int] = [1, 4, 16, 64, 256, 1024]
+let trialCount: Int = 100
+
+// MARK: - Reference Implementation
+
+struct SmallCellLists {
+  var headers: [SIMD2<UInt32>] = Array(repeating: .zero, count: 512)
+  var references16: [UInt16] = []
+  
+  // Atom in voxel-local coordinates, scaled to units of 0.25 nm.
+  // XYZ = position, W = radius^2
+  static func scale(_ atom: SIMD4<Float>) -> SIMD4<Float> {
+    var output = atom
+    output /= 0.25
+    output.w /= 0.25
+    return output
+  }
+  
+  static func cubeSphereTest(
+    lowerCorner: SIMD3<Float>,
+    atom: SIMD4<Float>
+  ) -> Bool {
+    let c1 = lowerCorner
+    let c2 = c1 + 1
+    var distanceSquared = atom.w
+    for dim in 0..<3 {
+      if atom[dim] < c1[dim] {
+        let delta = atom[dim] - c1[dim]
+        distanceSquared -= delta * delta
+      } else if atom[dim] > c2[dim] {
+        let delta = atom[dim] - c2[dim]
+        distanceSquared -= delta * delta
+      }
+    }
+    return distanceSquared > 0
+  }
+  
+  static func boundingBox(
+    _ atom: SIMD4<Float>
+  ) -> (SIMD3<Float>, SIMD3<Float>) {
+    let position = SIMD3(atom.x, atom.y, atom.z)
+    let radius = atom.w.squareRoot()
+    var boxMin = position - radius
+    var boxMax = position + radius
+    boxMin.replace(with: 0, where: boxMin .< 0)
+    boxMax.replace(with: 8, where: boxMax .> 8)
+    return (boxMin.rounded(.down), boxMax.rounded(.up))
+  }
+  
+  // Calls the closure for every small cell intersected by the atom.
+  static func forEachCell(
+    _ atom: SIMD4<Float>,
+    _ closure: (Int) -> Void
+  ) {
+    let (boxMin, boxMax) = boundingBox(atom)
+    for z in 0..<3 {
+      for y in 0..<3 {
+        for x in 0..<3 {
+          let xyz = boxMin + SIMD3<Float>(Float(x), Float(y), Float(z))
+          guard all(xyz .< boxMax),
+                cubeSphereTest(lowerCorner: xyz, atom: atom) else {
+            continue
+          }
+          let cellID = Int(xyz.z * 64 + xyz.y * 8 + xyz.x)
+          closure(cellID)
+        }
+      }
+    }
+  }
+  
+  // Rebuild the entire voxel from scratch.
+  mutating func rebuild(atoms: [SIMD4<Float>]) {
+    var counts = [UInt32](repeating: .zero, count: 512)
+    for atom in atoms {
+      Self.forEachCell(atom) { counts[$0] += 1 }
+    }
+    
+    var offset: UInt32 = .zero
+    for cellID in 0..<512 {
+      headers[cellID] = SIMD2(offset, offset)
+      offset += counts[cellID]
+    }
+    references16 = Array(repeating: .max, count: Int(offset))
+    
+    for atomID in atoms.indices {
+      Self.forEachCell(atoms[atomID]) { cellID in
+        let address = Int(headers[cellID][1])
+        references16[address] = UInt16(atomID)
+        headers[cellID][1] += 1
+      }
+    }
+  }
+  
+  // Patch the lists after the atoms at 'changedIDs' moved, keeping their
+  // indices in the 32-bit list.
+  mutating func update(
+    atoms: [SIMD4<Float>],
+    previousAtoms: [SIMD4<Float>],
+    changedIDs: [Int]
+  ) {
+    // Tag the cells overlapped by the previous or current bounding cube.
+    var affected = [Bool](repeating: false, count: 512)
+    var isChanged = [Bool](repeating: false, count: atoms.count)
+    for atomID in changedIDs {
+      isChanged[atomID] = true
+      for atom in [previousAtoms[atomID], atoms[atomID]] {
+        Self.forEachCell(atom) { affected[$0] = true }
+      }
+    }
+    
+    // Recompute the affected cells. Unchanged atoms keep their old overlap,
+    // so only the changed atoms can enter a list.
+    var newLists = [[UInt16]](repeating: [], count: 512)
+    for cellID in 0..<512 where affected[cellID] {
+      let range = headers[cellID]
+      for address in Int(range[0])..<Int(range[1]) {
+        let atomID = references16[address]
+        if !isChanged[Int(atomID)] {
+          newLists[cellID].append(atomID)
+        }
+      }
+    }
+    for atomID in changedIDs {
+      Self.forEachCell(atoms[atomID]) { cellID in
+        newLists[cellID].append(UInt16(atomID))
+      }
+    }
+    
+    // Patch the prefix-summed offsets and move the untouched lists.
+    var newHeaders = headers
+    var newReferences: [UInt16] = []
+    newReferences.reserveCapacity(references16.count + 27 * changedIDs.count)
+    for cellID in 0..<512 {
+      let start = UInt32(newReferences.count)
+      if affected[cellID] {
+        newReferences += newLists[cellID]
+      } else {
+        let range = headers[cellID]
+        newReferences += references16[Int(range[0])..<Int(range[1])]
+      }
+      newHeaders[cellID] = SIMD2(start, UInt32(newReferences.count))
+    }
+    headers = newHeaders
+    references16 = newReferences
+  }
+  
+  // Order within a cell is nondeterministic on the GPU, so compare as sets.
+  func cellContents() -> [Set<UInt16>] {
+    (0..<512).map { cellID in
+      let range = headers[cellID]
+      return Set(references16[Int(range[0])..<Int(range[1])])
+    }
+  }
+}
+
+// MARK: - Benchmark
+
+// Thermal jitter for a carbon-like atom: 0.01 nm per frame, clamped so the
+// atom never leaves the 2 nm voxel.
+func jitter(_ atom: SIMD4<Float>) -> SIMD4<Float> {
+  var output = atom
+  for dim in 0..<3 {
+    output[dim] += Float.random(in: -0.01...0.01)
+    output[dim] = max(0.2, min(1.8, output[dim]))
+  }
+  return output
+}
+
+func createAtoms() -> [SIMD4<Float>] {
+  let radius: Float = 0.1426
+  var atoms: [SIMD4<Float>] = []
+  for _ in 0..<atomCount {
+    let position = SIMD3<Float>.random(in: 0.2..<1.8)
+    atoms.append(SIMD4(position, radius * radius))
+  }
+  return atoms
+}
+
+let originalAtoms = createAtoms().map(SmallCellLists.scale)
+var originalLists = SmallCellLists()
+originalLists.rebuild(atoms: originalAtoms)
+print("atom count:", atomCount)
+print("reference count:", originalLists.references16.count)
+print()
+print("| changed | full (μs) | incremental (μs) | speedup |")
+print("| ------: | --------: | ---------------: | ------: |")
+
+for changedAtomCount in changedAtomCounts {
+  var fullLatency: Double = .zero
+  var incrementalLatency: Double = .zero
+  
+  for _ in 0..<trialCount {
+    let changedIDs = Array(originalAtoms.indices.shuffled()
+      .prefix(changedAtomCount))
+    var atoms = originalAtoms
+    for atomID in changedIDs {
+      let unscaled = atoms[atomID] * SIMD4(0.25, 0.25, 0.25, 0.0625)
+      atoms[atomID] = SmallCellLists.scale(jitter(unscaled))
+    }
+    
+    var fullLists = SmallCellLists()
+    let fullStart = Date()
+    fullLists.rebuild(atoms: atoms)
+    fullLatency += Date().timeIntervalSince(fullStart)
+    
+    var incrementalLists = originalLists
+    let incrementalStart = Date()
+    incrementalLists.update(
+      atoms: atoms,
+      previousAtoms: originalAtoms,
+      changedIDs: changedIDs)
+    incrementalLatency += Date().timeIntervalSince(incrementalStart)
+    
+    guard fullLists.cellContents() == incrementalLists.cellContents() else {
+      fatalError("Incremental rebuild did not match full rebuild.")
+    }
+  }
+  
+  let full = fullLatency / Double(trialCount) * 1e6
+  let incremental = incrementalLatency / Double(trialCount) * 1e6
+  let row = [
+    "\(changedAtomCount)",
+    String(format: "%.1f", full),
+    String(format: "%.1f", incremental),
+    String(format: "%.2fx", full / incremental),
+  ]
+  print("| " + row.joined(separator: " | ") + " |")
+}
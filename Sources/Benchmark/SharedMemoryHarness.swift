@@ -0,0 +1,115 @@
+import BenchmarkScenes
+import Foundation
+import MolecularRenderer
+
+// Two-process test of 'ApplicationDescriptor.sharedMemoryName'. The parent
+// renders offline, while a child process launched from the same executable
+// moves a lattice through 'SharedAtomWriter'. Afterward, the parent checks
+// that the atoms match the last generation it registered.
+enum SharedMemoryHarness {
+  static var generationCount: Int { 100 }
+  static var maxFrameCount: Int { 10_000 }
+  
+  // Same atoms in both processes.
+  static func createLattice() -> [SIMD4<Float>] {
+    var atoms = SyntheticLattice.createAtoms(
+      cellCounts: SIMD3(repeating: 8))
+    SyntheticLattice.center(atoms: &atoms)
+    return atoms
+  }
+  
+  // Generation 0 is the initial pose. Every generation moves 0.01 nm along X.
+  static func position(
+    atom: SIMD4<Float>,
+    generation: UInt64
+  ) -> SIMD4<Float> {
+    var output = atom
+    output.x += 0.01 * Float(generation)
+    return output
+  }
+  
+  // Child process.
+  static func runWriter(name: String) {
+    let lattice = createLattice()
+    let writer = SharedAtomWriter(name: name)
+    guard lattice.count <= writer.addressSpaceSize else {
+      fatalError("Shared memory was too small for the lattice.")
+    }
+    
+    for generation in 1...UInt64(generationCount) {
+      writer.waitUntilWritable()
+      for atomID in lattice.indices {
+        writer[atomID] = position(
+          atom: lattice[atomID], generation: generation)
+      }
+      writer.publish()
+    }
+    writer.waitUntilWritable()
+  }
+  
+  // Parent process. Returns whether the test passed.
+  @MainActor
+  static func run() -> Bool {
+    let processID = ProcessInfo.processInfo.processIdentifier
+    let name = "molecular-renderer-\(processID)"
+    let lattice = createLattice()
+    
+    var deviceDesc = DeviceDescriptor()
+    deviceDesc.deviceID = Device.fastestDeviceID
+    let device = Device(descriptor: deviceDesc)
+    
+    var displayDesc = DisplayDescriptor()
+    displayDesc.device = device
+    displayDesc.frameBufferSize = SIMD2(256, 256)
+    let display = Display(descriptor: displayDesc)
+    
+    var applicationDesc = ApplicationDescriptor()
+    applicationDesc.device = device
+    applicationDesc.display = display
+    applicationDesc.upscaleFactor = 1
+    applicationDesc.addressSpaceSize = lattice.count + 512
+    applicationDesc.voxelAllocationSize = 500_000_000
+    applicationDesc.worldDimension = 64
+    applicationDesc.sharedMemoryName = name
+    let application = Application(descriptor: applicationDesc)
+    application.camera.position = SIMD3(0, 0, 10)
+    
+    // The region exists once the application does.
+    let writerProcess = Process()
+    writerProcess.executableURL = URL(
+      fileURLWithPath: CommandLine.arguments[0])
+    writerProcess.arguments = ["--shared-writer", name]
+    do {
+      try writerProcess.run()
+    } catch {
+      fatalError("Could not launch the writer process: \(error)")
+    }
+    
+    let finalGeneration = UInt64(generationCount)
+    var frameCount: Int = .zero
+    while application.atoms.sharedGeneration! < finalGeneration,
+          frameCount < maxFrameCount {
+      application.submitRender()
+      _ = application.pollImages()
+      frameCount += 1
+    }
+    _ = application.flushImages()
+    writerProcess.waitUntilExit()
+    
+    let generation = application.atoms.sharedGeneration!
+    print("registered generation \(generation) after \(frameCount) frames")
+    guard generation == finalGeneration else {
+      print("FAIL: writer did not finish")
+      return false
+    }
+    for atomID in lattice.indices {
+      let expected = position(atom: lattice[atomID], generation: generation)
+      guard application.atoms[atomID] == expected else {
+        print("FAIL: atom \(atomID) did not match generation \(generation)")
+        return false
+      }
+    }
+    print("PASS")
+    return true
+  }
+}
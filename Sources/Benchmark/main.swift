@@ -0,0 +1,296 @@
+import BenchmarkScenes
+import Dispatch
+import Foundation
+import MolecularRenderer
+
+// Headless benchmark runner. Renders one scene from the registry offline, for
+// a fixed number of frames, and prints the latency of every stage. For the
+// CPU half alone, without a GPU, use 'BenchmarkCPU'.
+//
+// Usage:
+//   swift run -c release Benchmark --list
+//   swift run -c release Benchmark <scene> [--csv] [--output <path>]
+//                                          [--pipelined]
+//   swift run -c release Benchmark --transactions
+//   swift run -c release Benchmark --shared-harness
+//
+// Only one application may exist per process, so each scene runs in its own
+// process. Compare results across commits with the same scene, machine, and
+// build configuration.
+
+// MARK: - Options
+
+let warmupFrameCount: Int = 60
+let sampleFrameCount: Int = 240
+let frameBufferSize = SIMD2<Int>(1080, 1080)
+
+struct BenchmarkOptions {
+  var sceneName: String?
+  var exportsCSV: Bool = false
+  var outputPath: String?
+  var listsScenes: Bool = false
+  var runsTransactions: Bool = false
+  var pipelinesTransactions: Bool = false
+  var runsSharedHarness: Bool = false
+  var sharedWriterName: String?
+}
+
+func parseOptions() -> BenchmarkOptions {
+  var output = BenchmarkOptions()
+  var arguments = CommandLine.arguments.dropFirst()
+  while let argument = arguments.popFirst() {
+    switch argument {
+    case "--list":
+      output.listsScenes = true
+    case "--transactions":
+      output.runsTransactions = true
+    case "--pipelined":
+      output.pipelinesTransactions = true
+    case "--shared-harness":
+      output.runsSharedHarness = true
+    case "--shared-writer":
+      guard let name = arguments.popFirst() else {
+        fatalError("Missing name after '--shared-writer'.")
+      }
+      output.sharedWriterName = name
+    case "--csv":
+      output.exportsCSV = true
+    case "--output":
+      guard let path = arguments.popFirst() else {
+        fatalError("Missing path after '--output'.")
+      }
+      output.outputPath = path
+    default:
+      guard output.sceneName == nil else {
+        fatalError("Unexpected argument '\(argument)'.")
+      }
+      output.sceneName = argument
+    }
+  }
+  return output
+}
+
+// MARK: - Results
+
+// The GPU and library stages come from 'Telemetry'. The runner measures the
+// animation and the total frame time itself, in the same units and format.
+struct BenchmarkResult {
+  var atomCount: Int = .zero
+  var animate: [Int] = []
+  var frame: [Int] = []
+  
+  static func createRow(name: String, samples: [Int]) -> [String] {
+    guard samples.count > 0 else {
+      return []
+    }
+    let sorted = samples.sorted()
+    func percentile(_ fraction: Double) -> Int {
+      var rank = Int((fraction * Double(sorted.count)).rounded(.up))
+      rank = max(1, min(rank, sorted.count))
+      return sorted[rank - 1]
+    }
+    let mean = Double(sorted.reduce(0, +)) / Double(sorted.count)
+    return [
+      name,
+      "host",
+      String(sorted.count),
+      String((mean * 10).rounded() / 10),
+      String(sorted.first!),
+      String(percentile(0.50)),
+      String(percentile(0.95)),
+      String(percentile(0.99)),
+      String(sorted.last!),
+    ]
+  }
+  
+  var hostRows: [[String]] {
+    [
+      Self.createRow(name: "animate", samples: animate),
+      Self.createRow(name: "frame", samples: frame),
+    ].filter { $0.count > 0 }
+  }
+}
+
+// MARK: - Run Scene
+
+@MainActor
+func createApplication(
+  scene: BenchmarkScene,
+  options: BenchmarkOptions
+) -> Application {
+  var deviceDesc = DeviceDescriptor()
+  deviceDesc.deviceID = Device.fastestDeviceID
+  let device = Device(descriptor: deviceDesc)
+  
+  // Omitting the monitor ID selects offline rendering, which needs no window.
+  var displayDesc = DisplayDescriptor()
+  displayDesc.device = device
+  displayDesc.frameBufferSize = frameBufferSize
+  let display = Display(descriptor: displayDesc)
+  
+  var applicationDesc = ApplicationDescriptor()
+  applicationDesc.device = device
+  applicationDesc.display = display
+  applicationDesc.upscaleFactor = 1
+  applicationDesc.addressSpaceSize = scene.addressSpaceSize
+  applicationDesc.voxelAllocationSize = scene.voxelAllocationSize
+  applicationDesc.worldDimension = scene.worldDimension
+  applicationDesc.pipelinesTransactions = options.pipelinesTransactions
+  let application = Application(descriptor: applicationDesc)
+  
+  return application
+}
+
+@MainActor
+func run(
+  scene: BenchmarkScene,
+  application: Application
+) -> BenchmarkResult {
+  func currentTime() -> UInt64 {
+    DispatchTime.now().uptimeNanoseconds
+  }
+  
+  var output = BenchmarkResult()
+  let atoms = scene.createAtoms()
+  output.atomCount = atoms.count
+  for atomID in atoms.indices {
+    application.atoms[atomID] = atoms[atomID]
+  }
+  application.camera.position = scene.cameraPosition
+  application.telemetry.warmupFrameCount = warmupFrameCount
+  
+  // Render with up to 3 frames in flight, as in a real-time application. The
+  // images are discarded.
+  var previousTime = currentTime()
+  for frameID in 0..<(warmupFrameCount + sampleFrameCount) {
+    let startTime = currentTime()
+    scene.animate?(frameID, application.atoms)
+    let animateLatency = Int(currentTime() - startTime) / 1000
+    
+    application.submitRender()
+    _ = application.pollImages()
+    
+    let endTime = currentTime()
+    let frameLatency = Int(endTime - previousTime) / 1000
+    previousTime = endTime
+    
+    if frameID >= warmupFrameCount {
+      if scene.animate != nil {
+        output.animate.append(animateLatency)
+      }
+      output.frame.append(frameLatency)
+    }
+  }
+  _ = application.flushImages()
+  return output
+}
+
+// MARK: - Export
+
+@MainActor
+func exportCSV(
+  application: Application,
+  result: BenchmarkResult
+) -> String {
+  var output = application.telemetry.exportCSV()
+  for row in result.hostRows {
+    output += row.joined(separator: ",") + "\n"
+  }
+  return output
+}
+
+@MainActor
+func exportJSON(
+  scene: BenchmarkScene,
+  application: Application,
+  result: BenchmarkResult
+) -> String {
+  var hostEntries: [String] = []
+  for row in result.hostRows {
+    var entry = "    \"\(row[0])\": {"
+    entry += "\"timeline\": \"\(row[1])\", "
+    entry += "\"samples\": \(row[2]), "
+    entry += "\"mean\": \(row[3]), "
+    entry += "\"min\": \(row[4]), "
+    entry += "\"p50\": \(row[5]), "
+    entry += "\"p95\": \(row[6]), "
+    entry += "\"p99\": \(row[7]), "
+    entry += "\"max\": \(row[8])}"
+    hostEntries.append(entry)
+  }
+  
+  var output = "{\n"
+  output += "  \"scene\": \"\(scene.name)\",\n"
+  output += "  \"atomCount\": \(result.atomCount),\n"
+  output += "  \"frameBufferSize\": "
+  output += "[\(frameBufferSize[0]), \(frameBufferSize[1])],\n"
+  output += "  \"warmupFrames\": \(warmupFrameCount),\n"
+  output += "  \"sampleFrames\": \(sampleFrameCount),\n"
+  output += "  \"host\": {\n"
+  output += hostEntries.joined(separator: ",\n")
+  output += "\n  },\n"
+  output += "  \"telemetry\": \(application.telemetry.exportJSON())"
+  output += "}\n"
+  return output
+}
+
+// MARK: - Entry Point
+
+let options = parseOptions()
+if options.listsScenes {
+  for scene in SceneRegistry.scenes {
+    print(scene.name, "-", scene.description)
+  }
+  exit(0)
+}
+
+// Microbenchmarks for 'registerChanges()' and 'upload(transaction:)', which
+// do not need an application.
+if options.runsTransactions {
+  var deviceDesc = DeviceDescriptor()
+  deviceDesc.deviceID = Device.fastestDeviceID
+  let device = Device(descriptor: deviceDesc)
+  
+  let benchmarkDesc = TransactionBenchmarkDescriptor()
+  let benchmark = TransactionBenchmark(
+    descriptor: benchmarkDesc, device: device)
+  print(benchmark.run(), terminator: "")
+  exit(0)
+}
+
+// Two-process test of shared memory. The harness launches this executable
+// again, with '--shared-writer', for the second process.
+if let sharedWriterName = options.sharedWriterName {
+  SharedMemoryHarness.runWriter(name: sharedWriterName)
+  exit(0)
+}
+if options.runsSharedHarness {
+  let succeeded = SharedMemoryHarness.run()
+  exit(succeeded ? 0 : 1)
+}
+
+guard let sceneName = options.sceneName,
+      let scene = SceneRegistry.scene(name: sceneName) else {
+  print("Specify a scene from the registry. Run with '--list' to see them.")
+  exit(1)
+}
+
+let application = createApplication(scene: scene, options: options)
+let result = run(scene: scene, application: application)
+
+var report: String
+if options.exportsCSV {
+  report = exportCSV(application: application, result: result)
+} else {
+  report = exportJSON(scene: scene, application: application, result: result)
+}
+
+if let outputPath = options.outputPath {
+  let succeeded = FileManager.default.createFile(
+    atPath: outputPath, contents: report.data(using: .utf8))
+  guard succeeded else {
+    fatalError("Could not write to file.")
+  }
+} else {
+  print(report, terminator: "")
+}
@@ -0,0 +1,234 @@
+import BenchmarkScenes
+import Dispatch
+import Foundation
+import MolecularRendererCPU
+
+// Headless benchmark runner for the CPU half of the renderer. Animates one
+// scene from the registry, and registers the changes every frame, without a
+// GPU. Builds on Linux, so the continuous integration runs it.
+//
+// Usage:
+//   swift run -c release BenchmarkCPU --list
+//   swift run -c release BenchmarkCPU <scene> [--csv] [--output <path>]
+//   swift run -c release BenchmarkCPU --transactions
+//
+// The uploads and the GPU stages are only measured by 'Benchmark'.
+
+// MARK: - Options
+
+let warmupFrameCount: Int = 60
+let sampleFrameCount: Int = 240
+
+struct BenchmarkOptions {
+  var sceneName: String?
+  var exportsCSV: Bool = false
+  var outputPath: String?
+  var listsScenes: Bool = false
+  var runsTransactions: Bool = false
+}
+
+func parseOptions() -> BenchmarkOptions {
+  var output = BenchmarkOptions()
+  var arguments = CommandLine.arguments.dropFirst()
+  while let argument = arguments.popFirst() {
+    switch argument {
+    case "--list":
+      output.listsScenes = true
+    case "--transactions":
+      output.runsTransactions = true
+    case "--csv":
+      output.exportsCSV = true
+    case "--output":
+      guard let path = arguments.popFirst() else {
+        fatalError("Missing path after '--output'.")
+      }
+      output.outputPath = path
+    default:
+      guard output.sceneName == nil else {
+        fatalError("Unexpected argument '\(argument)'.")
+      }
+      output.sceneName = argument
+    }
+  }
+  return output
+}
+
+// MARK: - Results
+
+// Same units and columns as the host rows of 'Benchmark'.
+struct BenchmarkResult {
+  var atomCount: Int = .zero
+  var changedCount: Int = .zero
+  var animate: [Int] = []
+  var registerChanges: [Int] = []
+  
+  static func createRow(name: String, samples: [Int]) -> [String] {
+    guard samples.count > 0 else {
+      return []
+    }
+    let sorted = samples.sorted()
+    func percentile(_ fraction: Double) -> Int {
+      var rank = Int((fraction * Double(sorted.count)).rounded(.up))
+      rank = max(1, min(rank, sorted.count))
+      return sorted[rank - 1]
+    }
+    let mean = Double(sorted.reduce(0, +)) / Double(sorted.count)
+    return [
+      name,
+      "cpu",
+      String(sorted.count),
+      String((mean * 10).rounded() / 10),
+      String(sorted.first!),
+      String(percentile(0.50)),
+      String(percentile(0.95)),
+      String(percentile(0.99)),
+      String(sorted.last!),
+    ]
+  }
+  
+  var rows: [[String]] {
+    [
+      Self.createRow(name: "animate", samples: animate),
+      Self.createRow(name: "registerChanges", samples: registerChanges),
+    ].filter { $0.count > 0 }
+  }
+}
+
+// MARK: - Run Scene
+
+func changedCount(transaction: [Atoms.Transaction]) -> Int {
+  var output: Int = .zero
+  for chunk in transaction {
+    output += Int(chunk.removedCount)
+    output += Int(chunk.movedCount)
+    output += Int(chunk.addedCount)
+  }
+  return output
+}
+
+func run(scene: BenchmarkScene) -> BenchmarkResult {
+  func currentTime() -> UInt64 {
+    DispatchTime.now().uptimeNanoseconds
+  }
+  
+  var output = BenchmarkResult()
+  let atoms = Atoms(addressSpaceSize: scene.addressSpaceSize)
+  let initialAtoms = scene.createAtoms()
+  output.atomCount = initialAtoms.count
+  guard initialAtoms.count <= atoms.addressSpaceSize else {
+    fatalError("Scene '\(scene.name)' exceeded its address space.")
+  }
+  for atomID in initialAtoms.indices {
+    atoms[atomID] = initialAtoms[atomID]
+  }
+  
+  // The first transaction adds every atom, and is not part of the samples.
+  let initialTransaction = atoms.registerChanges()
+  let addedCount = changedCount(transaction: initialTransaction)
+  guard addedCount == initialAtoms.count else {
+    fatalError("Initial transaction did not add every atom.")
+  }
+  
+  for frameID in 0..<(warmupFrameCount + sampleFrameCount) {
+    let startTime = currentTime()
+    scene.animate?(frameID, atoms)
+    let animateTime = currentTime()
+    let transaction = atoms.registerChanges()
+    let endTime = currentTime()
+    
+    if frameID >= warmupFrameCount {
+      if scene.animate != nil {
+        output.animate.append(Int(animateTime - startTime) / 1000)
+      }
+      output.registerChanges.append(Int(endTime - animateTime) / 1000)
+      output.changedCount += changedCount(transaction: transaction)
+    }
+  }
+  return output
+}
+
+// MARK: - Export
+
+func exportCSV(result: BenchmarkResult) -> String {
+  var output = "stage,timeline,samples,mean,min,p50,p95,p99,max\n"
+  for row in result.rows {
+    output += row.joined(separator: ",") + "\n"
+  }
+  return output
+}
+
+func exportJSON(
+  scene: BenchmarkScene,
+  result: BenchmarkResult
+) -> String {
+  var entries: [String] = []
+  for row in result.rows {
+    var entry = "    \"\(row[0])\": {"
+    entry += "\"timeline\": \"\(row[1])\", "
+    entry += "\"samples\": \(row[2]), "
+    entry += "\"mean\": \(row[3]), "
+    entry += "\"min\": \(row[4]), "
+    entry += "\"p50\": \(row[5]), "
+    entry += "\"p95\": \(row[6]), "
+    entry += "\"p99\": \(row[7]), "
+    entry += "\"max\": \(row[8])}"
+    entries.append(entry)
+  }
+  
+  var output = "{\n"
+  output += "  \"scene\": \"\(scene.name)\",\n"
+  output += "  \"atomCount\": \(result.atomCount),\n"
+  output += "  \"changedAtoms\": \(result.changedCount),\n"
+  output += "  \"warmupFrames\": \(warmupFrameCount),\n"
+  output += "  \"sampleFrames\": \(sampleFrameCount),\n"
+  output += "  \"unit\": \"microseconds\",\n"
+  output += "  \"stages\": {\n"
+  output += entries.joined(separator: ",\n")
+  output += "\n  }\n"
+  output += "}\n"
+  return output
+}
+
+// MARK: - Entry Point
+
+let options = parseOptions()
+if options.listsScenes {
+  for scene in SceneRegistry.scenes {
+    print(scene.name, "-", scene.description)
+  }
+  exit(0)
+}
+
+// Microbenchmarks for 'registerChanges()'. Without a device, the upload
+// columns are omitted.
+if options.runsTransactions {
+  let benchmarkDesc = TransactionBenchmarkDescriptor()
+  let benchmark = TransactionBenchmark(descriptor: benchmarkDesc)
+  print(benchmark.run(), terminator: "")
+  exit(0)
+}
+
+guard let sceneName = options.sceneName,
+      let scene = SceneRegistry.scene(name: sceneName) else {
+  print("Specify a scene from the registry. Run with '--list' to see them.")
+  exit(1)
+}
+
+let result = run(scene: scene)
+
+var report: String
+if options.exportsCSV {
+  report = exportCSV(result: result)
+} else {
+  report = exportJSON(scene: scene, result: result)
+}
+
+if let outputPath = options.outputPath {
+  let succeeded = FileManager.default.createFile(
+    atPath: outputPath, contents: report.data(using: .utf8))
+  guard succeeded else {
+    fatalError("Could not write to file.")
+  }
+} else {
+  print(report, terminator: "")
+}
@@ -0,0 +1,201 @@
+import func Foundation.cos
+import func Foundation.sin
+import MolecularRendererCPU
+
+// A deterministic scene, animated by the frame ID instead of the time. Every
+// run encodes the same sequence of transactions.
+public struct BenchmarkScene {
+  public var name: String
+  public var description: String
+  
+  public var addressSpaceSize: Int
+  public var voxelAllocationSize: Int
+  public var worldDimension: Float
+  public var cameraPosition: SIMD3<Float>
+  
+  // Written once, before the first frame. The closure runs when the scene is
+  // launched, so listing the registry does not build every structure.
+  public var createAtoms: () -> [SIMD4<Float>]
+  
+  // Edits the atoms for the given frame. Nil for static scenes.
+  public var animate: ((Int, Atoms) -> Void)?
+}
+
+public enum SceneRegistry {
+  public static var scenes: [BenchmarkScene] {
+    [
+      rotatingBeam(beamDepth: 10),
+      rotatingBeam(beamDepth: 16),
+      staticLattice(latticeSize: 23),
+      staticLattice(latticeSize: 46),
+      translatingLattice(latticeSize: 23),
+      longDistances(worldDimension: 128),
+      longDistances(worldDimension: 384),
+    ]
+  }
+  
+  public static func scene(name: String) -> BenchmarkScene? {
+    scenes.first { $0.name == name }
+  }
+}
+
+// MARK: - Scenes
+
+extension SceneRegistry {
+  // Same layout as the rotating beam test: a beam turning 3 degrees/frame
+  // above a static cross, with both surfaces sharing a layer of voxels.
+  static func rotatingBeam(beamDepth: Int) -> BenchmarkScene {
+    let crossSize: Int = 120
+    let crossThickness: Int = 16
+    let latticeConstant = SyntheticLattice.latticeConstant
+    
+    func createCross() -> [SIMD4<Float>] {
+      let cellCounts = SIMD3(crossSize, crossSize, 2)
+      let lowerBound = (crossSize - crossThickness) / 2
+      let upperBound = (crossSize + crossThickness) / 2
+      let arm = lowerBound..<upperBound
+      var atoms = SyntheticLattice.createAtoms(
+        cellCounts: cellCounts
+      ) { cell in
+        arm.contains(cell.x) || arm.contains(cell.y)
+      }
+      SyntheticLattice.center(atoms: &atoms)
+      for atomID in atoms.indices {
+        atoms[atomID].z -= 40 + latticeConstant
+      }
+      return atoms
+    }
+    
+    func createBeam() -> [SIMD4<Float>] {
+      let cellCounts = SIMD3(crossThickness, crossSize, beamDepth)
+      var atoms = SyntheticLattice.createAtoms(cellCounts: cellCounts)
+      SyntheticLattice.center(atoms: &atoms)
+      let halfDepth = Float(beamDepth) * latticeConstant / 2
+      for atomID in atoms.indices {
+        atoms[atomID].z += halfDepth - 40
+      }
+      return atoms
+    }
+    
+    // The beam is rebuilt from its initial pose every frame, so rounding
+    // errors do not accumulate.
+    var cross: [SIMD4<Float>] = []
+    var beam: [SIMD4<Float>] = []
+    var output = BenchmarkScene(
+      name: "rotating-beam-\(beamDepth)",
+      description: "Beam of depth \(beamDepth) rotating above a cross",
+      addressSpaceSize: 4_000_000,
+      voxelAllocationSize: 500_000_000,
+      worldDimension: 128,
+      cameraPosition: SIMD3(0, 0, 40),
+      createAtoms: {
+        cross = createCross()
+        beam = createBeam()
+        return cross + beam
+      })
+    output.animate = { frameID, atoms in
+      let angle = 3 * Float(frameID) * Float.pi / 180
+      let cosine = cos(angle)
+      let sine = sin(angle)
+      let offset = cross.count
+      for atomID in beam.indices {
+        var atom = beam[atomID]
+        let x = atom.x * cosine - atom.y * sine
+        let y = atom.x * sine + atom.y * cosine
+        atom.x = x
+        atom.y = y
+        atoms[offset + atomID] = atom
+      }
+    }
+    return output
+  }
+  
+  // A cube of lattice in front of the camera. After the first frame, only the
+  // render stage has any work.
+  static func staticLattice(latticeSize: Int) -> BenchmarkScene {
+    let extent = Float(latticeSize) * SyntheticLattice.latticeConstant
+    return BenchmarkScene(
+      name: "static-lattice-\(latticeSize)",
+      description: "Static cube of \(latticeSize)^3 unit cells",
+      addressSpaceSize: 8 * latticeSize * latticeSize * latticeSize + 512,
+      voxelAllocationSize: 500_000_000,
+      worldDimension: 64,
+      cameraPosition: SIMD3(0, 0, 1.5 * extent),
+      createAtoms: {
+        let cellCounts = SIMD3(repeating: latticeSize)
+        var atoms = SyntheticLattice.createAtoms(cellCounts: cellCounts)
+        SyntheticLattice.center(atoms: &atoms)
+        return atoms
+      })
+  }
+  
+  // The same cube, moving back and forth along X. Every atom is moved in
+  // every frame, and most cross into a different voxel along the way.
+  static func translatingLattice(latticeSize: Int) -> BenchmarkScene {
+    let extent = Float(latticeSize) * SyntheticLattice.latticeConstant
+    var initialAtoms: [SIMD4<Float>] = []
+    var output = BenchmarkScene(
+      name: "translating-lattice-\(latticeSize)",
+      description: "Cube of \(latticeSize)^3 unit cells moving along X",
+      addressSpaceSize: 8 * latticeSize * latticeSize * latticeSize + 512,
+      voxelAllocationSize: 500_000_000,
+      worldDimension: 64,
+      cameraPosition: SIMD3(0, 0, 1.5 * extent),
+      createAtoms: {
+        let cellCounts = SIMD3(repeating: latticeSize)
+        initialAtoms = SyntheticLattice.createAtoms(cellCounts: cellCounts)
+        SyntheticLattice.center(atoms: &initialAtoms)
+        return initialAtoms
+      })
+    output.animate = { frameID, atoms in
+      // Period of 240 frames, amplitude of 2 nm.
+      let phase = Float(frameID) * 2 * Float.pi / 240
+      let displacement = 2 * sin(phase)
+      for atomID in initialAtoms.indices {
+        var atom = initialAtoms[atomID]
+        atom.x += displacement
+        atoms[atomID] = atom
+      }
+    }
+    return output
+  }
+  
+  // A grid of 8 x 8 x 8 small cubes that fills the world, viewed from the
+  // center. Most of the atoms are far from the camera, where rays take long
+  // paths through empty space.
+  static func longDistances(worldDimension: Int) -> BenchmarkScene {
+    let gridSize: Int = 8
+    let cubeSize: Int = 8
+    let spacing = Float(worldDimension) / Float(gridSize)
+    let cubeAtomCount = 8 * cubeSize * cubeSize * cubeSize
+    let atomCount = gridSize * gridSize * gridSize * cubeAtomCount
+    return BenchmarkScene(
+      name: "long-distances-\(worldDimension)",
+      description: "Grid of cubes filling a \(worldDimension) nm world",
+      addressSpaceSize: atomCount + 512,
+      voxelAllocationSize: worldDimension > 128 ? 1_500_000_000 : 500_000_000,
+      worldDimension: Float(worldDimension),
+      cameraPosition: SIMD3(0, 0, spacing / 2),
+      createAtoms: {
+        var cube = SyntheticLattice.createAtoms(
+          cellCounts: SIMD3(repeating: cubeSize))
+        SyntheticLattice.center(atoms: &cube)
+        
+        var atoms: [SIMD4<Float>] = []
+        atoms.reserveCapacity(atomCount)
+        for z in 0..<gridSize {
+          for y in 0..<gridSize {
+            for x in 0..<gridSize {
+              let cell = SIMD3<Float>(SIMD3(x, y, z))
+              var center = (cell + 0.5) * spacing
+              center -= Float(worldDimension) / 2
+              for atom in cube {
+                atoms.append(atom + SIMD4(center, 0))
+              }
+            }
+          }
+        }
+        return atoms
+      })
+  }
+}
@@ -0,0 +1,61 @@
+// Silicon carbide in the zinc blende structure, generated without HDL. The
+// scenes only need plausible atom densities, and this keeps every scene
+// deterministic and quick to rebuild.
+public enum SyntheticLattice {
+  // Matches the cubic lattice constant of '.checkerboard(.silicon, .carbon)'.
+  public static var latticeConstant: Float { 0.4359 }
+  
+  private static var siliconSites: [SIMD3<Float>] {
+    [
+      SIMD3(0.00, 0.00, 0.00),
+      SIMD3(0.00, 0.50, 0.50),
+      SIMD3(0.50, 0.00, 0.50),
+      SIMD3(0.50, 0.50, 0.00),
+    ]
+  }
+  
+  // Atoms of every unit cell in [0, cellCounts) that passes the filter.
+  // Positions are in nanometers, and the fourth component is the atomic
+  // number.
+  public static func createAtoms(
+    cellCounts: SIMD3<Int>,
+    isIncluded: (SIMD3<Int>) -> Bool = { _ in true }
+  ) -> [SIMD4<Float>] {
+    var output: [SIMD4<Float>] = []
+    for z in 0..<cellCounts[2] {
+      for y in 0..<cellCounts[1] {
+        for x in 0..<cellCounts[0] {
+          let cell = SIMD3(x, y, z)
+          guard isIncluded(cell) else {
+            continue
+          }
+          
+          let origin = SIMD3<Float>(cell)
+          for site in siliconSites {
+            let silicon = (origin + site) * latticeConstant
+            let carbon = (origin + site + 0.25) * latticeConstant
+            output.append(SIMD4(silicon, 14))
+            output.append(SIMD4(carbon, 6))
+          }
+        }
+      }
+    }
+    return output
+  }
+  
+  // Shifts the atoms so their bounding box is centered at the origin.
+  public static func center(atoms: inout [SIMD4<Float>]) {
+    var minimum = SIMD3<Float>(repeating: .greatestFiniteMagnitude)
+    var maximum = SIMD3<Float>(repeating: -.greatestFiniteMagnitude)
+    for atom in atoms {
+      let position = SIMD3(atom.x, atom.y, atom.z)
+      minimum.replace(with: position, where: position .< minimum)
+      maximum.replace(with: position, where: position .> maximum)
+    }
+    
+    let center = (minimum + maximum) / 2
+    for atomID in atoms.indices {
+      atoms[atomID] -= SIMD4(center, 0)
+    }
+  }
+}
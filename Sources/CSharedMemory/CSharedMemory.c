@@ -0,0 +1,7 @@
+#include <CSharedMemory.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+
+int shared_memory_open(const char *name, int flags, unsigned int mode) {
+  return shm_open(name, flags, (mode_t)mode);
+}
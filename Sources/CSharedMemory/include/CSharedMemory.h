@@ -0,0 +1,8 @@
+#ifndef CSHAREDMEMORY_H
+#define CSHAREDMEMORY_H
+
+// 'shm_open' is variadic, so Swift cannot call it directly. This wrapper
+// takes the mode as a fixed argument.
+int shared_memory_open(const char *name, int flags, unsigned int mode);
+
+#endif
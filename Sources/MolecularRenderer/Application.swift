@@ -1,3 +1,8 @@
+import Dispatch
+import class Foundation.ProcessInfo
+
+// 'Atoms', 'SharedAtomWriter', and 'TraceRecorder' are part of the public API.
+@_exported import MolecularRendererCPU
 #if os(Windows)
 import SwiftCOM
 import WinSDK
@@ -12,6 +17,46 @@ public struct ApplicationDescriptor {
   public var voxelAllocationSize: Int?
   public var worldDimension: Float?
   
+  /// Optional 128 nm level of the occupancy hierarchy, which lets rays skip
+  /// long stretches of empty space in large worlds. Requires the world
+  /// dimension to be divisible by 256.
+  public var usesCoarseOccupancy: Bool = false
+  
+  /// Number of threads for the CPU work of each frame, including the thread
+  /// that calls 'render()'. Defaults to the number of active cores.
+  public var workerThreadCount: Int?
+  
+  /// Whether to pin each worker thread to its own core. Pinning is not
+  /// supported on macOS, which does not expose thread affinity. The option
+  /// is ignored there.
+  public var pinsWorkerThreads: Bool = false
+  
+  /// Whether to touch every page of the CPU-side atom arrays during startup,
+  /// in parallel across the worker threads. Otherwise, each page is backed
+  /// by physical memory the first time an address in its range is written.
+  /// Each worker touches the range it scans in 'registerChanges()', so on
+  /// NUMA systems the pages land on that worker's node. Combine with
+  /// 'pinsWorkerThreads' to keep the workers on their nodes.
+  public var prefaultsAtomMemory: Bool = false
+  
+  /// Whether to request large pages for the CPU-side atom arrays, reducing
+  /// TLB misses in the per-frame scan. Falls back to regular pages if the OS
+  /// refuses, and prints a message. On Windows, the account needs the "Lock
+  /// pages in memory" right. The library enables the privilege itself.
+  /// Apple silicon has no large pages.
+  public var usesLargeAtomPages: Bool = false
+  
+  /// Optional name of a shared memory region for the atoms. Another process
+  /// writes them through 'SharedAtomWriter', and 'application.atoms'
+  /// becomes read-only. On macOS, the name must be shorter than 31 bytes.
+  public var sharedMemoryName: String?
+  
+  /// Optional mode that registers and uploads the atoms on a worker thread,
+  /// while the GPU executes the previous frame. Edits appear one frame later
+  /// than usual. Accessing 'application.atoms' stalls until the worker has
+  /// finished with them.
+  public var pipelinesTransactions: Bool = false
+  
   public init() {
     
   }
@@ -29,6 +74,13 @@ public class Application {
   var runLoop: RunLoop?
   public internal(set) var frameID: Int
   
+  // Dense voxels that spilled into continuation chunks. Lags the frame being
+  // encoded by 3 frames, like the crash buffer it is read from.
+  public internal(set) var overflowStatistics = OverflowStatistics()
+  
+  // Latency histograms for the stages of the frame.
+  public let telemetry: Telemetry
+  
   // Low-level display interfacing
   var window: Window?
   #if os(macOS)
@@ -46,6 +98,11 @@ public class Application {
   let bvhBuilder: BVHBuilder
   let imageResources: ImageResources
   
+  // Prepares the transaction of the next frame, in pipelined mode.
+  let pipelinesTransactions: Bool
+  let transactionQueue: DispatchQueue
+  var pipelinedTransaction: PipelinedTransaction?
+  
   @MainActor
   public init(descriptor: ApplicationDescriptor) {
     guard let device = descriptor.device,
@@ -66,12 +123,29 @@ public class Application {
       }
     }
     
+    // Replace the default worker pool, before any frame uses it.
+    if descriptor.workerThreadCount != nil || descriptor.pinsWorkerThreads {
+      let defaultCount = ProcessInfo.processInfo.activeProcessorCount
+      WorkerPool.shared.shutdown()
+      WorkerPool.shared = WorkerPool(
+        workerCount: descriptor.workerThreadCount ?? defaultCount,
+        pinsThreads: descriptor.pinsWorkerThreads)
+    }
+    
     // Set up the public API.
     self.device = device
     self.display = display
-    self.atoms = Atoms(addressSpaceSize: addressSpaceSize)
+    self.atoms = Atoms(
+      addressSpaceSize: addressSpaceSize,
+      prefaultsMemory: descriptor.prefaultsAtomMemory,
+      usesLargePages: descriptor.usesLargeAtomPages,
+      sharedMemoryName: descriptor.sharedMemoryName)
     self.camera = Camera(isOffline: display.isOffline)
     self.clock = Clock(display: display)
+    self.telemetry = Telemetry()
+    self.pipelinesTransactions = descriptor.pipelinesTransactions
+    self.transactionQueue = DispatchQueue(
+      label: "Application.transactionQueue", qos: .userInteractive)
     
     // Initialize the frame ID.
     if !display.isOffline {
@@ -107,6 +181,7 @@ public class Application {
     var bvhBuilderDesc = BVHBuilderDescriptor()
     bvhBuilderDesc.addressSpaceSize = atoms.addressSpaceSize
     bvhBuilderDesc.device = device
+    bvhBuilderDesc.usesCoarseOccupancy = descriptor.usesCoarseOccupancy
     bvhBuilderDesc.voxelAllocationSize = voxelAllocationSize
     bvhBuilderDesc.worldDimension = worldDimension
     self.bvhBuilder = BVHBuilder(descriptor: bvhBuilderDesc)
@@ -116,6 +191,7 @@ public class Application {
     imageResourcesDesc.display = display
     imageResourcesDesc.memorySlotCount = bvhBuilder.voxels.memorySlotCount
     imageResourcesDesc.upscaleFactor = upscaleFactor
+    imageResourcesDesc.usesCoarseOccupancy = descriptor.usesCoarseOccupancy
     imageResourcesDesc.worldDimension = worldDimension
     self.imageResources = ImageResources(descriptor: imageResourcesDesc)
 
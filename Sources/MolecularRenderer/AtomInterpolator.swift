@@ -0,0 +1,212 @@
+import MolecularRendererCPU
+
+/// Plays back a simulation that produces snapshots slower than the display
+/// refreshes, by interpolating between the most recent snapshots.
+///
+/// Times are measured in display frames, the same units as 'clock.frames'.
+/// Every frame, write the positions for a time one snapshot interval behind
+/// the clock, so the next snapshot usually arrives before playback reaches
+/// the current one:
+///
+/// ```swift
+/// let delay = Double(application.display.frameRate) / simulationRate
+/// let time = Double(application.clock.frames) - delay
+/// interpolator.write(time: time, into: application.atoms)
+/// ```
+///
+/// Playback never extrapolates. Times past the newest snapshot hold it in
+/// place, until the simulation catches up.
+///
+/// The interpolator covers a contiguous range of addresses, and every atom in
+/// the range is present. The fourth component (atomic number) is taken from
+/// the newest snapshot.
+public final class AtomInterpolator {
+  public enum Order {
+    /// Straight lines between the two newest snapshots.
+    case linear
+    
+    /// Cubic Hermite curves through the three newest snapshots. Velocity is
+    /// continuous across snapshots, at the cost of one more buffer.
+    case cubic
+    
+    var snapshotCount: Int {
+      switch self {
+      case .linear: return 2
+      case .cubic: return 3
+      }
+    }
+  }
+  
+  public let addressRange: Range<Int>
+  public let order: Order
+  
+  // Oldest snapshot first. The buffers rotate as snapshots arrive.
+  private var snapshots: [UnsafeMutableBufferPointer<SIMD4<Float>>]
+  private var times: [Double] = []
+  private let output: UnsafeMutableBufferPointer<SIMD4<Float>>
+  
+  // Skips the kernel when nothing would change since the last write.
+  private var previousWeights: SIMD3<Float>?
+  
+  public init(addressRange: Range<Int>, order: Order = .linear) {
+    guard addressRange.lowerBound >= 0 else {
+      fatalError("Address range must not be negative.")
+    }
+    self.addressRange = addressRange
+    self.order = order
+    
+    func allocate() -> UnsafeMutableBufferPointer<SIMD4<Float>> {
+      let output = UnsafeMutableBufferPointer<SIMD4<Float>>
+        .allocate(capacity: addressRange.count)
+      output.initialize(repeating: .zero)
+      return output
+    }
+    self.snapshots = (0..<order.snapshotCount).map { _ in allocate() }
+    self.output = allocate()
+  }
+  
+  deinit {
+    for snapshot in snapshots {
+      snapshot.deallocate()
+    }
+    output.deallocate()
+  }
+  
+  /// Number of snapshots currently held, up to 2 (linear) or 3 (cubic).
+  public var snapshotCount: Int {
+    times.count
+  }
+  
+  /// Time of the newest snapshot, if there is one.
+  public var latestTime: Double? {
+    times.last
+  }
+  
+  /// Adds a snapshot, replacing the oldest one. 'closure' writes every
+  /// position in the range, in the order of the addresses. Times must
+  /// increase from one snapshot to the next.
+  public func append(
+    time: Double,
+    _ closure: (UnsafeMutableBufferPointer<SIMD4<Float>>) -> Void
+  ) {
+    if let latestTime, time <= latestTime {
+      fatalError("Snapshot time did not increase.")
+    }
+    
+    let snapshot = snapshots.removeFirst()
+    closure(snapshot)
+    snapshots.append(snapshot)
+    times.append(time)
+    if times.count > order.snapshotCount {
+      times.removeFirst()
+    }
+    previousWeights = nil
+  }
+  
+  /// Writes the positions for 'time' into 'atoms', before 'render()'.
+  /// Returns false if there are no snapshots yet, or the positions are the
+  /// same as the previous call.
+  ///
+  /// Only positions that differ from the ones already in 'atoms' are
+  /// written. Atoms that stayed still across the snapshots keep their exact
+  /// position, so they stay out of the next transaction.
+  @discardableResult
+  public func write(time: Double, into atoms: Atoms) -> Bool {
+    guard times.count > 0 else {
+      return false
+    }
+    let weights = createWeights(time: time)
+    guard weights != previousWeights else {
+      return false
+    }
+    previousWeights = weights
+    
+    interpolate(
+      weights: weights,
+      taskSize: atoms.taskSize,
+      threadCount: atoms.threadCount)
+    atoms.update(
+      positions: UnsafeBufferPointer(output),
+      startAddress: addressRange.lowerBound)
+    return true
+  }
+}
+
+extension AtomInterpolator {
+  // Weights of the three newest buffers, oldest first. Buffers without a
+  // snapshot have a weight of zero.
+  //
+  // Between snapshots 1 and 2, the cubic Hermite curve uses the tangent
+  // (p2 - p0) / (t2 - t0) at p1, and (p2 - p1) / (t2 - t1) at p2. It is
+  // linear in the positions, so every atom shares the same three weights.
+  private func createWeights(time: Double) -> SIMD3<Float> {
+    let count = times.count
+    guard count >= 2 else {
+      return SIMD3(0, 0, 1)
+    }
+    let t1 = times[count - 2]
+    let t2 = times[count - 1]
+    var u = (time - t1) / (t2 - t1)
+    u = max(0, min(u, 1))
+    
+    guard count == 3 else {
+      return SIMD3(0, Float(1 - u), Float(u))
+    }
+    let t0 = times[0]
+    let h00 = 2 * u * u * u - 3 * u * u + 1
+    let h10 = u * u * u - 2 * u * u + u
+    let h01 = -2 * u * u * u + 3 * u * u
+    let h11 = u * u * u - u * u
+    let scale = h10 * (t2 - t1) / (t2 - t0)
+    return SIMD3(
+      Float(-scale),
+      Float(h00 - h11),
+      Float(scale + h01 + h11))
+  }
+  
+  // Computes every position into 'output', in parallel.
+  private func interpolate(
+    weights: SIMD3<Float>,
+    taskSize: Int,
+    threadCount: Int?
+  ) {
+    let atomCount = addressRange.count
+    let taskCount = (atomCount + taskSize - 1) / taskSize
+    
+    // In linear mode, the oldest buffer doubles as snapshot 1, with a weight
+    // of zero.
+    let count = snapshots.count
+    nonisolated(unsafe)
+    let safeSnapshot0 = snapshots[max(count - 3, 0)]
+    nonisolated(unsafe)
+    let safeSnapshot1 = snapshots[count - 2]
+    nonisolated(unsafe)
+    let safeSnapshot2 = snapshots[count - 1]
+    nonisolated(unsafe)
+    let safeOutput = output
+    WorkerPool.shared.perform(
+      iterations: taskCount, maxWorkerCount: threadCount
+    ) { taskID in
+      let start = taskID * taskSize
+      let end = min(start + taskSize, atomCount)
+      for atomID in start..<end {
+        let p0 = safeSnapshot0[atomID]
+        let p1 = safeSnapshot1[atomID]
+        let p2 = safeSnapshot2[atomID]
+        
+        // Floating-point error would otherwise nudge still atoms. Buffers
+        // without a snapshot yet have a weight of zero.
+        var position = p2
+        let isMoving0 = weights[0] != 0 && p0 != p2
+        let isMoving1 = weights[1] != 0 && p1 != p2
+        if isMoving0 || isMoving1 {
+          position = weights[0] * p0
+          position += weights[1] * p1
+          position += weights[2] * p2
+          position.w = p2.w
+        }
+        safeOutput[atomID] = position
+      }
+    }
+  }
+}
@@ -0,0 +1,85 @@
+import MolecularRendererCPU
+import Synchronization
+
+/// Hands complete sets of positions from a simulation thread to the render
+/// loop, without either side waiting on the other.
+///
+/// Three buffers rotate between the simulation, the render loop, and a shared
+/// slot. The simulation fills its buffer, then swaps it with the shared slot.
+/// The render loop swaps its buffer with the shared slot, only when a newer
+/// set was published. Sets the render loop never saw are overwritten, not
+/// queued, so it always consumes the newest one.
+///
+/// The channel covers a contiguous range of addresses, and every atom in the
+/// range is present.
+public final class AtomSnapshotChannel: @unchecked Sendable {
+  public let addressRange: Range<Int>
+  
+  private let buffers: [UnsafeMutableBufferPointer<SIMD4<Float>>]
+  
+  // Index of the buffer in the shared slot, plus a flag for whether it was
+  // published after the render loop last consumed.
+  private let sharedState: Atomic<Int>
+  private static var freshFlag: Int { 4 }
+  
+  // Only touched by the publishing thread.
+  private var backIndex: Int = 0
+  
+  // Only touched by the consuming thread.
+  private var frontIndex: Int = 1
+  
+  public init(addressRange: Range<Int>) {
+    guard addressRange.lowerBound >= 0 else {
+      fatalError("Address range must not be negative.")
+    }
+    self.addressRange = addressRange
+    self.buffers = (0..<3).map { _ in
+      let output = UnsafeMutableBufferPointer<SIMD4<Float>>
+        .allocate(capacity: addressRange.count)
+      output.initialize(repeating: .zero)
+      return output
+    }
+    self.sharedState = Atomic(2)
+  }
+  
+  deinit {
+    for buffer in buffers {
+      buffer.deallocate()
+    }
+  }
+  
+  /// Simulation thread only. 'closure' writes every position in the range,
+  /// in the order of the addresses. Afterward, the set becomes visible to
+  /// the next call to 'consume(into:)'.
+  public func publish(
+    _ closure: (UnsafeMutableBufferPointer<SIMD4<Float>>) -> Void
+  ) {
+    closure(buffers[backIndex])
+    let previousState = sharedState.exchange(
+      backIndex | Self.freshFlag, ordering: .acquiringAndReleasing)
+    backIndex = previousState & 3
+  }
+  
+  /// Render thread only, before 'render()'. Writes the newest published set
+  /// into 'atoms'. Returns false if nothing was published since the last
+  /// call.
+  ///
+  /// Only positions that differ from the ones already in 'atoms' are
+  /// written, so unchanged atoms stay out of the next transaction.
+  @discardableResult
+  public func consume(into atoms: Atoms) -> Bool {
+    // Only this thread clears the flag, so it cannot change before the swap.
+    let state = sharedState.load(ordering: .relaxed)
+    guard state & Self.freshFlag != 0 else {
+      return false
+    }
+    let previousState = sharedState.exchange(
+      frontIndex, ordering: .acquiringAndReleasing)
+    frontIndex = previousState & 3
+    
+    atoms.update(
+      positions: UnsafeBufferPointer(buffers[frontIndex]),
+      startAddress: addressRange.lowerBound)
+    return true
+  }
+}
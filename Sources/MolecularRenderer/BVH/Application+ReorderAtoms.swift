@@ -0,0 +1,106 @@
+import MolecularRendererCPU
+
+// Transient GPU memory for renaming the address space. Allocated for a single
+// reorder, then released after the command queue is flushed.
+struct ReorderScratch {
+  let permutation: Buffer
+  let atoms: Buffer
+  let motionVectors: Buffer
+  let addressOccupiedMarks: Buffer
+  
+  // Input buffer for the permutation on Windows.
+  #if os(Windows)
+  let permutationInput: Buffer
+  #endif
+  
+  init(device: Device, addressSpaceSize: Int) {
+    func createBuffer(size: Int) -> Buffer {
+      var bufferDesc = BufferDescriptor()
+      bufferDesc.device = device
+      bufferDesc.size = size
+      bufferDesc.type = .native(.device)
+      return Buffer(descriptor: bufferDesc)
+    }
+    
+    self.permutation = createBuffer(size: addressSpaceSize * 4)
+    self.atoms = createBuffer(size: addressSpaceSize * 16)
+    self.motionVectors = createBuffer(size: addressSpaceSize * 16)
+    self.addressOccupiedMarks = createBuffer(size: addressSpaceSize * 4)
+    
+    #if os(Windows)
+    var bufferDesc = BufferDescriptor()
+    bufferDesc.device = device
+    bufferDesc.size = addressSpaceSize * 4
+    bufferDesc.type = .input
+    self.permutationInput = Buffer(descriptor: bufferDesc)
+    #endif
+  }
+}
+
+extension Application {
+  /// Renumber the atoms along a Morton curve through their positions, so
+  /// atoms close in space are close in memory. Ray-sphere tests and the BVH
+  /// rebuild then gather atoms from far fewer cache lines.
+  ///
+  /// Returns the new address of every old address:
+  /// `newID = permutation[oldID]`. Update any indices you keep into
+  /// `application.atoms` with it. Occupied atoms are packed to the front of
+  /// the address space. Pending edits, motion vectors, and the previous-frame
+  /// state move along with their atoms.
+  ///
+  /// This is an expensive, infrequent operation. It allocates ~40 bytes per
+  /// address of temporary GPU memory and stalls until the GPU has finished.
+  /// Call it between frames, for example after loading a scene. With
+  /// pipelined transactions, call it before the first frame.
+  public func reorderAtoms() -> [UInt32] {
+    // The prepared transaction refers to the old addresses.
+    guard pipelinedTransaction == nil else {
+      fatalError("Cannot reorder atoms while a transaction is pipelined.")
+    }
+    guard atoms.sharedGeneration == nil else {
+      fatalError("Cannot reorder atoms written by another process.")
+    }
+    let permutation = atoms.createMortonPermutation()
+    atoms.permute(permutation)
+    
+    let scratch = ReorderScratch(
+      device: device,
+      addressSpaceSize: bvhBuilder.atoms.addressSpaceSize)
+    permutation.withUnsafeBytes { bufferPointer in
+      #if os(macOS)
+      scratch.permutation.write(input: bufferPointer)
+      #else
+      scratch.permutationInput.write(input: bufferPointer)
+      #endif
+    }
+    
+    device.commandQueue.withCommandList { commandList in
+      #if os(Windows)
+      commandList.upload(
+        inputBuffer: scratch.permutationInput,
+        nativeBuffer: scratch.permutation)
+      
+      // Bind the descriptor heap.
+      commandList.setDescriptorHeap(descriptorHeap)
+      #endif
+      
+      bvhBuilder.reorderProcess1(
+        commandList: commandList,
+        scratch: scratch,
+        phase: 0)
+      bvhBuilder.reorderProcess1(
+        commandList: commandList,
+        scratch: scratch,
+        phase: 1)
+      bvhBuilder.reorderProcess2(
+        commandList: commandList,
+        scratch: scratch)
+    }
+    
+    // Keep the scratch memory alive until the GPU is done with it.
+    device.commandQueue.flush()
+    withExtendedLifetime(scratch) { }
+    
+    return permutation
+  }
+}
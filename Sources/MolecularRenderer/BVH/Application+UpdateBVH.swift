@@ -1,36 +1,10 @@
+import MolecularRendererCPU
 #if os(Windows)
 import SwiftCOM
 import WinSDK
 #endif
 
-struct PerformanceMeter {
-  var minimum: Int = .max
-  
-  mutating func integrate(_ measurement: Int) {
-    if measurement < minimum {
-      minimum = measurement
-    }
-  }
-  
-  static func pad(_ latency: Int) -> String {
-    var output = "\(latency)"
-    while output.count < 5 {
-      output = " " + output
-    }
-    return output
-  }
-}
-
 extension Application {
-  nonisolated(unsafe)
-  private static var updateMeter = PerformanceMeter()
-  nonisolated(unsafe)
-  private static var renderMeter = PerformanceMeter()
-  nonisolated(unsafe)
-  private static var forgetMeter = PerformanceMeter()
-  nonisolated(unsafe)
-  private static var upscaleMeter = PerformanceMeter()
-  
   func checkCrashBuffer(frameID: Int) {
     if frameID >= 3 {
       let elementCount = CounterResources.crashBufferSize / 4
@@ -51,6 +25,8 @@ extension Application {
         
         fatalError(crashInfo.message)
       }
+      
+      overflowStatistics = OverflowStatistics(crashBufferContents: output)
     }
   }
   
@@ -64,9 +40,16 @@ extension Application {
         destinationBuffer.read(output: bufferPointer)
       }
       
+      // Stages skipped in the next frame of this slot will read zero.
+      let resolvedStages = bvhBuilder.counters.resolvedStages[frameID % 3]
+      bvhBuilder.counters.resolvedStages[frameID % 3] = .zero
+      
       let timestampFrequency = try! device.commandQueue.d3d12CommandQueue
         .GetTimestampFrequency()
       func latencyMicroseconds(startIndex: Int) -> Int {
+        guard resolvedStages[startIndex / 2] > 0 else {
+          return 0
+        }
         let startCounter = output[startIndex]
         let endCounter = output[startIndex + 1]
         var elapsedTime = Double(endCounter - startCounter)
@@ -79,6 +62,30 @@ extension Application {
       let renderLatency = latencyMicroseconds(startIndex: 2)
       let forgetLatency = latencyMicroseconds(startIndex: 4)
       let upscaleLatency = latencyMicroseconds(startIndex: 6)
+      
+      // Map the GPU ticks onto the host timeline of the CPU spans.
+      if TraceRecorder.isEnabled {
+        let (gpuTimestamp, cpuTimestamp) = try! device.commandQueue
+          .d3d12CommandQueue.GetClockCalibration()
+        func hostTime(gpuCounter: UInt64) -> UInt64 {
+          var elapsedTime = Double(gpuCounter) - Double(gpuTimestamp)
+          elapsedTime /= Double(timestampFrequency)
+          let calibrationTime = TraceRecorder
+            .hostTime(performanceCounter: cpuTimestamp)
+          return UInt64(Double(calibrationTime) + elapsedTime * 1e9)
+        }
+        
+        let stages = ["update", "render", "forget", "upscale"]
+        for (stageID, stage) in stages.enumerated()
+        where resolvedStages[stageID] > 0 {
+          let startCounter = output[2 * stageID]
+          let endCounter = output[2 * stageID + 1]
+          TraceRecorder.recordGPU(
+            stage,
+            startTime: hostTime(gpuCounter: startCounter),
+            endTime: hostTime(gpuCounter: endCounter))
+        }
+      }
       #else
       var updateLatency: Int = 0
       var renderLatency: Int = 0
@@ -93,27 +100,146 @@ extension Application {
           .forgetLatencies[frameID % 3]
         upscaleLatency = bvhBuilder.counters
           .upscaleLatencies[frameID % 3]
+        
+        // Stages skipped in the next frame of this slot will read zero.
+        bvhBuilder.counters.updateLatencies[frameID % 3] = 0
+        bvhBuilder.counters.renderLatencies[frameID % 3] = 0
+        bvhBuilder.counters.forgetLatencies[frameID % 3] = 0
+        bvhBuilder.counters.upscaleLatencies[frameID % 3] = 0
       }
       #endif
       
-      // Edit the template below to inspect GPU-side performance.
-      
-      // WARNING: While benchmarking rendering performance, avoid taking
-      // samples while the scene is still loading. This gives misleading
-      // opportunities for minima when the scene is mostly empty.
-      guard frameID > 60 else {
-        return
+      // Query 'telemetry' to inspect GPU-side performance. Zero means the
+      // stage did not run, for example the update of a static frame.
+      let latencies: [(Int, TelemetryStage)] = [
+        (updateLatency, .update),
+        (renderLatency, .render),
+        (forgetLatency, .forget),
+        (upscaleLatency, .upscale),
+      ]
+      for (latency, stage) in latencies where latency > 0 {
+        telemetry.record(latency, stage: stage, frameID: frameID)
+      }
+    }
+  }
+  
+  private static func isEmpty(_ transaction: [Atoms.Transaction]) -> Bool {
+    transaction.allSatisfy { chunk in
+      chunk.removedCount == 0 &&
+      chunk.movedCount == 0 &&
+      chunk.addedCount == 0
+    }
+  }
+  
+  // The transaction of the next frame, prepared on 'transactionQueue'. The
+  // fields are written by the worker, and read only after the atoms were
+  // reclaimed.
+  final class PipelinedTransaction: @unchecked Sendable {
+    let frameID: Int
+    var transaction: [Atoms.Transaction] = []
+    var transactionArgs: TransactionArgs?
+    
+    init(frameID: Int) {
+      self.frameID = frameID
+    }
+  }
+  
+  // Registers the changes, and writes them into the in-flight slot. Returns
+  // nil if the update can be skipped.
+  private func prepareTransaction(
+    frameID: Int,
+    inFlightFrameID: Int,
+    hasUpdated: Bool
+  ) -> ([Atoms.Transaction], TransactionArgs)? {
+    let transaction = telemetry.measure(
+      stage: .registerChanges, frameID: frameID
+    ) {
+      atoms.registerChanges()
+    }
+    
+    // Nothing to encode if no atoms changed. The acceleration structure from
+    // the previous frame is still valid, and 'transactionArgs' stays nil.
+    // The first update always runs, to initialize the per-frame marks.
+    if hasUpdated, Self.isEmpty(transaction) {
+      return nil
+    }
+    
+    let transactionArgs = telemetry.measure(
+      stage: .upload, frameID: frameID
+    ) {
+      bvhBuilder.writeTransaction(
+        transaction: transaction,
+        inFlightFrameID: inFlightFrameID)
+    }
+    return (transaction, transactionArgs)
+  }
+  
+  // Pipelined transactions only. Hands the atoms to 'transactionQueue', which
+  // prepares the transaction of the next frame while the GPU executes this
+  // one. Call after the last command list of the frame was committed.
+  func launchPipelinedTransaction() {
+    guard pipelinesTransactions else {
+      return
+    }
+    
+    // Offline rendering has already incremented the frame ID.
+    let nextFrameID = display.isOffline ? frameID : frameID + 1
+    let inFlightFrameID = nextFrameID % 3
+    let pipelinedTransaction = PipelinedTransaction(frameID: nextFrameID)
+    self.pipelinedTransaction = pipelinedTransaction
+    
+    // The slot may still be read by the frame 3 frames before.
+    nonisolated(unsafe)
+    let slotCommandList = bvhBuilder.slotCommandLists[inFlightFrameID]
+    let hasUpdated = bvhBuilder.hasUpdated
+    nonisolated(unsafe)
+    let selfReference = self
+    atoms.lend(queue: transactionQueue) {
+      if let slotCommandList {
+        selfReference.device.commandQueue.waitConcurrently(
+          commandList: slotCommandList)
       }
       
-      Self.updateMeter.integrate(updateLatency)
-      Self.renderMeter.integrate(renderLatency)
-      Self.forgetMeter.integrate(forgetLatency)
-      Self.upscaleMeter.integrate(upscaleLatency)
+      let prepared = selfReference.prepareTransaction(
+        frameID: nextFrameID,
+        inFlightFrameID: inFlightFrameID,
+        hasUpdated: hasUpdated)
+      if let prepared {
+        pipelinedTransaction.transaction = prepared.0
+        pipelinedTransaction.transactionArgs = prepared.1
+      }
     }
   }
   
   func updateBVH(inFlightFrameID: Int) {
-    let transaction = atoms.registerChanges()
+    var prepared: ([Atoms.Transaction], TransactionArgs)?
+    if let pipelinedTransaction {
+      // Take back ownership of the atoms, after the worker has finished.
+      atoms.reclaim()
+      self.pipelinedTransaction = nil
+      
+      if let transactionArgs = pipelinedTransaction.transactionArgs {
+        prepared = (pipelinedTransaction.transaction, transactionArgs)
+      }
+      
+      // The worker guessed the wrong slot, for example because a frame of
+      // the run loop did not call 'render()'. Write the transaction again.
+      if pipelinedTransaction.frameID != frameID, let prepared {
+        _ = bvhBuilder.writeTransaction(
+          transaction: prepared.0,
+          inFlightFrameID: inFlightFrameID)
+      }
+    } else {
+      prepared = prepareTransaction(
+        frameID: frameID,
+        inFlightFrameID: inFlightFrameID,
+        hasUpdated: bvhBuilder.hasUpdated)
+    }
+    guard let transactionArgs = prepared?.1 else {
+      return
+    }
+    bvhBuilder.hasUpdated = true
+    
     device.commandQueue.withCommandList { commandList in
       #if os(Windows)
       try! commandList.d3d12CommandList.EndQuery(
@@ -129,10 +255,13 @@ extension Application {
         commandList: commandList)
       bvhBuilder.setupGeneralCounters(
         commandList: commandList)
-      bvhBuilder.upload(
-        transaction: transaction,
+      #if os(Windows)
+      bvhBuilder.copyTransaction(
+        transactionArgs: transactionArgs,
         commandList: commandList,
         inFlightFrameID: inFlightFrameID)
+      #endif
+      bvhBuilder.transactionArgs = transactionArgs
 
       // Encode the remove process.
       bvhBuilder.removeProcess1(
@@ -184,6 +313,7 @@ extension Application {
         2,
         destinationBuffer.d3d12Resource,
         0)
+      bvhBuilder.counters.resolvedStages[inFlightFrameID][0] = 1
       #endif
       
       #if os(macOS)
@@ -197,12 +327,29 @@ extension Application {
           selfReference.bvhBuilder.counters
             .updateLatencies[inFlightFrameID] = latencyMicroseconds
         }
+        TraceRecorder.recordGPU(
+          "update",
+          startSeconds: commandBuffer.gpuStartTime,
+          endSeconds: commandBuffer.gpuEndTime)
       }
       #endif
     }
   }
   
   func forgetIdleState(inFlightFrameID: Int) {
+    // If the BVH update was skipped, only check the render process for
+    // crashes.
+    guard bvhBuilder.transactionArgs != nil else {
+      device.commandQueue.withCommandList { commandList in
+        bvhBuilder.counters.crashBuffer.download(
+          commandList: commandList,
+          inFlightFrameID: inFlightFrameID)
+      }
+      bvhBuilder.slotCommandLists[inFlightFrameID] =
+      device.commandQueue.previousCommandList
+      return
+    }
+    
     device.commandQueue.withCommandList { commandList in
       #if os(Windows)
       try! commandList.d3d12CommandList.EndQuery(
@@ -242,6 +389,7 @@ extension Application {
         2,
         destinationBuffer.d3d12Resource,
         32)
+      bvhBuilder.counters.resolvedStages[inFlightFrameID][2] = 1
       #endif
       
       #if os(macOS)
@@ -255,10 +403,17 @@ extension Application {
           selfReference.bvhBuilder.counters
             .forgetLatencies[inFlightFrameID] = latencyMicroseconds
         }
+        TraceRecorder.recordGPU(
+          "forget",
+          startSeconds: commandBuffer.gpuStartTime,
+          endSeconds: commandBuffer.gpuEndTime)
       }
       #endif
     }
     
+    bvhBuilder.slotCommandLists[inFlightFrameID] =
+    device.commandQueue.previousCommandList
+    
     // Delete the transactionArgs state variable.
     bvhBuilder.transactionArgs = nil
   }
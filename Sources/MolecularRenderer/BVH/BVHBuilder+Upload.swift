@@ -1,4 +1,5 @@
 import Dispatch
+import MolecularRendererCPU
 
 extension BVHBuilder {
   // Reduction over all chunks of the transaction.
@@ -30,8 +31,30 @@ extension BVHBuilder {
   func upload(
     transaction: [Atoms.Transaction],
     commandList: CommandList,
-    inFlightFrameID: Int
+    inFlightFrameID: Int,
+    threadCount: Int? = nil
   ) {
+    let transactionArgs = writeTransaction(
+      transaction: transaction,
+      inFlightFrameID: inFlightFrameID,
+      threadCount: threadCount)
+    #if os(Windows)
+    copyTransaction(
+      transactionArgs: transactionArgs,
+      commandList: commandList,
+      inFlightFrameID: inFlightFrameID)
+    #endif
+    self.transactionArgs = transactionArgs
+  }
+  
+  // The CPU side of the upload. Encodes no commands, so pipelined
+  // transactions call it from a worker thread, once the GPU has finished
+  // reading the in-flight slot.
+  func writeTransaction(
+    transaction: [Atoms.Transaction],
+    inFlightFrameID: Int,
+    threadCount: Int? = nil
+  ) -> TransactionArgs {
     let reduction = TransactionReduction(
       transaction: transaction)
     
@@ -89,7 +112,10 @@ extension BVHBuilder {
     nonisolated(unsafe)
     let safeTransaction = transaction
     let taskCount = transaction.count
-    DispatchQueue.concurrentPerform(iterations: taskCount) { taskID in
+    WorkerPool.shared.perform(
+      iterations: taskCount, maxWorkerCount: threadCount
+    ) { taskID in
+      let traceStartTime = TraceRecorder.startTime()
       let chunk = safeTransaction[taskID]
       let removedOffset = Int(reduction.removedPrefixSum[taskID])
       let movedOffset = Int(reduction.movedPrefixSum[taskID])
@@ -121,34 +147,38 @@ extension BVHBuilder {
       atomsBuffer.write(
         input: addedPositionsPointer,
         offset: (reduction.totalMoved + addedOffset) * 16)
+      TraceRecorder.record("upload chunk", startTime: traceStartTime)
     }
     
-    #if os(Windows)
-    // Dispatch the GPU commands to copy the PCIe data.
-    do {
-      let idsCount =
-      reduction.totalRemoved + reduction.totalMoved + reduction.totalAdded
-      atoms.transactionIDs.copy(
-        commandList: commandList,
-        inFlightFrameID: inFlightFrameID,
-        range: 0..<(idsCount * 4))
-      
-      let atomsCount =
-      reduction.totalMoved + reduction.totalAdded
-      atoms.transactionAtoms.copy(
-        commandList: commandList,
-        inFlightFrameID: inFlightFrameID,
-        range: 0..<(atomsCount * 16))
-    }
-    #endif
+    var transactionArgs = TransactionArgs()
+    transactionArgs.removedCount = UInt32(reduction.totalRemoved)
+    transactionArgs.movedCount = UInt32(reduction.totalMoved)
+    transactionArgs.addedCount = UInt32(reduction.totalAdded)
+    return transactionArgs
+  }
+  
+  #if os(Windows)
+  // Dispatch the GPU commands to copy the PCIe data.
+  func copyTransaction(
+    transactionArgs: TransactionArgs,
+    commandList: CommandList,
+    inFlightFrameID: Int
+  ) {
+    let removedCount = Int(transactionArgs.removedCount)
+    let movedCount = Int(transactionArgs.movedCount)
+    let addedCount = Int(transactionArgs.addedCount)
     
-    // Set the transactionArgs.
-    do {
-      var transactionArgs = TransactionArgs()
-      transactionArgs.removedCount = UInt32(reduction.totalRemoved)
-      transactionArgs.movedCount = UInt32(reduction.totalMoved)
-      transactionArgs.addedCount = UInt32(reduction.totalAdded)
-      self.transactionArgs = transactionArgs
-    }
+    let idsCount = removedCount + movedCount + addedCount
+    atoms.transactionIDs.copy(
+      commandList: commandList,
+      inFlightFrameID: inFlightFrameID,
+      range: 0..<(idsCount * 4))
+    
+    let atomsCount = movedCount + addedCount
+    atoms.transactionAtoms.copy(
+      commandList: commandList,
+      inFlightFrameID: inFlightFrameID,
+      range: 0..<(atomsCount * 16))
   }
+  #endif
 }
@@ -6,6 +6,7 @@ import WinSDK
 struct BVHBuilderDescriptor {
   var addressSpaceSize: Int?
   var device: Device?
+  var usesCoarseOccupancy: Bool = false
   var voxelAllocationSize: Int?
   var worldDimension: Float?
 }
@@ -18,6 +19,13 @@ class BVHBuilder {
   
   var transactionArgs: TransactionArgs?
   
+  // Whether the per-frame marks were initialized by at least one update.
+  var hasUpdated: Bool = false
+  
+  // The last command list of the frame that used each in-flight slot.
+  // Pipelined transactions wait on it before overwriting the slot.
+  var slotCommandLists: [CommandList?] = [nil, nil, nil]
+  
   init(descriptor: BVHBuilderDescriptor) {
     guard let addressSpaceSize = descriptor.addressSpaceSize,
           let device = descriptor.device,
@@ -37,6 +45,7 @@ class BVHBuilder {
     
     var voxelResourcesDesc = VoxelResourcesDescriptor()
     voxelResourcesDesc.device = device
+    voxelResourcesDesc.usesCoarseOccupancy = descriptor.usesCoarseOccupancy
     voxelResourcesDesc.voxelAllocationSize = voxelAllocationSize
     voxelResourcesDesc.worldDimension = worldDimension
     self.voxels = VoxelResources(descriptor: voxelResourcesDesc)
@@ -44,6 +53,7 @@ class BVHBuilder {
     var bvhShadersDesc = BVHShadersDescriptor()
     bvhShadersDesc.device = device
     bvhShadersDesc.memorySlotCount = voxels.memorySlotCount
+    bvhShadersDesc.usesCoarseOccupancy = voxels.usesCoarseOccupancy
     bvhShadersDesc.worldDimension = worldDimension
     self.shaders = BVHShaders(descriptor: bvhShadersDesc)
 
@@ -105,11 +115,22 @@ class BVHBuilder {
         clearValue: UInt32.max,
         clearedBuffer: voxels.sparse.assignedVoxelCoords,
         size: voxels.memorySlotCount * 4)
+      clearBuffer(
+        commandList: commandList,
+        clearValue: UInt32.max,
+        clearedBuffer: voxels.sparse.continuationOwners,
+        size: voxels.sparse.continuationOwners.size)
       
-      // Initialize the crash buffer to 1.
+      // Initialize the crash buffer to 1, and the overflow statistics to 0.
       do {
         let elementCount = CounterResources.crashBufferSize / 4
-        let data = [UInt32](repeating: 1, count: elementCount)
+        var data = [UInt32](repeating: 1, count: elementCount)
+        let statisticsStart = OverflowStatistics.crashBufferOffset
+        let statisticsEnd = statisticsStart +
+        OverflowStatistics.crashBufferElementCount
+        for i in statisticsStart..<statisticsEnd {
+          data[i] = 0
+        }
         counters.crashBuffer.initialize(
           commandList: commandList,
           data: data)
@@ -151,6 +172,13 @@ class BVHBuilder {
       clearValue: 0,
       clearedBuffer: voxels.group.occupiedMarks32,
       size: (voxelGroupCount / 64) * 4)
+    if voxels.usesCoarseOccupancy {
+      clearBuffer(
+        commandList: commandList,
+        clearValue: 0,
+        clearedBuffer: voxels.group.occupiedMarks128,
+        size: (voxelGroupCount / 4096) * 4)
+    }
     
     clearBuffer(
       commandList: commandList,
@@ -2,6 +2,7 @@ enum CrashType {
   case outOfMemory(Int, Int, Int)
   case tooManyAtoms(Int, Int, Int)
   case tooManyReferences(Int)
+  case outOfContinuations(Int)
   case unknown(Int)
 }
 
@@ -60,6 +61,9 @@ class CrashInfo {
     case 4:
       let smallReferenceCount = Int(bufferContents[4])
       self.crashType = .tooManyReferences(smallReferenceCount)
+    case 5:
+      let continuationChunkCount = Int(bufferContents[4])
+      self.crashType = .outOfContinuations(continuationChunkCount)
     default:
       let errorCode = Int(bufferContents[0])
       self.crashType = .unknown(errorCode)
@@ -87,7 +91,12 @@ class CrashInfo {
       case .tooManyReferences(let smallReferenceCount):
         return """
         Voxel had \(smallReferenceCount) 16-bit references.
-        Maximum allowed: 20480
+        Maximum allowed: \(MemorySlot.chainedReference16Capacity)
+        """
+      case .outOfContinuations(let continuationChunkCount):
+        return """
+        Voxel could not borrow a continuation chunk.
+        Continuation chunks: \(continuationChunkCount) (all borrowed)
         """
       case .unknown(let errorCode):
         return """
@@ -0,0 +1,79 @@
+// Bookkeeping for voxels whose 16-bit reference list spilled into
+// continuation chunks. The GPU accumulates these counters in the crash buffer,
+// after the region reserved for diagnostic info. They are downloaded together
+// with the error code, so reading them costs nothing extra.
+public struct OverflowStatistics {
+  // Number of voxels currently linked to at least one continuation chunk.
+  public var chainedVoxelCount: Int = .zero
+  
+  // Number of continuation chunks currently borrowed from the pool.
+  public var continuationChunkCount: Int = .zero
+  
+  // Largest 16-bit reference count of any voxel since application launch.
+  public var peakReferenceCount: Int = .zero
+  
+  public init() {
+    
+  }
+}
+
+extension OverflowStatistics {
+  // Index (in UInt32 elements) of the first counter within the crash buffer.
+  static var crashBufferOffset: Int { 16 }
+  
+  static var crashBufferElementCount: Int { 3 }
+  
+  init(crashBufferContents: [UInt32]) {
+    let offset = Self.crashBufferOffset
+    self.chainedVoxelCount = Int(crashBufferContents[offset + 0])
+    self.continuationChunkCount = Int(crashBufferContents[offset + 1])
+    self.peakReferenceCount = Int(crashBufferContents[offset + 2])
+  }
+  
+  // Negative operands are supported through two's complement wraparound.
+  private static func atomicAdd(index: Int, operand: String) -> String {
+    let address = crashBufferOffset + index
+    
+    #if os(macOS)
+    return """
+    atomic_fetch_add_explicit(
+      (device atomic_uint*)crashBuffer + \(address), // object
+      uint(\(operand)), // operand
+      memory_order_relaxed); // order
+    """
+    #else
+    return """
+    InterlockedAdd(
+      crashBuffer[\(address)], // dest
+      uint(\(operand))); // value
+    """
+    #endif
+  }
+  
+  static func addChainedVoxels(_ operand: String) -> String {
+    atomicAdd(index: 0, operand: operand)
+  }
+  
+  static func addContinuationChunks(_ operand: String) -> String {
+    atomicAdd(index: 1, operand: operand)
+  }
+  
+  static func recordReferenceCount(_ input: String) -> String {
+    let address = crashBufferOffset + 2
+    
+    #if os(macOS)
+    return """
+    atomic_fetch_max_explicit(
+      (device atomic_uint*)crashBuffer + \(address), // object
+      \(input), // operand
+      memory_order_relaxed); // order
+    """
+    #else
+    return """
+    InterlockedMax(
+      crashBuffer[\(address)], // dest
+      \(input)); // value
+    """
+    #endif
+  }
+}
@@ -1,6 +1,7 @@
 // Fixed chunk of memory for each voxel to store its data.
 enum MemorySlot {
   // per 2 nm voxel header
+  // per 2 nm voxel continuation slot IDs
   // per 0.25 nm voxel headers
   case header
   
@@ -14,7 +15,7 @@ enum MemorySlot {
   var size: Int {
     switch self {
     case .header:
-      return (2 + 512) * 4
+      return (4 + 512) * 4
     case .reference32:
       return 3072 * 4
     case .reference16:
@@ -27,7 +28,7 @@ enum MemorySlot {
   var max32BitSlotCount: Int {
     switch self {
     case .header:
-      return 4_000_000_000 / (2 + 512)
+      return 4_000_000_000 / (4 + 512)
     case .reference32:
       return 4_000_000_000 / 3072
     case .reference16:
@@ -58,6 +59,44 @@ enum MemorySlot {
   // for 32-bit overflows of '.header'. This will pose some scaling
   // issues if we implement the more memory-efficient BVH structure.
   
+  // Offset (in bytes) of the continuation slot IDs within a header slot.
+  static var continuationsOffset: Int { 2 * 4 }
+  
   // Offset (in bytes) of the small headers within a header slot.
-  static var smallHeadersOffset: Int { 2 * 4 }
+  static var smallHeadersOffset: Int { 4 * 4 }
+  
+  // Response to dense regions, such as metals and compressed crystals:
+  // A voxel whose 16-bit reference list exceeds one slot borrows up to two
+  // continuation chunks. A chunk only holds 16-bit references, and lives
+  // after the last slot of the references16 buffer. The header stores the
+  // chunk IDs, which address references16 exactly like slot IDs.
+  //
+  // The chain length is capped by the small headers, which store 16-bit
+  // offsets into the concatenated list. Three chunks of 20480 fit under
+  // 65536. Lifting the cap would require 32-bit offsets, doubling the
+  // 2 KB of small headers in every slot, dense or not.
+  //
+  // The 32-bit list is not chained. Its size is set by the atom density,
+  // not by the atom radii, and the add process bounds it at 3072 atoms.
+  static var continuationCount: Int { 2 }
+  
+  // Number of 16-bit references stored across a voxel's chain of chunks.
+  static var chainedReference16Capacity: Int {
+    (1 + continuationCount) * (MemorySlot.reference16.size / 2)
+  }
+  
+  // One continuation chunk for every 16 memory slots. Sized for rare dense
+  // pockets, not for an entire scene of overflowing voxels.
+  static var continuationRatio: Int { 16 }
+  
+  static func continuationChunkCount(memorySlotCount: Int) -> Int {
+    memorySlotCount / continuationRatio
+  }
+  
+  // Number of 20480-reference chunks in the references16 buffer, including
+  // the continuation chunks.
+  static func reference16ChunkCount(memorySlotCount: Int) -> Int {
+    memorySlotCount + continuationChunkCount(
+      memorySlotCount: memorySlotCount)
+  }
 }
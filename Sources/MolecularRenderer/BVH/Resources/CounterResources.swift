@@ -26,6 +26,11 @@ class CounterResources {
   #else
   let queryHeap: SwiftCOM.ID3D12QueryHeap
   var queryDestinationBuffers: [Buffer] = []
+  
+  // Whether each stage resolved its timestamps into the destination buffer
+  // (update, render, forget, upscale). A skipped stage leaves the ticks of
+  // an earlier frame in the buffer.
+  var resolvedStages: [SIMD4<UInt8>] = [.zero, .zero, .zero]
   #endif
   
   init(descriptor: CounterResourcesDescriptor) {
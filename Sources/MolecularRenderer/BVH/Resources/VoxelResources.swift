@@ -5,6 +5,7 @@ import WinSDK
 
 struct VoxelResourcesDescriptor {
   var device: Device?
+  var usesCoarseOccupancy: Bool = false
   var voxelAllocationSize: Int?
   var worldDimension: Float?
 }
@@ -12,6 +13,7 @@ struct VoxelResourcesDescriptor {
 class VoxelResources {
   let worldDimension: Float
   let memorySlotCount: Int
+  let usesCoarseOccupancy: Bool
   
   let group: GroupVoxelResources
   let dense: DenseVoxelResources
@@ -34,6 +36,15 @@ class VoxelResources {
       fatalError("World dimension was zero.")
     }
     self.worldDimension = worldDimension
+    
+    // The 128 nm voxel groups must also be even in count, for the same reason
+    // as the 32 nm voxel groups.
+    if descriptor.usesCoarseOccupancy {
+      guard worldDimension.remainder(dividingBy: 256) == 0 else {
+        fatalError("World dimension was not divisible by 256.")
+      }
+    }
+    self.usesCoarseOccupancy = descriptor.usesCoarseOccupancy
 
     // Initialize the memory slot count.
     let memorySlotCount = Self.memorySlotCount(
@@ -48,7 +59,8 @@ class VoxelResources {
     let voxelCount = Self.voxelCount(worldDimension: worldDimension)
     self.group = GroupVoxelResources(
       device: device,
-      voxelGroupCount: voxelGroupCount)
+      voxelGroupCount: voxelGroupCount,
+      usesCoarseOccupancy: descriptor.usesCoarseOccupancy)
     self.dense = DenseVoxelResources(
       device: device,
       voxelCount: voxelCount)
@@ -78,6 +90,9 @@ class VoxelResources {
     bytesPerSlot += MemorySlot.header.size
     bytesPerSlot += MemorySlot.reference32.size
     bytesPerSlot += MemorySlot.reference16.size
+    
+    // Share of the continuation chunks.
+    bytesPerSlot += MemorySlot.reference16.size / MemorySlot.continuationRatio
     return voxelAllocationSize / bytesPerSlot
   }
   
@@ -109,6 +124,7 @@ class GroupVoxelResources {
   let rebuiltMarks: Buffer
   let occupiedMarks8: Buffer
   let occupiedMarks32: Buffer
+  let occupiedMarks128: Buffer
   
   // purge to UInt32.max before every frame
   let atomsRemovedGroupCoords: Buffer
@@ -116,7 +132,11 @@ class GroupVoxelResources {
   let rebuiltGroupCoords: Buffer
   let resetGroupCoords: Buffer
   
-  init(device: Device, voxelGroupCount: Int) {
+  init(
+    device: Device,
+    voxelGroupCount: Int,
+    usesCoarseOccupancy: Bool
+  ) {
     func createBuffer(size: Int) -> Buffer {
       var bufferDesc = BufferDescriptor()
       bufferDesc.device = device
@@ -131,6 +151,15 @@ class GroupVoxelResources {
     self.occupiedMarks8 = createBuffer(size: voxelGroupCount * 4)
     self.occupiedMarks32 = createBuffer(size: (voxelGroupCount / 64) * 4)
     
+    // Always allocated, so the render shader has the same bindings whether or
+    // not the 128 nm level is enabled.
+    if usesCoarseOccupancy {
+      self.occupiedMarks128 = createBuffer(
+        size: (voxelGroupCount / 4096) * 4)
+    } else {
+      self.occupiedMarks128 = createBuffer(size: 4)
+    }
+    
     self.atomsRemovedGroupCoords = createBuffer(size: voxelGroupCount * 4)
     self.addedGroupCoords = createBuffer(size: voxelGroupCount * 4)
     self.rebuiltGroupCoords = createBuffer(size: voxelGroupCount * 4)
@@ -178,6 +207,10 @@ class SparseVoxelResources {
   let rebuiltVoxelCoords: Buffer
   let vacantSlotIDs: Buffer
   
+  // initialize to UInt32.max with shader
+  // encoded voxel coords of the voxel that borrowed each continuation chunk
+  let continuationOwners: Buffer
+  
   let headers: Buffer
   let references32: Buffer
   #if os(macOS)
@@ -201,19 +234,27 @@ class SparseVoxelResources {
     self.rebuiltVoxelCoords = createBuffer(size: memorySlotCount * 4)
     self.vacantSlotIDs = createBuffer(size: memorySlotCount * 4)
     
+    // Never empty, so the kernels always have a buffer to bind.
+    let continuationChunkCount = MemorySlot.continuationChunkCount(
+      memorySlotCount: memorySlotCount)
+    self.continuationOwners = createBuffer(
+      size: max(continuationChunkCount, 1) * 4)
+    
     self.headers = createBuffer(
       size: memorySlotCount * MemorySlot.header.size)
     self.references32 = createBuffer(
       size: memorySlotCount * MemorySlot.reference32.size)
+    let chunkCount = MemorySlot.reference16ChunkCount(
+      memorySlotCount: memorySlotCount)
     #if os(macOS)
     self.references16 = createBuffer(
-      size: memorySlotCount * MemorySlot.reference16.size)
+      size: chunkCount * MemorySlot.reference16.size)
     #else
     func slotRange(regionID: Int) -> Range<Int> {
       let max32BitSlotCount = MemorySlot.reference16.max32BitSlotCount
       let startSlotID = regionID * max32BitSlotCount
       var endSlotID = startSlotID + max32BitSlotCount
-      endSlotID = min(endSlotID, memorySlotCount)
+      endSlotID = min(endSlotID, chunkCount)
       return startSlotID..<endSlotID
     }
 
@@ -238,9 +279,12 @@ class SparseVoxelResources {
     #endif
   }
   
+  // Continuation chunks are addressed like slots, after the last slot.
   static func overflows16(memorySlotCount: Int) -> Bool {
     let max32BitSlotCount = MemorySlot.reference16.max32BitSlotCount
-    return memorySlotCount > max32BitSlotCount
+    let chunkCount = MemorySlot.reference16ChunkCount(
+      memorySlotCount: memorySlotCount)
+    return chunkCount > max32BitSlotCount
   }
   
   #if os(Windows)
@@ -248,7 +292,8 @@ class SparseVoxelResources {
   static func regionCount(memorySlotCount: Int) -> Int {
     let max32BitSlotCount = MemorySlot.reference16.max32BitSlotCount
     
-    var output = memorySlotCount
+    var output = MemorySlot.reference16ChunkCount(
+      memorySlotCount: memorySlotCount)
     output += max32BitSlotCount - 1
     output /= max32BitSlotCount
     return output
@@ -324,11 +369,13 @@ extension VoxelResources {
   }
   
   func encodeMemorySlots(descriptorHeap: DescriptorHeap) {
+    let chunkCount = MemorySlot.reference16ChunkCount(
+      memorySlotCount: memorySlotCount)
     func slotRange(regionID: Int) -> Range<Int> {
       let max32BitSlotCount = MemorySlot.reference16.max32BitSlotCount
       let startSlotID = regionID * max32BitSlotCount
       var endSlotID = startSlotID + max32BitSlotCount
-      endSlotID = min(endSlotID, memorySlotCount)
+      endSlotID = min(endSlotID, chunkCount)
       return startSlotID..<endSlotID
     }
     
@@ -82,6 +82,56 @@ class AddProcess {
     """
   }
   
+  static func packRadius() -> String {
+    """
+    // Pack the atomic number and radius^2 into the 4th component.
+    float4 packRadius(float4 atom) {
+      uint atomicNumber = uint(atom[3]);
+      float radius = atomRadii[atomicNumber];
+      uint bitPattern = \(Shader.asuint)(radius * radius);
+      bitPattern &= 0xFFFFFF00;
+      bitPattern |= atomicNumber & 0xFF;
+      atom.w = \(Shader.asfloat)(bitPattern);
+      return atom;
+    }
+    """
+  }
+  
+  // Summarizes the set of 2 nm voxels overlapped by an atom, so two positions
+  // can be compared without iterating over the footprint.
+  //
+  // xyz: coordinates of the lowest 2 nm voxel
+  // w: bitmask of the axes where the footprint spans 2 voxels
+  //    UInt32.max if the atom is out of bounds
+  static func computeFootprint(worldDimension: Float) -> String {
+    """
+    uint4 computeFootprint(float4 atom) {
+      float3 scaledPosition = atom.xyz + float(\(worldDimension / 2));
+      scaledPosition /= 0.25;
+      float scaledRadius = sqrt(atom.w) / 0.25;
+      
+      float3 boxMin = floor(scaledPosition - scaledRadius);
+      float3 boxMax = ceil(scaledPosition + scaledRadius);
+      bool3 outOfBounds = boxMax > float(\(worldDimension / 0.25));
+      outOfBounds = \(Shader.or("outOfBounds", "boxMin < 0"));
+      if (any(outOfBounds)) {
+        return uint4(0, 0, 0, \(UInt32.max));
+      }
+      
+      uint3 smallVoxelMin = uint3(boxMin);
+      uint3 smallVoxelMax = uint3(boxMax);
+      uint3 largeVoxelMin = smallVoxelMin / 8;
+      uint3 dividingLine = (largeVoxelMin + 1) * 8;
+      
+      uint mask = 0;
+      mask |= (smallVoxelMax[0] > dividingLine[0]) ? 1 : 0;
+      mask |= (smallVoxelMax[1] > dividingLine[1]) ? 2 : 0;
+      mask |= (smallVoxelMax[2] > dividingLine[2]) ? 4 : 0;
+      return uint4(largeVoxelMin, mask);
+    }
+    """
+  }
+  
   static func computeLoopBounds(
     worldDimension: Float
   ) -> String {
@@ -3,8 +3,9 @@ extension AddProcess {
   // dispatch threads SIMD3(movedCount + addedCount, 1, 1)
   // threadgroup memory 4096 B
   //
-  // set the addressOccupiedMark to 1
   // set the atom and motion vector
+  // if the addressOccupiedMark is 3, return early
+  // set the addressOccupiedMark to 1
   // write to group.addedMarks
   // write to dense.atomicCounters with 8 partial sums
   // save the relativeOffsets
@@ -84,6 +85,7 @@ extension AddProcess {
     \(Shader.importStandardLibrary)
     
     \(AtomStyles.createAtomRadii(AtomStyles.radii))
+    \(packRadius())
     \(pickPermutation())
     \(reorderForward())
     \(reorderBackward())
@@ -111,15 +113,7 @@ extension AddProcess {
       uint atomID = transactionIDs[removedCount + globalID];
       float4 atom = transactionAtoms[globalID];
       
-      // Pack the atomic number and radius^2 into the 4th component.
-      {
-        uint atomicNumber = uint(atom[3]);
-        float radius = atomRadii[atomicNumber];
-        uint bitPattern = \(Shader.asuint)(radius * radius);
-        bitPattern &= 0xFFFFFF00;
-        bitPattern |= atomicNumber & 0xFF;
-        atom.w = \(Shader.asfloat)(bitPattern);
-      }
+      atom = packRadius(atom);
       
       // Compute the motion vector.
       float4 motionVector = 0;
@@ -131,6 +125,12 @@ extension AddProcess {
       // Write the state to the address space.
       atoms[atomID] = atom;
       motionVectors[atomID] = \(castHalf4("motionVector"));
+      
+      // The atom never left its reference lists. Its voxels were already
+      // tagged for rebuilding during the remove process.
+      if (addressOccupiedMarks[atomID] == 3) {
+        return;
+      }
       addressOccupiedMarks[atomID] = 1;
       
       \(computeLoopBounds(worldDimension: worldDimension))
@@ -14,6 +14,7 @@ extension AddProcess {
   //   if exceeded memory slot limit, crash w/ diagnostic info
   //   write new entry in dense.assignedSlotIDs and sparse.assignedVoxelCoords
   //   initialize atom count to 0 in memory slot header
+  //   mark the continuation slots as unlinked
   //
   // add existing atom count to prefix-summed 8 counters
   // write to dense.atomicCounters
@@ -182,6 +183,13 @@ extension AddProcess {
           uint headerAddress = slotID * \(MemorySlot.header.size / 4);
           headers[headerAddress] = 0;
           headers[headerAddress + 1] = 0;
+          
+          uint continuationBase = headerAddress +
+          \(MemorySlot.continuationsOffset / 4);
+          \(Shader.unroll)
+          for (uint k = 0; k < \(MemorySlot.continuationCount); ++k) {
+            headers[continuationBase + k] = \(UInt32.max);
+          }
         }
       }
       \(Reduction.waveGlobalBarrier())
@@ -4,6 +4,7 @@ extension AddProcess {
   // threadgroup memory 4096 B
   //
   // read atom from address space
+  // if the addressOccupiedMark is 3, reset it to 1 and return early
   // restore the relativeOffsets
   // read from dense.atomicCounters
   //   add to relativeOffset, generating the correct offset
@@ -107,6 +108,12 @@ extension AddProcess {
       uint atomID = transactionIDs[removedCount + globalID];
       float4 atom = atoms[atomID];
       
+      // Skip atoms that moved within their original footprint.
+      if (addressOccupiedMarks[atomID] == 3) {
+        addressOccupiedMarks[atomID] = 1;
+        return;
+      }
+      
       \(computeLoopBounds(worldDimension: worldDimension))
       
       // Read the offsets from device memory.
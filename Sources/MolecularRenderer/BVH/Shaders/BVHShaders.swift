@@ -1,6 +1,7 @@
 struct BVHShadersDescriptor {
   var device: Device?
   var memorySlotCount: Int?
+  var usesCoarseOccupancy: Bool = false
   var worldDimension: Float?
 }
 
@@ -8,6 +9,7 @@ class BVHShaders {
   let remove: RemoveProcess
   let add: AddProcess
   let rebuild: RebuildProcess
+  let reorder: ReorderProcess
   
   let clearBuffer: Shader
   let dispatchVoxelGroups: Shader
@@ -23,6 +25,7 @@ class BVHShaders {
     self.remove = RemoveProcess(descriptor: descriptor)
     self.add = AddProcess(descriptor: descriptor)
     self.rebuild = RebuildProcess(descriptor: descriptor)
+    self.reorder = ReorderProcess(descriptor: descriptor)
     
     var shaderDesc = ShaderDescriptor()
     shaderDesc.device = device
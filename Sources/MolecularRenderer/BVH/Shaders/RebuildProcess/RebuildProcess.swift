@@ -29,6 +29,7 @@ class RebuildProcess {
     shaderDesc.name = "rebuildProcess3"
     shaderDesc.threadsPerGroup = SIMD3(4, 4, 4)
     shaderDesc.source = Self.createSource3(
+      usesCoarseOccupancy: descriptor.usesCoarseOccupancy,
       worldDimension: worldDimension)
     self.process3 = Shader(descriptor: shaderDesc)
   }
@@ -1,7 +1,7 @@
 extension RebuildProcess {
   // [numthreads(128, 1, 1)]
   // dispatch indirect groups SIMD3(atomic counter, 1, 1)
-  // threadgroup memory 2068 B
+  // threadgroup memory 2076 B
   //
   // # Phase I
   //
@@ -15,6 +15,9 @@ extension RebuildProcess {
   //   save the prefix sum result for Phase IV
   // if reference count is too large, crash w/ diagnostic info
   // write reference count into memory slot header
+  // link or release continuation chunks for the overflowing references
+  //   if every chunk is borrowed, crash w/ diagnostic info
+  //   update overflow statistics in the crash buffer
   //
   // # Phase III
   //
@@ -22,6 +25,7 @@ extension RebuildProcess {
   // run the cube-sphere test and mask out voxels outside the 2 nm bound
   // atomically accumulate into threadgroupCounters
   // write a 16-bit reference to sparse.memorySlots
+  //   follow the chain if the offset exceeds the capacity of a slot
   //
   // # Phase IV
   //
@@ -40,6 +44,7 @@ extension RebuildProcess {
     // voxels.dense.assignedSlotIDs
     // voxels.sparse.rebuiltVoxelCoords
     // voxels.sparse.memorySlots [32, 16]
+    // voxels.sparse.continuationOwners
     func functionSignature() -> String {
       #if os(macOS)
       """
@@ -51,6 +56,7 @@ extension RebuildProcess {
         device uint *headers [[buffer(4)]],
         device uint *references32 [[buffer(5)]],
         device ushort *references16 [[buffer(6)]],
+        device atomic_uint *continuationOwners [[buffer(7)]],
         uint groupID [[threadgroup_position_in_grid]],
         uint localID [[thread_position_in_threadgroup]])
       """
@@ -63,7 +69,8 @@ extension RebuildProcess {
       RWStructuredBuffer<uint> headers : register(u4);
       RWStructuredBuffer<uint> references32 : register(u5);
       \(SparseVoxelResources.ref16FunctionArgument(memorySlotCount))
-      groupshared uint threadgroupMemory[517];
+      RWStructuredBuffer<uint> continuationOwners : register(u7);
+      groupshared uint threadgroupMemory[519];
       
       [numthreads(128, 1, 1)]
       [RootSignature(
@@ -74,6 +81,7 @@ extension RebuildProcess {
         "UAV(u4),"
         "UAV(u5),"
         "\(SparseVoxelResources.ref16RootSignatureArgument(memorySlotCount)),"
+        "UAV(u7),"
       )]
       void rebuildProcess2(
         uint groupID : SV_GroupID,
@@ -84,7 +92,7 @@ extension RebuildProcess {
     
     func allocateThreadgroupMemory() -> String {
       #if os(macOS)
-      "threadgroup uint threadgroupMemory[517];"
+      "threadgroup uint threadgroupMemory[519];"
       #else
       ""
       #endif
@@ -151,67 +159,181 @@ extension RebuildProcess {
       }
     }
     
-    func initializeAddress16() -> String {
-      let overflows16 = SparseVoxelResources.overflows16(
+    func getAtomID() -> String {
+      let overflows32 = SparseVoxelResources.overflows32(
         memorySlotCount: memorySlotCount)
       
-      if !overflows16 {
+      if !overflows32 {
         return """
-        uint listAddress16 = slotID * \(MemorySlot.reference16.size / 2);
+        uint atomID = references32[listAddress32 + i];
         """
       } else {
-        #if os(macOS)
         return """
-        device ushort *destination16 = references16 +
-        ulong(slotID) * \(MemorySlot.reference16.size / 2);
+        uint atomID = destination32[i];
         """
-        #else
-        let max32BitSlotCount = MemorySlot.reference16.max32BitSlotCount
+      }
+    }
+    
+    // Claims an unowned entry of continuationOwners, starting from a hash of
+    // the voxel coordinates so that neighboring voxels rarely collide. The
+    // probe only visits every chunk once the pool is nearly exhausted.
+    func claimContinuation() -> String {
+      let chunkCount = MemorySlot.continuationChunkCount(
+        memorySlotCount: memorySlotCount)
+      
+      #if os(macOS)
+      let compareExchange = """
+      uint expected = \(UInt32.max);
+      bool acquired = atomic_compare_exchange_weak_explicit(
+        continuationOwners + poolID, // object
+        &expected, // expected
+        encodedVoxelCoords, // desired
+        memory_order_relaxed, // success
+        memory_order_relaxed); // failure
+      
+      // Retry spurious failures of the weak exchange.
+      if (!acquired && expected == \(UInt32.max)) {
+        continue;
+      }
+      """
+      #else
+      let compareExchange = """
+      uint original;
+      InterlockedCompareExchange(
+        continuationOwners[poolID], // dest
+        \(UInt32.max), // compare_value
+        encodedVoxelCoords, // value
+        original); // original_value
+      bool acquired = (original == \(UInt32.max));
+      """
+      #endif
+      
+      return """
+      uint poolID = encodedVoxelCoords * 2654435761u + k;
+      poolID %= \(max(chunkCount, 1));
+      for (uint probe = 0; probe < \(chunkCount); ++probe) {
+        \(compareExchange)
+        if (acquired) {
+          continuationID = \(memorySlotCount) + poolID;
+          break;
+        }
         
-        return """
-        uint regionID = slotID / \(max32BitSlotCount);
-        uint listAddress16 = (slotID - regionID * \(max32BitSlotCount)) *
-        \(MemorySlot.reference16.size / 2);
-        RWBuffer<uint> destination16 = references16[regionID];
-        """
-        #endif
+        poolID += 1;
+        if (poolID >= \(chunkCount)) {
+          poolID = 0;
+        }
       }
+      """
     }
     
-    func getAtomID() -> String {
-      let overflows32 = SparseVoxelResources.overflows32(
+    func releaseContinuation() -> String {
+      #if os(macOS)
+      """
+      atomic_store_explicit(
+        continuationOwners + (continuationID - \(memorySlotCount)), // object
+        \(UInt32.max), // desired
+        memory_order_relaxed); // order
+      """
+      #else
+      """
+      continuationOwners[continuationID - \(memorySlotCount)] = \(UInt32.max);
+      """
+      #endif
+    }
+    
+    // Runs on a single thread. Links a continuation chunk for every 20480
+    // references beyond the first slot, and releases the ones no longer
+    // needed. Broadcasts the chain through threadgroupMemory[517...518].
+    func updateContinuations() -> String {
+      let continuationCount = MemorySlot.continuationCount
+      let continuationBase = MemorySlot.continuationsOffset / 4
+      let chunkCount = MemorySlot.continuationChunkCount(
         memorySlotCount: memorySlotCount)
       
-      if !overflows32 {
-        return """
-        uint atomID = references32[listAddress32 + i];
-        """
-      } else {
-        return """
-        uint atomID = destination32[i];
-        """
+      return """
+      uint previousChainLength = 1;
+      for (uint k = 0; k < \(continuationCount); ++k) {
+        uint continuationAddress = headerAddress + \(continuationBase) + k;
+        uint continuationID = headers[continuationAddress];
+        if (continuationID != \(UInt32.max)) {
+          previousChainLength += 1;
+        }
+        
+        if (k + 1 < chainLength) {
+          if (continuationID == \(UInt32.max)) {
+            \(claimContinuation())
+            
+            if (continuationID == \(UInt32.max)) {
+              bool acquiredLock = false;
+              \(CrashBuffer.acquireLock(errorCode: 5))
+              if (acquiredLock) {
+                crashBuffer[1] = voxelCoords.x;
+                crashBuffer[2] = voxelCoords.y;
+                crashBuffer[3] = voxelCoords.z;
+                crashBuffer[4] = \(chunkCount);
+              }
+            } else {
+              \(OverflowStatistics.addContinuationChunks("1"))
+            }
+          }
+        } else if (continuationID != \(UInt32.max)) {
+          \(releaseContinuation())
+          continuationID = \(UInt32.max);
+          \(OverflowStatistics.addContinuationChunks("-1"))
+        }
+        
+        headers[continuationAddress] = continuationID;
+        threadgroupMemory[517 + k] = continuationID;
       }
+      
+      if (previousChainLength == 1 && chainLength > 1) {
+        \(OverflowStatistics.addChainedVoxels("1"))
+      } else if (previousChainLength > 1 && chainLength <= 1) {
+        \(OverflowStatistics.addChainedVoxels("-1"))
+      }
+      """
     }
     
+    // Locate the offset within the chain of chunks.
     func writeAddress16() -> String {
       let overflows16 = SparseVoxelResources.overflows16(
         memorySlotCount: memorySlotCount)
       
+      var output = """
+      uint chainID = offset / 20480;
+      uint chainOffset = offset - chainID * 20480;
+      uint chainSlotID = slotID;
+      if (chainID > 0) {
+        chainSlotID = threadgroupMemory[516 + chainID];
+      }
+      
+      """
+      
       if !overflows16 {
-        return """
-        references16[listAddress16 + offset] = \(castUShort("i"));
+        output += """
+        uint listAddress16 = chainSlotID * \(MemorySlot.reference16.size / 2);
+        references16[listAddress16 + chainOffset] = \(castUShort("i"));
         """
       } else {
         #if os(macOS)
-        return """
-        destination16[offset] = \(castUShort("i"));
+        output += """
+        device ushort *destination16 = references16 +
+        ulong(chainSlotID) * \(MemorySlot.reference16.size / 2);
+        destination16[chainOffset] = \(castUShort("i"));
         """
         #else
-        return """
-        destination16[listAddress16 + offset] = \(castUShort("i"));
+        let max32BitSlotCount = MemorySlot.reference16.max32BitSlotCount
+        
+        output += """
+        uint regionID = chainSlotID / \(max32BitSlotCount);
+        uint listAddress16 = (chainSlotID - regionID * \(max32BitSlotCount)) *
+        \(MemorySlot.reference16.size / 2);
+        references16[NonUniformResourceIndex(regionID)]
+        [listAddress16 + chainOffset] = \(castUShort("i"));
         """
         #endif
       }
+      return output
     }
 
     return """
@@ -312,7 +434,8 @@ extension RebuildProcess {
       \(Reduction.groupLocalBarrier())
       
       uint referenceCount = threadgroupMemory[516];
-      if (referenceCount > 20480) {
+      uint chainLength = (referenceCount + 20479) / 20480;
+      if (referenceCount > \(MemorySlot.chainedReference16Capacity)) {
         if (localID == 0) {
           bool acquiredLock = false;
           \(CrashBuffer.acquireLock(errorCode: 4))
@@ -327,14 +450,23 @@ extension RebuildProcess {
       }
       if (localID == 0) {
         headers[headerAddress + 1] = referenceCount;
+        \(OverflowStatistics.recordReferenceCount("referenceCount"))
+        \(updateContinuations())
+      }
+      \(Reduction.groupLocalBarrier())
+      
+      // Abort if a continuation chunk could not be borrowed.
+      if (chainLength > 1 && threadgroupMemory[517] == \(UInt32.max)) {
+        return;
+      }
+      if (chainLength > 2 && threadgroupMemory[518] == \(UInt32.max)) {
+        return;
       }
       
       // =======================================================================
       // ===                            Phase III                            ===
       // =======================================================================
       
-      \(initializeAddress16())
-      
       for (uint i = localID; i < atomCount; i += 128) {
         \(getAtomID())
         float4 atom = atoms[atomID];
@@ -408,6 +540,9 @@ extension BVHBuilder {
       voxels.sparse.bindReferences16(
         commandList: commandList, index: 6)
       
+      commandList.setBuffer(
+        voxels.sparse.continuationOwners, index: 7)
+      
       let offset = GeneralCounters.offset(.rebuiltVoxelCount)
       commandList.dispatchIndirect(
         buffer: counters.general,
@@ -5,10 +5,14 @@ extension RebuildProcess {
   // read from dense.assignedSlotIDs
   //   do not use any optimizations to reduce the bandwidth cost
   // write to group.occupiedMarks
-  static func createSource3(worldDimension: Float) -> String {
+  static func createSource3(
+    usesCoarseOccupancy: Bool,
+    worldDimension: Float
+  ) -> String {
     // voxels.group.occupiedMarks8
     // voxels.group.occupiedMarks32
     // voxels.dense.assignedSlotIDs
+    // voxels.group.occupiedMarks128
     func functionSignature() -> String {
       #if os(macOS)
       """
@@ -16,6 +20,7 @@ extension RebuildProcess {
         device uint *voxelGroup8OccupiedMarks [[buffer(0)]],
         device uint *voxelGroup32OccupiedMarks [[buffer(1)]],
         device uint *assignedSlotIDs [[buffer(2)]],
+        device uint *voxelGroup128OccupiedMarks [[buffer(3)]],
         uint3 voxelCoords [[thread_position_in_grid]])
       """
       #else
@@ -23,12 +28,14 @@ extension RebuildProcess {
       RWStructuredBuffer<uint> voxelGroup8OccupiedMarks : register(u0);
       RWStructuredBuffer<uint> voxelGroup32OccupiedMarks : register(u1);
       RWStructuredBuffer<uint> assignedSlotIDs : register(u2);
+      RWStructuredBuffer<uint> voxelGroup128OccupiedMarks : register(u3);
       
       [numthreads(4, 4, 4)]
       [RootSignature(
         "UAV(u0),"
         "UAV(u1),"
         "UAV(u2),"
+        "UAV(u3),"
       )]
       void rebuildProcess3(
         uint3 voxelCoords : SV_DispatchThreadID)
@@ -36,6 +43,19 @@ extension RebuildProcess {
       #endif
     }
     
+    func writeMark128() -> String {
+      guard usesCoarseOccupancy else {
+        return ""
+      }
+      
+      return """
+      uint3 voxelGroup128Coords = voxelCoords / 64;
+      uint voxelGroup128ID =
+      \(VoxelResources.generate("voxelGroup128Coords", worldDimension / 128));
+      voxelGroup128OccupiedMarks[voxelGroup128ID] = 1;
+      """
+    }
+    
     return """
     \(Shader.importStandardLibrary)
     
@@ -60,6 +80,7 @@ extension RebuildProcess {
       // write to group.occupiedMarks
       voxelGroup8OccupiedMarks[voxelGroup8ID] = 1;
       voxelGroup32OccupiedMarks[voxelGroup32ID] = 1;
+      \(writeMark128())
     }
     """
   }
@@ -74,6 +95,8 @@ extension BVHBuilder {
         voxels.group.occupiedMarks32, index: 1)
       commandList.setBuffer(
         voxels.dense.assignedSlotIDs, index: 2)
+      commandList.setBuffer(
+        voxels.group.occupiedMarks128, index: 3)
       
       let gridSize = Int(voxels.worldDimension / 8)
       let threadgroupCount = SIMD3<UInt32>(
@@ -6,8 +6,14 @@ extension RemoveProcess {
   // reset the addressOccupiedMark
   //   0 if removed
   //   2 if moved
-  // write to group.atomsRemovedMarks
-  // write to dense.atomsRemovedMarks
+  //   3 if moved, but the set of overlapped 2 nm voxels is unchanged
+  //
+  // if the mark is 3
+  //   write to group.rebuiltMarks
+  //   write to dense.rebuiltMarks
+  // otherwise
+  //   write to group.atomsRemovedMarks
+  //   write to dense.atomsRemovedMarks
   static func createSource1(
     supports16BitTypes: Bool,
     worldDimension: Float
@@ -15,6 +21,8 @@ extension RemoveProcess {
     // atoms.*
     // voxels.group.atomsRemovedMarks
     // voxels.dense.atomsRemovedMarks
+    // voxels.group.rebuiltMarks
+    // voxels.dense.rebuiltMarks
     func functionSignature() -> String {
       #if os(macOS)
       """
@@ -23,6 +31,8 @@ extension RemoveProcess {
         \(AtomResources.functionArguments(supports16BitTypes)),
         device uint *voxelGroupAtomsRemovedMarks [[buffer(9)]],
         device uchar *atomsRemovedMarks [[buffer(10)]],
+        device uint *voxelGroupRebuiltMarks [[buffer(11)]],
+        device uchar *rebuiltMarks [[buffer(12)]],
         uint globalID [[thread_position_in_grid]])
       """
       #else
@@ -31,6 +41,8 @@ extension RemoveProcess {
       \(AtomResources.functionArguments(supports16BitTypes))
       RWStructuredBuffer<uint> voxelGroupAtomsRemovedMarks : register(u9);
       RWBuffer<uint> atomsRemovedMarks : register(u10);
+      RWStructuredBuffer<uint> voxelGroupRebuiltMarks : register(u11);
+      RWBuffer<uint> rebuiltMarks : register(u12);
       
       [numthreads(128, 1, 1)]
       [RootSignature(
@@ -38,6 +50,8 @@ extension RemoveProcess {
         \(AtomResources.rootSignatureArguments(supports16BitTypes))
         "UAV(u9),"
         "DescriptorTable(UAV(u10, numDescriptors = 1)),"
+        "UAV(u11),"
+        "DescriptorTable(UAV(u12, numDescriptors = 1)),"
       )]
       void removeProcess1(
         uint globalID : SV_DispatchThreadID)
@@ -48,6 +62,9 @@ extension RemoveProcess {
     return """
     \(Shader.importStandardLibrary)
     
+    \(AtomStyles.createAtomRadii(AtomStyles.radii))
+    \(AddProcess.packRadius())
+    \(AddProcess.computeFootprint(worldDimension: worldDimension))
     \(AddProcess.pickPermutation())
     \(AddProcess.reorderForward())
     \(AddProcess.reorderBackward())
@@ -68,8 +85,27 @@ extension RemoveProcess {
       // Retrieve the atom.
       uint atomID = transactionIDs[globalID];
       float4 atom = atoms[atomID];
+      
+      // Classify the move by comparing the previous and current footprints.
+      // Thermal motion rarely carries an atom across a 2 nm voxel boundary,
+      // so most moved atoms can keep their place in the reference lists.
+      bool sameFootprint = false;
+      if (globalID >= removedCount) {
+        float4 movedAtom = transactionAtoms[globalID - removedCount];
+        movedAtom = packRadius(movedAtom);
+        
+        uint4 previousFootprint = computeFootprint(atom);
+        uint4 currentFootprint = computeFootprint(movedAtom);
+        if (previousFootprint[3] != \(UInt32.max) &&
+            all(previousFootprint == currentFootprint)) {
+          sameFootprint = true;
+        }
+      }
+      
       if (globalID < removedCount) {
         addressOccupiedMarks[atomID] = 0;
+      } else if (sameFootprint) {
+        addressOccupiedMarks[atomID] = 3;
       } else {
         addressOccupiedMarks[atomID] = 2;
       }
@@ -83,6 +119,19 @@ extension RemoveProcess {
             uint3 actualXYZ = uint3(x, y, z);
             actualXYZ = reorderBackward(actualXYZ, permutationID);
             
+            // Only tag the voxels for rebuilding.
+            if (sameFootprint) {
+              uint3 voxelCoordinates = largeVoxelMin + actualXYZ;
+              uint3 groupCoordinates = voxelCoordinates / 4;
+              uint groupAddress =
+              \(VoxelResources.generate("groupCoordinates", worldDimension / 8));
+              uint address =
+              \(VoxelResources.generate("voxelCoordinates", worldDimension / 2));
+              voxelGroupRebuiltMarks[groupAddress] = 1;
+              rebuiltMarks[address] = 1;
+              continue;
+            }
+            
             // Write the voxel group atoms-removed mark.
             {
               uint3 voxelCoordinates = largeVoxelMin + actualXYZ;
@@ -133,6 +182,15 @@ extension BVHBuilder {
       commandList.setDescriptor(
         handleID: voxels.dense.atomsRemovedMarksHandleID, index: 10)
       #endif
+      commandList.setBuffer(
+        voxels.group.rebuiltMarks, index: 11)
+      #if os(macOS)
+      commandList.setBuffer(
+        voxels.dense.rebuiltMarks, index: 12)
+      #else
+      commandList.setDescriptor(
+        handleID: voxels.dense.rebuiltMarksHandleID, index: 12)
+      #endif
       
       // Determine the dispatch grid size.
       func createGroupCount32() -> SIMD3<UInt32> {
@@ -12,6 +12,7 @@ extension RemoveProcess {
   // if atoms remain, write to dense.rebuiltMarks
   // otherwise
   //   reset entry in dense.assignedSlotIDs and sparse.assignedVoxelCoords
+  //   release any continuation chunks linked during the rebuild process
   static func createSource3(
     memorySlotCount: Int,
     worldDimension: Float
@@ -23,6 +24,7 @@ extension RemoveProcess {
     // voxels.sparse.atomsRemovedVoxelCoords
     // voxels.sparse.memorySlots.headerLarge
     // voxels.sparse.memorySlots.referenceLarge
+    // voxels.sparse.continuationOwners
     func functionSignature() -> String {
       #if os(macOS)
       """
@@ -35,6 +37,7 @@ extension RemoveProcess {
         device uint *atomsRemovedVoxelCoords [[buffer(5)]],
         device uint *headers [[buffer(6)]],
         device uint *references32 [[buffer(7)]],
+        device uint *continuationOwners [[buffer(8)]],
         uint groupID [[threadgroup_position_in_grid]],
         uint localID [[thread_position_in_threadgroup]])
       """
@@ -48,6 +51,7 @@ extension RemoveProcess {
       RWStructuredBuffer<uint> atomsRemovedVoxelCoords : register(u5);
       RWStructuredBuffer<uint> headers : register(u6);
       RWStructuredBuffer<uint> references32 : register(u7);
+      RWStructuredBuffer<uint> continuationOwners : register(u8);
       groupshared uint threadgroupMemory[5];
       
       [numthreads(128, 1, 1)]
@@ -60,6 +64,7 @@ extension RemoveProcess {
         "UAV(u5),"
         "UAV(u6),"
         "UAV(u7),"
+        "UAV(u8),"
       )]
       void removeProcess3(
         uint groupID : SV_GroupID,
@@ -126,6 +131,30 @@ extension RemoveProcess {
       }
     }
     
+    func releaseContinuations() -> String {
+      let continuationCount = MemorySlot.continuationCount
+      let continuationBase = MemorySlot.continuationsOffset / 4
+      
+      return """
+      uint releasedCount = 0;
+      for (uint k = 0; k < \(continuationCount); ++k) {
+        uint continuationAddress = headerAddress + \(continuationBase) + k;
+        uint continuationID = headers[continuationAddress];
+        if (continuationID != \(UInt32.max)) {
+          uint poolID = continuationID - \(memorySlotCount);
+          continuationOwners[poolID] = \(UInt32.max);
+          headers[continuationAddress] = \(UInt32.max);
+          releasedCount += 1;
+        }
+      }
+      
+      if (releasedCount > 0) {
+        \(OverflowStatistics.addContinuationChunks("-int(releasedCount)"))
+        \(OverflowStatistics.addChainedVoxels("-1"))
+      }
+      """
+    }
+    
     return """
     \(Shader.importStandardLibrary)
     
@@ -158,7 +187,8 @@ extension RemoveProcess {
         bool shouldKeep = false;
         if (inLoopBounds) {
           \(getAtomID())
-          if (addressOccupiedMarks[atomID] == 1) {
+          uint mark = addressOccupiedMarks[atomID];
+          if (mark == 1 || mark == 3) {
             shouldKeep = true;
           }
         }
@@ -194,6 +224,10 @@ extension RemoveProcess {
       } else {
         assignedVoxelCoords[slotID] = \(UInt32.max);
         assignedSlotIDs[voxelID] = \(UInt32.max);
+        
+        if (localID == 0) {
+          \(releaseContinuations())
+        }
       }
     }
     """
@@ -232,6 +266,8 @@ extension BVHBuilder {
         voxels.sparse.headers, index: 6)
       commandList.setBuffer(
         voxels.sparse.references32, index: 7)
+      commandList.setBuffer(
+        voxels.sparse.continuationOwners, index: 8)
       
       let offset = GeneralCounters.offset(.atomsRemovedVoxelCount)
       commandList.dispatchIndirect(
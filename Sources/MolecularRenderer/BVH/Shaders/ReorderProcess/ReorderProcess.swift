@@ -0,0 +1,44 @@
+// Renames the atoms in the address space, without changing their positions.
+// Only invoked when the user requests a spatially coherent ordering, so the
+// kernels favor simplicity over performance.
+class ReorderProcess {
+  let process1: Shader
+  let process2: Shader
+  
+  init(descriptor: BVHShadersDescriptor) {
+    guard let device = descriptor.device,
+          let memorySlotCount = descriptor.memorySlotCount else {
+      fatalError("Descriptor was incomplete.")
+    }
+    
+    var shaderDesc = ShaderDescriptor()
+    shaderDesc.device = device
+    shaderDesc.name = "reorderProcess1"
+    shaderDesc.threadsPerGroup = SIMD3(128, 1, 1)
+    shaderDesc.source = Self.createSource1(
+      supports16BitTypes: device.supports16BitTypes)
+    self.process1 = Shader(descriptor: shaderDesc)
+    
+    shaderDesc.name = "reorderProcess2"
+    shaderDesc.threadsPerGroup = SIMD3(128, 1, 1)
+    shaderDesc.source = Self.createSource2(
+      memorySlotCount: memorySlotCount)
+    self.process2 = Shader(descriptor: shaderDesc)
+  }
+}
+
+struct ReorderArgs {
+  var addressSpaceSize: UInt32 = .zero
+  var dispatchedThreadCount: UInt32 = .zero
+  var phase: UInt32 = .zero
+  
+  static var shaderDeclaration: String {
+    """
+    struct ReorderArgs {
+      uint addressSpaceSize;
+      uint dispatchedThreadCount;
+      uint phase;
+    };
+    """
+  }
+}
@@ -0,0 +1,177 @@
+extension ReorderProcess {
+  // [numthreads(128, 1, 1)]
+  // dispatch threads SIMD3(min(addressSpaceSize, 128 * 16384), 1, 1)
+  //
+  // loop over the address space with a grid stride
+  // phase 0
+  //   scatter each address to the scratch buffers, at its new atom ID
+  // phase 1
+  //   copy the scratch buffers back to the address space
+  static func createSource1(
+    supports16BitTypes: Bool
+  ) -> String {
+    // atoms.atoms
+    // atoms.motionVectors
+    // atoms.addressOccupiedMarks
+    // scratch.permutation
+    // scratch.atoms
+    // scratch.motionVectors
+    // scratch.addressOccupiedMarks
+    func functionSignature() -> String {
+      #if os(macOS)
+      return """
+      kernel void reorderProcess1(
+        \(CrashBuffer.functionArguments),
+        constant ReorderArgs &reorderArgs [[buffer(1)]],
+        device uint *permutation [[buffer(2)]],
+        device float4 *atoms [[buffer(3)]],
+        device half4 *motionVectors [[buffer(4)]],
+        device uchar *addressOccupiedMarks [[buffer(5)]],
+        device float4 *scratchAtoms [[buffer(6)]],
+        device float4 *scratchMotionVectors [[buffer(7)]],
+        device uint *scratchMarks [[buffer(8)]],
+        uint globalID [[thread_position_in_grid]])
+      """
+      #else
+      func motionVectorsArgumentType() -> String {
+        if supports16BitTypes {
+          return "RWStructuredBuffer<half4>"
+        } else {
+          return "RWBuffer<float4>"
+        }
+      }
+      
+      func motionVectorsRootSignatureArgument() -> String {
+        if supports16BitTypes {
+          return "UAV(u4)"
+        } else {
+          return "DescriptorTable(UAV(u4, numDescriptors = 1))"
+        }
+      }
+      
+      return """
+      \(CrashBuffer.functionArguments)
+      ConstantBuffer<ReorderArgs> reorderArgs : register(b1);
+      RWStructuredBuffer<uint> permutation : register(u2);
+      RWStructuredBuffer<float4> atoms : register(u3);
+      \(motionVectorsArgumentType()) motionVectors : register(u4);
+      RWBuffer<uint> addressOccupiedMarks : register(u5);
+      RWStructuredBuffer<float4> scratchAtoms : register(u6);
+      RWStructuredBuffer<float4> scratchMotionVectors : register(u7);
+      RWStructuredBuffer<uint> scratchMarks : register(u8);
+      
+      [numthreads(128, 1, 1)]
+      [RootSignature(
+        \(CrashBuffer.rootSignatureArguments)
+        "RootConstants(b1, num32BitConstants = 3),"
+        "UAV(u2),"
+        "UAV(u3),"
+        "\(motionVectorsRootSignatureArgument()),"
+        "DescriptorTable(UAV(u5, numDescriptors = 1)),"
+        "UAV(u6),"
+        "UAV(u7),"
+        "UAV(u8),"
+      )]
+      void reorderProcess1(
+        uint globalID : SV_DispatchThreadID)
+      """
+      #endif
+    }
+    
+    func castHalf4(_ input: String) -> String {
+      if supports16BitTypes {
+        return "half4(\(input))"
+      } else {
+        return input
+      }
+    }
+    
+    func castUChar(_ input: String) -> String {
+      #if os(macOS)
+      return "uchar(\(input))"
+      #else
+      return input
+      #endif
+    }
+    
+    return """
+    \(Shader.importStandardLibrary)
+    
+    \(ReorderArgs.shaderDeclaration)
+    
+    \(functionSignature())
+    {
+      if (crashBuffer[0] != 1) {
+        return;
+      }
+      
+      uint addressSpaceSize = reorderArgs.addressSpaceSize;
+      uint stride = reorderArgs.dispatchedThreadCount;
+      for (uint i = globalID; i < addressSpaceSize; i += stride) {
+        if (reorderArgs.phase == 0) {
+          uint newID = permutation[i];
+          scratchAtoms[newID] = atoms[i];
+          scratchMotionVectors[newID] = float4(motionVectors[i]);
+          scratchMarks[newID] = uint(addressOccupiedMarks[i]);
+        } else {
+          float4 motionVector = scratchMotionVectors[i];
+          atoms[i] = scratchAtoms[i];
+          motionVectors[i] = \(castHalf4("motionVector"));
+          addressOccupiedMarks[i] = \(castUChar("scratchMarks[i]"));
+        }
+      }
+    }
+    """
+  }
+}
+
+extension BVHBuilder {
+  func reorderProcess1(
+    commandList: CommandList,
+    scratch: ReorderScratch,
+    phase: UInt32
+  ) {
+    commandList.withPipelineState(shaders.reorder.process1) {
+      counters.crashBuffer.setBufferBindings(
+        commandList: commandList)
+      
+      // Determine the dispatch grid size.
+      let groupSize: Int = 128
+      var groupCount = atoms.addressSpaceSize / groupSize
+      groupCount = min(groupCount, 16384)
+      
+      var reorderArgs = ReorderArgs()
+      reorderArgs.addressSpaceSize = UInt32(atoms.addressSpaceSize)
+      reorderArgs.dispatchedThreadCount = UInt32(groupCount * groupSize)
+      reorderArgs.phase = phase
+      commandList.set32BitConstants(reorderArgs, index: 1)
+      
+      commandList.setBuffer(
+        scratch.permutation, index: 2)
+      commandList.setBuffer(
+        atoms.atoms, index: 3)
+      atoms.bindMotionVectors(
+        commandList: commandList, index: 4)
+      #if os(macOS)
+      commandList.setBuffer(
+        atoms.addressOccupiedMarks, index: 5)
+      #else
+      commandList.setDescriptor(
+        handleID: atoms.addressOccupiedMarksHandleID, index: 5)
+      #endif
+      
+      commandList.setBuffer(
+        scratch.atoms, index: 6)
+      commandList.setBuffer(
+        scratch.motionVectors, index: 7)
+      commandList.setBuffer(
+        scratch.addressOccupiedMarks, index: 8)
+      
+      commandList.dispatch(groups: SIMD3(UInt32(groupCount), 1, 1))
+    }
+    
+    #if os(Windows)
+    computeUAVBarrier(commandList: commandList)
+    #endif
+  }
+}
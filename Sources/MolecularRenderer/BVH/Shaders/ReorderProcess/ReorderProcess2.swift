@@ -0,0 +1,150 @@
+extension ReorderProcess {
+  // [numthreads(128, 1, 1)]
+  // dispatch threads SIMD3(memorySlotCount, 1, 1)
+  //
+  // skip slots that are vacant
+  // rename every entry of the 32-bit reference list through the permutation
+  //
+  // The 16-bit references index into the 32-bit list, so the small cells
+  // stay valid without a rebuild.
+  static func createSource2(
+    memorySlotCount: Int
+  ) -> String {
+    // scratch.permutation
+    // voxels.sparse.assignedVoxelCoords
+    // voxels.sparse.memorySlots.headerLarge
+    // voxels.sparse.memorySlots.referenceLarge
+    func functionSignature() -> String {
+      #if os(macOS)
+      """
+      kernel void reorderProcess2(
+        \(CrashBuffer.functionArguments),
+        device uint *permutation [[buffer(1)]],
+        device uint *assignedVoxelCoords [[buffer(2)]],
+        device uint *headers [[buffer(3)]],
+        device uint *references32 [[buffer(4)]],
+        uint globalID [[thread_position_in_grid]])
+      """
+      #else
+      """
+      \(CrashBuffer.functionArguments)
+      RWStructuredBuffer<uint> permutation : register(u1);
+      RWStructuredBuffer<uint> assignedVoxelCoords : register(u2);
+      RWStructuredBuffer<uint> headers : register(u3);
+      RWStructuredBuffer<uint> references32 : register(u4);
+      
+      [numthreads(128, 1, 1)]
+      [RootSignature(
+        \(CrashBuffer.rootSignatureArguments)
+        "UAV(u1),"
+        "UAV(u2),"
+        "UAV(u3),"
+        "UAV(u4),"
+      )]
+      void reorderProcess2(
+        uint globalID : SV_DispatchThreadID)
+      """
+      #endif
+    }
+    
+    func initializeAddress32() -> String {
+      let overflows32 = SparseVoxelResources.overflows32(
+        memorySlotCount: memorySlotCount)
+      
+      if !overflows32 {
+        return """
+        uint listAddress32 = slotID * \(MemorySlot.reference32.size / 4);
+        """
+      } else {
+        return """
+        device uint *destination32 = references32 +
+        ulong(slotID) * \(MemorySlot.reference32.size / 4);
+        """
+      }
+    }
+    
+    func renameAtomID() -> String {
+      let overflows32 = SparseVoxelResources.overflows32(
+        memorySlotCount: memorySlotCount)
+      
+      if !overflows32 {
+        return """
+        uint atomID = references32[listAddress32 + i];
+        references32[listAddress32 + i] = permutation[atomID];
+        """
+      } else {
+        return """
+        uint atomID = destination32[i];
+        destination32[i] = permutation[atomID];
+        """
+      }
+    }
+    
+    return """
+    \(Shader.importStandardLibrary)
+    
+    \(functionSignature())
+    {
+      if (crashBuffer[0] != 1) {
+        return;
+      }
+      if (globalID >= \(memorySlotCount)) {
+        return;
+      }
+      
+      uint slotID = globalID;
+      uint encodedVoxelCoords = assignedVoxelCoords[slotID];
+      if (encodedVoxelCoords == \(UInt32.max)) {
+        return;
+      }
+      
+      uint headerAddress = slotID * \(MemorySlot.header.size / 4);
+      \(initializeAddress32())
+      uint atomCount = headers[headerAddress];
+      for (uint i = 0; i < atomCount; ++i) {
+        \(renameAtomID())
+      }
+    }
+    """
+  }
+}
+
+extension BVHBuilder {
+  func reorderProcess2(
+    commandList: CommandList,
+    scratch: ReorderScratch
+  ) {
+    commandList.withPipelineState(shaders.reorder.process2) {
+      counters.crashBuffer.setBufferBindings(
+        commandList: commandList)
+      
+      commandList.setBuffer(
+        scratch.permutation, index: 1)
+      commandList.setBuffer(
+        voxels.sparse.assignedVoxelCoords, index: 2)
+      commandList.setBuffer(
+        voxels.sparse.headers, index: 3)
+      commandList.setBuffer(
+        voxels.sparse.references32, index: 4)
+      
+      // Determine the dispatch grid size.
+      func createGroupCount32() -> SIMD3<UInt32> {
+        var groupCount: Int = voxels.memorySlotCount
+        
+        let groupSize: Int = 128
+        groupCount += groupSize - 1
+        groupCount /= groupSize
+        
+        return SIMD3<UInt32>(
+          UInt32(groupCount),
+          UInt32(1),
+          UInt32(1))
+      }
+      commandList.dispatch(groups: createGroupCount32())
+    }
+    
+    #if os(Windows)
+    computeUAVBarrier(commandList: commandList)
+    #endif
+  }
+}
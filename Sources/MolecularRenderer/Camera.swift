@@ -25,6 +25,53 @@ public struct Camera {
   /// heuristic.
   public var criticalPixelCount: Float?
   
+  /// The maximum number of AO samples accumulated across frames, through
+  /// reprojection with the motion vectors. Samples are rejected when the
+  /// pixel hit a different atom, or a different depth, during the previous
+  /// frame.
+  ///
+  /// With temporal reuse, each frame can trace far fewer AO rays at equal
+  /// quality. For example, 3 rays per frame with a limit of 30. Larger limits
+  /// reduce noise, but cause shadows to lag behind moving atoms.
+  ///
+  /// Defaults to `nil`, which disables temporal reuse.
+  public var temporalSampleLimit: Int?
+  
+  /// The number of AO rays traced before estimating the variance of a pixel.
+  /// Must be at least 3.
+  ///
+  /// With adaptive sampling, `secondaryRayCount` becomes the average number
+  /// of AO rays per pixel. After the pilot rays, the remaining rays are
+  /// distributed in proportion to each pixel's variance. Flat, unoccluded
+  /// surfaces stop early, while crevices receive up to 100 rays. The shares
+  /// come from the mean variance of the previous frame. The total never
+  /// exceeds the budget: once it runs out, the remaining pixels only trace
+  /// their pilot rays.
+  ///
+  /// Defaults to `nil`, which traces the same number of rays in every pixel.
+  public var pilotRayCount: Int?
+  
+  /// Offline rendering only. Accumulates AO samples across successive calls
+  /// to `render()`, while the camera is unchanged and no atoms were edited.
+  /// The image converges once the standard error of the AO in every pixel
+  /// falls below this value.
+  ///
+  /// Check `Image.isConverged` to stop rendering. A reasonable value is
+  /// 0.005, just under the precision of an 8-bit color channel.
+  ///
+  /// Defaults to `nil`, which disables progressive accumulation.
+  public var convergenceThreshold: Float?
+  
+  /// While the camera is stationary, only re-trace the tiles of the screen
+  /// near edited atoms. Editing one part of a large static scene then costs
+  /// in proportion to the size of the edit.
+  ///
+  /// Not compatible with upscaling, temporal reuse, or progressive
+  /// accumulation. They rely on every pixel being traced in every frame.
+  ///
+  /// Defaults to `false`.
+  public var usesPartialRendering: Bool
+  
   init(isOffline: Bool) {
     self.position = SIMD3(0, 0, 0)
     self.basis = (
@@ -38,6 +85,10 @@ public struct Camera {
       self.secondaryRayCount = 15
     }
     self.criticalPixelCount = 50
+    self.temporalSampleLimit = nil
+    self.pilotRayCount = nil
+    self.convergenceThreshold = nil
+    self.usesPartialRendering = false
   }
 }
 
@@ -189,13 +189,56 @@ extension CommandQueue {
     guard let previousCommandList else {
       return
     }
-    
+    wait(commandList: previousCommandList)
+  }
+  
+  /// Stall until the specified command list, and every command list before
+  /// it, has completed.
+  func wait(commandList: CommandList) {
+    #if os(macOS)
+    commandList.mtlCommandBuffer.waitUntilCompleted()
+    #else
+    try! d3d12Fence.SetEventOnCompletion(
+      commandList.fenceValue, eventHandle)
+    WaitForSingleObject(eventHandle, UInt32.max)
+    #endif
+  }
+  
+  /// Stall until the specified command list has completed. Unlike
+  /// 'wait(commandList:)', safe to call from a thread other than the one
+  /// encoding commands.
+  func waitConcurrently(commandList: CommandList) {
     #if os(macOS)
-    previousCommandList.mtlCommandBuffer.waitUntilCompleted()
+    commandList.mtlCommandBuffer.waitUntilCompleted()
     #else
+    guard !isCompleted(commandList: commandList) else {
+      return
+    }
+    
+    // The shared event handle belongs to the encoding thread.
+    let eventHandle = CreateEventA(nil, false, false, nil)
+    guard let eventHandle else {
+      fatalError("Failed to create event handle.")
+    }
     try! d3d12Fence.SetEventOnCompletion(
-      previousCommandList.fenceValue, eventHandle)
+      commandList.fenceValue, eventHandle)
     WaitForSingleObject(eventHandle, UInt32.max)
+    CloseHandle(eventHandle)
+    #endif
+  }
+  
+  /// Check whether the command list has completed, without stalling.
+  func isCompleted(commandList: CommandList) -> Bool {
+    #if os(macOS)
+    switch commandList.mtlCommandBuffer.status {
+    case .completed, .error:
+      return true
+    default:
+      return false
+    }
+    #else
+    let currentFenceValue = try! d3d12Fence.GetCompletedValue()
+    return currentFenceValue >= commandList.fenceValue
     #endif
   }
 }
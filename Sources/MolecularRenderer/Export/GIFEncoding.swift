@@ -0,0 +1,261 @@
+// Streaming GIF89a encoder. Every frame has its own 256-color palette, so
+// frames are quantized and compressed independently, on separate threads.
+// Only the header and trailer are shared.
+enum GIFEncoding {
+  static func createHeader(frameBufferSize: SIMD2<Int>) -> [UInt8] {
+    var output: [UInt8] = []
+    output += Array("GIF89a".utf8)
+    
+    // Logical screen descriptor, without a global color table.
+    append(UInt16(frameBufferSize[0]), to: &output)
+    append(UInt16(frameBufferSize[1]), to: &output)
+    output += [0x00, 0x00, 0x00]
+    
+    // Loop the animation forever.
+    output += [0x21, 0xFF, 0x0B]
+    output += Array("NETSCAPE2.0".utf8)
+    output += [0x03, 0x01, 0x00, 0x00, 0x00]
+    return output
+  }
+  
+  static var trailer: [UInt8] { [0x3B] }
+  
+  // The delay time is in units of 0.01 seconds.
+  static func createFrame(
+    pixels: [SIMD4<UInt8>],
+    frameBufferSize: SIMD2<Int>,
+    delayTime: Int
+  ) -> [UInt8] {
+    let (palette, indices) = quantize(pixels: pixels)
+    
+    var output: [UInt8] = []
+    
+    // Graphic control extension.
+    output += [0x21, 0xF9, 0x04, 0x00]
+    append(UInt16(delayTime), to: &output)
+    output += [0x00, 0x00]
+    
+    // Image descriptor, with a local color table of 256 entries.
+    output += [0x2C]
+    append(UInt16(0), to: &output)
+    append(UInt16(0), to: &output)
+    append(UInt16(frameBufferSize[0]), to: &output)
+    append(UInt16(frameBufferSize[1]), to: &output)
+    output += [0x87]
+    for paletteID in 0..<256 {
+      let color = (paletteID < palette.count) ? palette[paletteID] : .zero
+      output += [color[0], color[1], color[2]]
+    }
+    
+    // Image data, split into sub-blocks of at most 255 bytes.
+    output += [0x08]
+    let compressed = compress(indices: indices)
+    var start = 0
+    while start < compressed.count {
+      let end = min(start + 255, compressed.count)
+      output.append(UInt8(end - start))
+      output += compressed[start..<end]
+      start = end
+    }
+    output += [0x00]
+    return output
+  }
+  
+  private static func append(_ value: UInt16, to output: inout [UInt8]) {
+    output.append(UInt8(truncatingIfNeeded: value))
+    output.append(UInt8(truncatingIfNeeded: value >> 8))
+  }
+}
+
+// MARK: - Quantization
+
+extension GIFEncoding {
+  // A range of occupied histogram bins, for median cut.
+  private struct Box {
+    var start: Int
+    var end: Int
+    var pixelCount: Int
+  }
+  
+  // Median cut over a histogram with 5 bits per channel. Returns the palette,
+  // and the palette index of every pixel.
+  static func quantize(
+    pixels: [SIMD4<UInt8>]
+  ) -> (palette: [SIMD3<UInt8>], indices: [UInt8]) {
+    func binID(_ pixel: SIMD4<UInt8>) -> Int {
+      let r = Int(pixel[0] >> 3)
+      let g = Int(pixel[1] >> 3)
+      let b = Int(pixel[2] >> 3)
+      return (r << 10) | (g << 5) | b
+    }
+    func binCoords(_ binID: Int) -> SIMD3<Int> {
+      SIMD3((binID >> 10) & 31, (binID >> 5) & 31, binID & 31)
+    }
+    
+    // Accumulate the histogram, with the exact colors for averaging.
+    var binCounts = [Int](repeating: .zero, count: 32768)
+    var binSums = [SIMD3<Int>](repeating: .zero, count: 32768)
+    for pixel in pixels {
+      let binID = binID(pixel)
+      binCounts[binID] += 1
+      binSums[binID] &+= SIMD3(Int(pixel[0]), Int(pixel[1]), Int(pixel[2]))
+    }
+    var occupiedBins: [Int] = []
+    for binID in 0..<32768 where binCounts[binID] > 0 {
+      occupiedBins.append(binID)
+    }
+    
+    // Split the box with the widest channel range, at the median pixel.
+    var boxes: [Box] = []
+    boxes.append(Box(
+      start: 0, end: occupiedBins.count, pixelCount: pixels.count))
+    while boxes.count < 256 {
+      var selectedBoxID: Int?
+      var selectedAxis = 0
+      var selectedRange = 0
+      for boxID in boxes.indices {
+        let box = boxes[boxID]
+        guard box.end - box.start > 1 else {
+          continue
+        }
+        
+        var minimum = SIMD3<Int>(repeating: 31)
+        var maximum = SIMD3<Int>(repeating: 0)
+        for i in box.start..<box.end {
+          let coords = binCoords(occupiedBins[i])
+          minimum = pointwiseMin(minimum, coords)
+          maximum = pointwiseMax(maximum, coords)
+        }
+        let range = maximum &- minimum
+        for axis in 0..<3 where range[axis] > selectedRange {
+          selectedBoxID = boxID
+          selectedAxis = axis
+          selectedRange = range[axis]
+        }
+      }
+      guard let selectedBoxID else {
+        break
+      }
+      
+      let box = boxes[selectedBoxID]
+      occupiedBins[box.start..<box.end].sort {
+        binCoords($0)[selectedAxis] < binCoords($1)[selectedAxis]
+      }
+      var splitIndex = box.start + 1
+      var lowerCount = binCounts[occupiedBins[box.start]]
+      while splitIndex < box.end - 1,
+            2 * lowerCount < box.pixelCount {
+        lowerCount += binCounts[occupiedBins[splitIndex]]
+        splitIndex += 1
+      }
+      boxes[selectedBoxID] = Box(
+        start: box.start, end: splitIndex, pixelCount: lowerCount)
+      boxes.append(Box(
+        start: splitIndex, end: box.end,
+        pixelCount: box.pixelCount - lowerCount))
+    }
+    
+    // Average the colors in each box.
+    var palette: [SIMD3<UInt8>] = []
+    var binPalette = [UInt8](repeating: .zero, count: 32768)
+    for boxID in boxes.indices {
+      let box = boxes[boxID]
+      var sum: SIMD3<Int> = .zero
+      for i in box.start..<box.end {
+        let binID = occupiedBins[i]
+        sum &+= binSums[binID]
+        binPalette[binID] = UInt8(boxID)
+      }
+      let average = sum / max(box.pixelCount, 1)
+      palette.append(SIMD3<UInt8>(truncatingIfNeeded: average))
+    }
+    
+    var indices = [UInt8](repeating: .zero, count: pixels.count)
+    for pixelID in pixels.indices {
+      indices[pixelID] = binPalette[binID(pixels[pixelID])]
+    }
+    return (palette, indices)
+  }
+}
+
+// MARK: - Compression
+
+extension GIFEncoding {
+  // Variable-length LZW with 8-bit symbols. The dictionary is an open
+  // addressing hash table, which is cheap to reset after every clear code.
+  static func compress(indices: [UInt8]) -> [UInt8] {
+    let clearCode = 256
+    let endCode = 257
+    let tableSize = 5003
+    
+    var output: [UInt8] = []
+    var bitBuffer: UInt32 = 0
+    var bitCount: UInt32 = 0
+    var codeSize: UInt32 = 9
+    func emit(_ code: Int) {
+      bitBuffer |= UInt32(code) << bitCount
+      bitCount += codeSize
+      while bitCount >= 8 {
+        output.append(UInt8(truncatingIfNeeded: bitBuffer))
+        bitBuffer >>= 8
+        bitCount -= 8
+      }
+    }
+    
+    var hashKeys = [Int32](repeating: -1, count: tableSize)
+    var hashCodes = [UInt16](repeating: .zero, count: tableSize)
+    var maxCode = endCode
+    emit(clearCode)
+    guard indices.count > 0 else {
+      emit(endCode)
+      if bitCount > 0 {
+        output.append(UInt8(truncatingIfNeeded: bitBuffer))
+      }
+      return output
+    }
+    
+    var prefix = Int(indices[0])
+    for i in 1..<indices.count {
+      let symbol = Int(indices[i])
+      let key = Int32((prefix << 8) | symbol)
+      
+      // Probe the hash table.
+      var slot = ((symbol << 4) ^ prefix) % tableSize
+      var found = false
+      while hashKeys[slot] >= 0 {
+        if hashKeys[slot] == key {
+          found = true
+          break
+        }
+        slot = (slot == 0) ? tableSize - 1 : slot - 1
+      }
+      if found {
+        prefix = Int(hashCodes[slot])
+        continue
+      }
+      
+      emit(prefix)
+      maxCode += 1
+      hashKeys[slot] = key
+      hashCodes[slot] = UInt16(maxCode)
+      if maxCode >= (1 << codeSize) {
+        codeSize += 1
+      }
+      if maxCode == 4095 {
+        emit(clearCode)
+        for slot in 0..<tableSize {
+          hashKeys[slot] = -1
+        }
+        codeSize = 9
+        maxCode = endCode
+      }
+      prefix = symbol
+    }
+    emit(prefix)
+    emit(endCode)
+    if bitCount > 0 {
+      output.append(UInt8(truncatingIfNeeded: bitBuffer))
+    }
+    return output
+  }
+}
@@ -0,0 +1,225 @@
+import Dispatch
+import Foundation
+
+public enum ExportFormat {
+  /// Animated GIF, with a separate palette for every frame. The frame rate
+  /// must divide evenly into 100 FPS.
+  case gif
+  
+  /// One PNG file per frame, named 'frame-00000.png' and so on. The path
+  /// is a directory.
+  case png
+  
+  /// Raw 8-bit RGBA, with the frames packed back to back.
+  case rgba
+  
+  /// YUV4MPEG2 video with 4:4:4 chroma, which FFmpeg reads directly.
+  case y4m
+}
+
+public struct ImageExporterDescriptor {
+  /// The file format to stream the images into.
+  public var format: ExportFormat?
+  
+  /// The destination file, or the destination directory for PNG.
+  public var path: String?
+  
+  /// The resolution of every image, in pixels.
+  public var frameBufferSize: SIMD2<Int>?
+  
+  /// The playback rate of the video, in frames per second.
+  public var frameRate: Int?
+  
+  /// Maximum number of images that may wait to be encoded. Once the queue
+  /// is full, `append(image:)` stalls until the oldest image is written.
+  public var queueCapacity: Int = 8
+  
+  public init() {
+    
+  }
+}
+
+// Converts and encodes images on a concurrent queue, several frames at a
+// time. A serial queue writes the encoded frames in order.
+public class ImageExporter {
+  public let format: ExportFormat
+  public let path: String
+  public let frameBufferSize: SIMD2<Int>
+  public let frameRate: Int
+  
+  let encodeQueue: DispatchQueue
+  let writeQueue: DispatchQueue
+  let queueSemaphore: DispatchSemaphore
+  var fileHandle: FileHandle?
+  var frameCount: Int = .zero
+  var isFinished: Bool = false
+  
+  public init(descriptor: ImageExporterDescriptor) {
+    guard let format = descriptor.format,
+          let path = descriptor.path,
+          let frameBufferSize = descriptor.frameBufferSize,
+          let frameRate = descriptor.frameRate else {
+      fatalError("Descriptor was incomplete.")
+    }
+    guard descriptor.queueCapacity > 0 else {
+      fatalError("Queue capacity must be at least 1.")
+    }
+    if format == .gif {
+      guard 100 % frameRate == 0 else {
+        fatalError("GIF cannot encode this frame rate.")
+      }
+    }
+    self.format = format
+    self.path = path
+    self.frameBufferSize = frameBufferSize
+    self.frameRate = frameRate
+    
+    self.encodeQueue = DispatchQueue(
+      label: "ImageExporter.encodeQueue", attributes: .concurrent)
+    self.writeQueue = DispatchQueue(
+      label: "ImageExporter.writeQueue")
+    self.queueSemaphore = DispatchSemaphore(value: descriptor.queueCapacity)
+    
+    if format == .png {
+      try! FileManager.default.createDirectory(
+        atPath: path, withIntermediateDirectories: true)
+    } else {
+      let succeeded = FileManager.default.createFile(
+        atPath: path, contents: nil)
+      guard succeeded,
+            let fileHandle = FileHandle(forWritingAtPath: path) else {
+        fatalError("Could not write to file.")
+      }
+      self.fileHandle = fileHandle
+      write(bytes: createHeader())
+    }
+  }
+  
+  /// Queue an image for export. Returns once the image is queued, not once
+  /// it is written.
+  public func append(image: Image) {
+    guard !isFinished else {
+      fatalError("Exporter was already finished.")
+    }
+    queueSemaphore.wait()
+    
+    nonisolated(unsafe)
+    let format = self.format
+    let frameBufferSize = self.frameBufferSize
+    let frameRate = self.frameRate
+    let frameID = frameCount
+    let pixels = image.pixels
+    frameCount += 1
+    
+    // The write closure waits for the encoded bytes. The group orders the
+    // accesses to the shared storage.
+    final class EncodedFrame {
+      var bytes: [UInt8] = []
+    }
+    nonisolated(unsafe)
+    let encodedFrame = EncodedFrame()
+    let group = DispatchGroup()
+    group.enter()
+    encodeQueue.async {
+      encodedFrame.bytes = ImageExporter.encode(
+        pixels: pixels,
+        format: format,
+        frameBufferSize: frameBufferSize,
+        frameRate: frameRate)
+      group.leave()
+    }
+    
+    nonisolated(unsafe)
+    let selfReference = self
+    writeQueue.async {
+      group.wait()
+      if format == .png {
+        selfReference.writeFile(bytes: encodedFrame.bytes, frameID: frameID)
+      } else {
+        selfReference.write(bytes: encodedFrame.bytes)
+      }
+      selfReference.queueSemaphore.signal()
+    }
+  }
+  
+  /// Stall until every queued image is written, then close the file.
+  public func finish() {
+    guard !isFinished else {
+      return
+    }
+    isFinished = true
+    
+    writeQueue.sync {
+      if format == .gif {
+        write(bytes: GIFEncoding.trailer)
+      }
+      try! fileHandle?.close()
+      fileHandle = nil
+    }
+  }
+}
+
+extension ImageExporter {
+  private func createHeader() -> [UInt8] {
+    switch format {
+    case .gif:
+      return GIFEncoding.createHeader(frameBufferSize: frameBufferSize)
+    case .png, .rgba:
+      return []
+    case .y4m:
+      var header = "YUV4MPEG2"
+      header += " W\(frameBufferSize[0]) H\(frameBufferSize[1])"
+      header += " F\(frameRate):1 Ip A1:1 C444\n"
+      return Array(header.utf8)
+    }
+  }
+  
+  private static func encode(
+    pixels: [SIMD4<Float16>],
+    format: ExportFormat,
+    frameBufferSize: SIMD2<Int>,
+    frameRate: Int
+  ) -> [UInt8] {
+    let rgba = PixelConversion.convertToRGBA8(
+      pixels: pixels, frameBufferSize: frameBufferSize)
+    
+    switch format {
+    case .gif:
+      return GIFEncoding.createFrame(
+        pixels: rgba,
+        frameBufferSize: frameBufferSize,
+        delayTime: 100 / frameRate)
+    case .png:
+      return PNGEncoding.createFile(
+        pixels: rgba,
+        frameBufferSize: frameBufferSize)
+    case .rgba:
+      return rgba.withUnsafeBytes { bufferPointer in
+        Array(bufferPointer)
+      }
+    case .y4m:
+      let planes = PixelConversion.convertToYCbCr(pixels: rgba)
+      return Array("FRAME\n".utf8) + planes
+    }
+  }
+  
+  private func write(bytes: [UInt8]) {
+    guard bytes.count > 0 else {
+      return
+    }
+    try! fileHandle!.write(contentsOf: bytes)
+  }
+  
+  private func writeFile(bytes: [UInt8], frameID: Int) {
+    var fileName = String(frameID)
+    while fileName.count < 5 {
+      fileName = "0" + fileName
+    }
+    let filePath = "\(path)/frame-\(fileName).png"
+    let succeeded = FileManager.default.createFile(
+      atPath: filePath, contents: Data(bytes))
+    guard succeeded else {
+      fatalError("Could not write to file.")
+    }
+  }
+}
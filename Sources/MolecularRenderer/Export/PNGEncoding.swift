@@ -0,0 +1,99 @@
+// Minimal PNG encoder for 8-bit RGB images. The image data is stored in
+// uncompressed deflate blocks, trading file size for encoding speed.
+// Recompress the sequence with an external tool if the size matters.
+enum PNGEncoding {
+  private static let crcTable: [UInt32] = {
+    var output: [UInt32] = []
+    for i in 0..<256 {
+      var value = UInt32(i)
+      for _ in 0..<8 {
+        if value & 1 != 0 {
+          value = 0xEDB8_8320 ^ (value >> 1)
+        } else {
+          value >>= 1
+        }
+      }
+      output.append(value)
+    }
+    return output
+  }()
+  
+  static func createFile(
+    pixels: [SIMD4<UInt8>],
+    frameBufferSize: SIMD2<Int>
+  ) -> [UInt8] {
+    let width = frameBufferSize[0]
+    let height = frameBufferSize[1]
+    
+    // Each row starts with the filter type, which is always 'none'.
+    var rawData: [UInt8] = []
+    rawData.reserveCapacity(height * (1 + 3 * width))
+    for y in 0..<height {
+      rawData.append(0)
+      for x in 0..<width {
+        let pixel = pixels[y * width + x]
+        rawData += [pixel[0], pixel[1], pixel[2]]
+      }
+    }
+    
+    var output: [UInt8] = [0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A]
+    
+    var header: [UInt8] = []
+    append(UInt32(width), to: &header)
+    append(UInt32(height), to: &header)
+    header += [8, 2, 0, 0, 0]
+    appendChunk(type: "IHDR", data: header, to: &output)
+    appendChunk(type: "IDAT", data: createStream(rawData), to: &output)
+    appendChunk(type: "IEND", data: [], to: &output)
+    return output
+  }
+  
+  // Zlib stream with stored blocks of at most 65535 bytes.
+  private static func createStream(_ data: [UInt8]) -> [UInt8] {
+    var output: [UInt8] = [0x78, 0x01]
+    var start = 0
+    repeat {
+      let end = min(start + 65535, data.count)
+      let length = UInt16(end - start)
+      output.append((end == data.count) ? 1 : 0)
+      output += [UInt8(length & 0xFF), UInt8(length >> 8)]
+      output += [UInt8(~length & 0xFF), UInt8(~length >> 8)]
+      output += data[start..<end]
+      start = end
+    } while start < data.count
+    
+    var a: UInt32 = 1
+    var b: UInt32 = 0
+    for byte in data {
+      a = (a + UInt32(byte)) % 65521
+      b = (b + a) % 65521
+    }
+    append((b << 16) | a, to: &output)
+    return output
+  }
+  
+  private static func appendChunk(
+    type: String,
+    data: [UInt8],
+    to output: inout [UInt8]
+  ) {
+    let typeAndData = Array(type.utf8) + data
+    append(UInt32(data.count), to: &output)
+    output += typeAndData
+    
+    var crc: UInt32 = 0xFFFF_FFFF
+    for byte in typeAndData {
+      let index = Int((crc ^ UInt32(byte)) & 0xFF)
+      crc = crcTable[index] ^ (crc >> 8)
+    }
+    append(~crc, to: &output)
+  }
+  
+  // PNG stores integers in big-endian order.
+  private static func append(_ value: UInt32, to output: inout [UInt8]) {
+    output.append(UInt8(truncatingIfNeeded: value >> 24))
+    output.append(UInt8(truncatingIfNeeded: value >> 16))
+    output.append(UInt8(truncatingIfNeeded: value >> 8))
+    output.append(UInt8(truncatingIfNeeded: value))
+  }
+}
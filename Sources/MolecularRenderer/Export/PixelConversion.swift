@@ -0,0 +1,119 @@
+import Dispatch
+
+// The shaders write display-referred colors, which the swap chain presents
+// without a transfer function. The exported sRGB values are the same colors,
+// quantized to 8 bits.
+//
+// The conversions run on the export threads, so they use GCD instead of
+// 'WorkerPool.shared'. The pool serializes its callers, and export jobs
+// would stall the per-frame stages of the render thread.
+enum PixelConversion {
+  // Rows per task, for splitting a frame across the CPU cores.
+  private static var taskSize: Int { 64 }
+  
+  // Converts 4 pixels at a time, in 16-wide vectors. Casting floating point
+  // vectors to integer vectors is slow on Windows, so the channels are
+  // extracted with scalar conversions.
+  static func convertToRGBA8(
+    pixels: [SIMD4<Float16>],
+    frameBufferSize: SIMD2<Int>
+  ) -> [SIMD4<UInt8>] {
+    let width = frameBufferSize[0]
+    let height = frameBufferSize[1]
+    guard pixels.count == width * height else {
+      fatalError("Image did not match the frame buffer size.")
+    }
+    
+    var output = [SIMD4<UInt8>](repeating: .zero, count: pixels.count)
+    let taskCount = (height + taskSize - 1) / taskSize
+    pixels.withUnsafeBufferPointer { inputPointer in
+      output.withUnsafeMutableBufferPointer { outputPointer in
+        nonisolated(unsafe)
+        let safeInput = inputPointer
+        nonisolated(unsafe)
+        let safeOutput = outputPointer
+        DispatchQueue.concurrentPerform(iterations: taskCount) { taskID in
+          let start = taskID * taskSize * width
+          let end = min(start + taskSize * width, pixels.count)
+          
+          var address = start
+          while address + 4 <= end {
+            var vector = SIMD16<Float>(
+              lowHalf: SIMD8(
+                lowHalf: SIMD4<Float>(safeInput[address]),
+                highHalf: SIMD4<Float>(safeInput[address + 1])),
+              highHalf: SIMD8(
+                lowHalf: SIMD4<Float>(safeInput[address + 2]),
+                highHalf: SIMD4<Float>(safeInput[address + 3])))
+            vector.replace(with: 0, where: .!(vector .>= 0))
+            vector.replace(with: 1, where: vector .> 1)
+            vector = (vector * 255 + 0.5).rounded(.down)
+            
+            for i in 0..<4 {
+              safeOutput[address + i] = SIMD4(
+                UInt8(vector[i * 4 + 0]),
+                UInt8(vector[i * 4 + 1]),
+                UInt8(vector[i * 4 + 2]),
+                UInt8(vector[i * 4 + 3]))
+            }
+            address += 4
+          }
+          
+          // Remainder for widths not divisible by 4.
+          while address < end {
+            var vector = SIMD4<Float>(safeInput[address])
+            vector.replace(with: 0, where: .!(vector .>= 0))
+            vector.replace(with: 1, where: vector .> 1)
+            vector = (vector * 255 + 0.5).rounded(.down)
+            safeOutput[address] = SIMD4(
+              UInt8(vector[0]),
+              UInt8(vector[1]),
+              UInt8(vector[2]),
+              UInt8(vector[3]))
+            address += 1
+          }
+        }
+      }
+    }
+    return output
+  }
+  
+  // Converts to 3 full resolution planes of 8-bit YCbCr (4:4:4), with the
+  // Rec. 709 coefficients and limited range. This is the default
+  // interpretation of a YUV4MPEG2 stream in FFmpeg.
+  static func convertToYCbCr(
+    pixels: [SIMD4<UInt8>]
+  ) -> [UInt8] {
+    let pixelCount = pixels.count
+    var output = [UInt8](repeating: .zero, count: 3 * pixelCount)
+    let taskCount = (pixelCount + 65535) / 65536
+    output.withUnsafeMutableBufferPointer { outputPointer in
+      nonisolated(unsafe)
+      let safeOutput = outputPointer
+      DispatchQueue.concurrentPerform(iterations: taskCount) { taskID in
+        let start = taskID * 65536
+        let end = min(start + 65536, pixelCount)
+        for address in start..<end {
+          let pixel = pixels[address]
+          let r = Float(pixel[0]) / 255
+          let g = Float(pixel[1]) / 255
+          let b = Float(pixel[2]) / 255
+          
+          let luma = 0.2126 * r + 0.7152 * g + 0.0722 * b
+          let chromaBlue = (b - luma) / 1.8556
+          let chromaRed = (r - luma) / 1.5748
+          
+          var yuv = SIMD3<Float>(
+            16 + 219 * luma,
+            128 + 224 * chromaBlue,
+            128 + 224 * chromaRed)
+          yuv = (yuv + 0.5).rounded(.down)
+          safeOutput[address] = UInt8(yuv[0])
+          safeOutput[pixelCount + address] = UInt8(yuv[1])
+          safeOutput[2 * pixelCount + address] = UInt8(yuv[2])
+        }
+      }
+    }
+    return output
+  }
+}
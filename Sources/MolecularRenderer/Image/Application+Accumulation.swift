@@ -0,0 +1,86 @@
+extension Application {
+  // Any change to these settings invalidates the accumulated AO, and the
+  // image reused for static frames. The convergence threshold itself may
+  // change without restarting.
+  static func matches(_ lhs: Camera, _ rhs: Camera) -> Bool {
+    guard lhs.position == rhs.position,
+          lhs.basis.0 == rhs.basis.0,
+          lhs.basis.1 == rhs.basis.1,
+          lhs.basis.2 == rhs.basis.2,
+          lhs.fovAngleVertical == rhs.fovAngleVertical,
+          lhs.secondaryRayCount == rhs.secondaryRayCount,
+          lhs.criticalPixelCount == rhs.criticalPixelCount,
+          lhs.temporalSampleLimit == rhs.temporalSampleLimit,
+          lhs.pilotRayCount == rhs.pilotRayCount,
+          lhs.usesPartialRendering == rhs.usesPartialRendering else {
+      return false
+    }
+    return true
+  }
+  
+  // Restart the accumulation if the scene or camera changed since the
+  // previous frame. Must be called after 'updateBVH', while the
+  // transactionArgs are still available.
+  func updateAccumulation() {
+    guard camera.convergenceThreshold != nil else {
+      imageResources.accumulatedFrameCount = .zero
+      imageResources.accumulatedCamera = nil
+      return
+    }
+    guard display.isOffline else {
+      fatalError("Progressive accumulation requires offline rendering.")
+    }
+    
+    var isStatic = true
+    if let transactionArgs = bvhBuilder.transactionArgs {
+      if transactionArgs.removedCount > 0 ||
+          transactionArgs.movedCount > 0 ||
+          transactionArgs.addedCount > 0 {
+        isStatic = false
+      }
+    }
+    if let accumulatedCamera = imageResources.accumulatedCamera {
+      if !Self.matches(accumulatedCamera, camera) {
+        isStatic = false
+      }
+    } else {
+      isStatic = false
+    }
+    
+    if !isStatic {
+      imageResources.accumulatedFrameCount = .zero
+    }
+    imageResources.accumulatedCamera = camera
+  }
+  
+  func bindAccumulation(commandList: CommandList) {
+    if camera.convergenceThreshold != nil {
+      imageResources.allocateAccumulation(device: device, display: display)
+    }
+    
+    let buffer = imageResources.accumulationBuffer ??
+    imageResources.placeholderBuffer
+    commandList.setBuffer(buffer, index: RenderShader.accumulation)
+  }
+  
+  // Reads the standard error from the alpha channel, then clears it.
+  func resolveConvergence(image: inout Image) {
+    guard let convergenceThreshold = camera.convergenceThreshold else {
+      return
+    }
+    imageResources.accumulatedFrameCount += 1
+    let accumulatedFrameCount = imageResources.accumulatedFrameCount
+    
+    var maximumError: Float = .zero
+    for pixelID in image.pixels.indices {
+      let error = Float(image.pixels[pixelID][3])
+      maximumError = max(maximumError, error)
+      image.pixels[pixelID][3] = 0
+    }
+    
+    // The sample variance is unreliable with only a few frames.
+    image.accumulatedFrameCount = accumulatedFrameCount
+    image.isConverged = (accumulatedFrameCount >= 4) &&
+    (maximumError < convergenceThreshold)
+  }
+}
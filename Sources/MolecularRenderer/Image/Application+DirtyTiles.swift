@@ -0,0 +1,97 @@
+extension Application {
+  // Count the consecutive rendered frames with partial rendering enabled,
+  // where the camera did not move.
+  //
+  // Each color texture is written every other frame. A texture may only skip
+  // the clean tiles if it was written with the same camera, and both masks
+  // since then are present. That is true once this count reaches 2.
+  func updateDirtyTiles() {
+    guard camera.usesPartialRendering else {
+      imageResources.dirtyTileFrameCount = .zero
+      imageResources.dirtyTileCamera = nil
+      return
+    }
+    guard imageResources.renderTarget.upscaleFactor == 1 else {
+      fatalError("Partial rendering is not compatible with upscaling.")
+    }
+    guard camera.temporalSampleLimit == nil else {
+      fatalError("Partial rendering is not compatible with temporal reuse.")
+    }
+    guard camera.convergenceThreshold == nil else {
+      fatalError("Partial rendering is not compatible with accumulation.")
+    }
+    
+    if let dirtyTileCamera = imageResources.dirtyTileCamera,
+       Self.matches(dirtyTileCamera, camera) {
+      imageResources.dirtyTileFrameCount += 1
+    } else {
+      imageResources.dirtyTileFrameCount = .zero
+    }
+    imageResources.dirtyTileCamera = camera
+  }
+  
+  var tracesDirtyTilesOnly: Bool {
+    camera.usesPartialRendering && imageResources.dirtyTileFrameCount >= 2
+  }
+  
+  // Clear this frame's mask, then mark the tiles covered by the voxel groups
+  // rebuilt in this frame. Skipped BVH updates leave the mask empty.
+  func encodeDirtyTiles(
+    commandList: CommandList,
+    renderArgs: RenderArgs
+  ) {
+    guard camera.usesPartialRendering else {
+      return
+    }
+    imageResources.allocateDirtyTiles(device: device, display: display)
+    
+    let dirtyTiles = imageResources.dirtyTiles!
+    let sliceSize = dirtyTiles.size / 2
+    bvhBuilder.clearBuffer(
+      commandList: commandList,
+      clearValue: 0,
+      clearedBuffer: dirtyTiles,
+      size: sliceSize,
+      offset: (frameID % 2) * sliceSize)
+    
+    #if os(Windows)
+    bvhBuilder.computeUAVBarrier(commandList: commandList)
+    #endif
+    
+    guard bvhBuilder.transactionArgs != nil else {
+      return
+    }
+    
+    commandList.withPipelineState(imageResources.dirtyTileShader) {
+      bvhBuilder.counters.crashBuffer.setBufferBindings(
+        commandList: commandList)
+      
+      commandList.set32BitConstants(
+        renderArgs, index: DirtyTileShader.renderArgs)
+      let cameraArgsBuffer = imageResources.cameraArgsBuffer
+        .nativeBuffers[frameID % 3]
+      commandList.setBuffer(
+        cameraArgsBuffer, index: DirtyTileShader.cameraArgs)
+      commandList.setBuffer(
+        bvhBuilder.voxels.group.rebuiltGroupCoords,
+        index: DirtyTileShader.rebuiltGroupCoords)
+      commandList.setBuffer(
+        dirtyTiles, index: DirtyTileShader.dirtyTiles)
+      
+      let offset = GeneralCounters.offset(.rebuiltGroupCount)
+      commandList.dispatchIndirect(
+        buffer: bvhBuilder.counters.general,
+        offset: offset)
+    }
+    
+    #if os(Windows)
+    bvhBuilder.computeUAVBarrier(commandList: commandList)
+    #endif
+  }
+  
+  func bindDirtyTiles(commandList: CommandList) {
+    let buffer = imageResources.dirtyTiles ??
+    imageResources.placeholderBuffer
+    commandList.setBuffer(buffer, index: RenderShader.dirtyTiles)
+  }
+}
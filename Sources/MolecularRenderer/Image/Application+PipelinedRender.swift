@@ -0,0 +1,95 @@
+extension Application {
+  /// Encode the next frame, without waiting for the GPU to finish it.
+  /// Offline rendering only.
+  ///
+  /// Up to 3 frames may be in flight. When every slot is taken, this function
+  /// stalls until the oldest frame has finished. Retrieve the images with
+  /// 'pollImages()' or 'flushImages()'. They are returned in the order the
+  /// frames were submitted.
+  public func submitRender() {
+    guard frameID >= 0 else {
+      fatalError("Not allowed to call render here.")
+    }
+    guard display.isOffline else {
+      fatalError("Pipelined rendering requires offline rendering.")
+    }
+    guard camera.convergenceThreshold == nil else {
+      fatalError("Pipelined rendering is not compatible with accumulation.")
+    }
+    imageResources.allocateReadbackRing(device: device, display: display)
+    
+    // Free the in-flight slot for this frame. Afterward, the crash buffer and
+    // execution times from 3 frames ago are safe to read.
+    while let pendingFrameID = imageResources.pendingFrameIDs.first,
+          pendingFrameID <= frameID - 3 {
+      retireFrame()
+    }
+    
+    // The frame 3 frames before may not have gone through the readback ring.
+    // Its last command list still reads and writes this in-flight slot.
+    if let slotCommandList = bvhBuilder.slotCommandLists[frameID % 3] {
+      device.commandQueue.wait(commandList: slotCommandList)
+    }
+    
+    checkCrashBuffer(frameID: frameID)
+    checkExecutionTime(frameID: frameID)
+    updateBVH(inFlightFrameID: frameID % 3)
+    validateCameraArgs()
+    
+    // Reused images would be returned ahead of the frames still in flight.
+    imageResources.staticFrameCount = .zero
+    imageResources.staticCamera = nil
+    
+    writeCameraArgs()
+    updateAccumulation()
+    updateDirtyTiles()
+    encodeRender(isPipelined: true)
+    
+    forgetIdleState(inFlightFrameID: frameID % 3)
+    
+    // The forget command list downloads the crash buffer, resolves the
+    // timestamps, and resets the motion vectors. It finishes the frame.
+    imageResources.readbackRing!.register(
+      commandList: bvhBuilder.slotCommandLists[frameID % 3]!,
+      inFlightFrameID: frameID % 3)
+    imageResources.renderedFrameID = frameID
+    imageResources.pendingFrameIDs.append(frameID)
+    frameID += 1
+    launchPipelinedTransaction()
+  }
+  
+  /// Return the images of every finished frame, without stalling.
+  public func pollImages() -> [Image] {
+    let readbackRing = imageResources.readbackRing
+    while let pendingFrameID = imageResources.pendingFrameIDs.first,
+          readbackRing!.isCompleted(inFlightFrameID: pendingFrameID % 3) {
+      retireFrame()
+    }
+    
+    let output = imageResources.completedImages
+    imageResources.completedImages = []
+    return output
+  }
+  
+  /// Stall until every frame in flight has finished, then return the images.
+  public func flushImages() -> [Image] {
+    while imageResources.pendingFrameIDs.count > 0 {
+      retireFrame()
+    }
+    
+    let output = imageResources.completedImages
+    imageResources.completedImages = []
+    return output
+  }
+  
+  // Copies the pixels of the oldest frame in flight, stalling if needed.
+  private func retireFrame() {
+    let pendingFrameID = imageResources.pendingFrameIDs.removeFirst()
+    let readbackRing = imageResources.readbackRing!
+    
+    var output = Image()
+    output.pixels = readbackRing.read(inFlightFrameID: pendingFrameID % 3)
+    output.scaleFactor = 1
+    imageResources.completedImages.append(output)
+  }
+}
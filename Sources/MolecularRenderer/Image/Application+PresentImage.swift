@@ -47,8 +47,19 @@ extension Application {
       fatalError("Received image with incorrect scale factor.")
     }
     
+    let startTime = Telemetry.currentTime
+    defer {
+      telemetry.record(
+        startTime: startTime, stage: .present, frameID: frameID)
+    }
+    
     func createFrontBuffer() -> RenderTarget.Texture {
-      let frontBufferID = frameID % 2
+      // A reused image is still in the buffers of the frame that rendered it.
+      var frontBufferID = frameID % 2
+      if image.isReused,
+         let renderedFrameID = imageResources.renderedFrameID {
+        frontBufferID = renderedFrameID % 2
+      }
       if imageResources.renderTarget.upscaleFactor == 1 {
         return imageResources.renderTarget.colorTextures[frontBufferID]
       } else {
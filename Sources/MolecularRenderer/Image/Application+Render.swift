@@ -1,4 +1,5 @@
 import func Foundation.tan
+import MolecularRendererCPU
 #if os(Windows)
 import SwiftCOM
 import WinSDK
@@ -16,7 +17,7 @@ private func transpose(basis: Basis) -> Basis {
 }
 
 extension Application {
-  private func validateCameraArgs() {
+  func validateCameraArgs() {
     func check(basis: Basis) {
       let dotProduct00 = (basis.0 * basis.0).sum()
       let dotProduct11 = (basis.1 * basis.1).sum()
@@ -53,7 +54,7 @@ extension Application {
     check(basis: transposed)
   }
   
-  private func writeCameraArgs() {
+  func writeCameraArgs() {
     var currentCameraArgs = CameraArgs()
     currentCameraArgs.position = (
       camera.position[0],
@@ -112,9 +113,101 @@ extension Application {
       renderArgs.criticalPixelCount = Float(0)
     }
     
+    if let convergenceThreshold = camera.convergenceThreshold {
+      guard convergenceThreshold > 0 else {
+        fatalError("Convergence threshold must be positive.")
+      }
+      renderArgs.convergenceThreshold = convergenceThreshold
+      renderArgs.accumulatedFrameCount = UInt32(
+        imageResources.accumulatedFrameCount)
+    } else {
+      renderArgs.convergenceThreshold = Float(0)
+    }
+    
+    if let pilotRayCount = camera.pilotRayCount {
+      guard pilotRayCount >= 3 else {
+        fatalError("Pilot ray count must be at least 3.")
+      }
+      renderArgs.pilotRayCount = Float(pilotRayCount)
+      renderArgs.varianceSlot = UInt32(frameID % 2)
+    } else {
+      renderArgs.pilotRayCount = Float(0)
+    }
+    
+    if tracesDirtyTilesOnly {
+      renderArgs.usesDirtyTiles = 1
+    }
+    renderArgs.dirtyTileSlot = UInt32(frameID % 2)
+    
+    if let temporalSampleLimit = camera.temporalSampleLimit {
+      guard temporalSampleLimit >= 1 else {
+        fatalError("Temporal sample limit must be at least 1.")
+      }
+      renderArgs.temporalSampleLimit = Float(temporalSampleLimit)
+      
+      // The history is only valid if the previous frame wrote to it.
+      if imageResources.aoHistoryFrameID == frameID - 1 {
+        renderArgs.reusesHistory = 1
+      }
+    } else {
+      renderArgs.temporalSampleLimit = Float(0)
+    }
+    
     return renderArgs
   }
   
+  private func bindAOHistory(commandList: CommandList) {
+    guard camera.temporalSampleLimit != nil else {
+      commandList.setBuffer(
+        imageResources.placeholderBuffer,
+        index: RenderShader.aoHistory)
+      commandList.setBuffer(
+        imageResources.placeholderBuffer,
+        index: RenderShader.previousAOHistory)
+      imageResources.aoHistoryFrameID = nil
+      return
+    }
+    
+    imageResources.allocateAOHistory(device: device, display: display)
+    let buffers = imageResources.aoHistoryBuffers
+    commandList.setBuffer(
+      buffers[frameID % 2],
+      index: RenderShader.aoHistory)
+    commandList.setBuffer(
+      buffers[(frameID + 1) % 2],
+      index: RenderShader.previousAOHistory)
+    imageResources.aoHistoryFrameID = frameID
+  }
+  
+  // Clear the slot of the variance statistics written by this frame. If the
+  // previous frame did not use adaptive sampling, also clear its slot.
+  private func clearVarianceStatistics(commandList: CommandList) {
+    guard camera.pilotRayCount != nil else {
+      imageResources.varianceFrameID = nil
+      return
+    }
+    
+    if imageResources.varianceFrameID == frameID - 1 {
+      bvhBuilder.clearBuffer(
+        commandList: commandList,
+        clearValue: 0,
+        clearedBuffer: imageResources.varianceStatistics,
+        size: 16,
+        offset: (frameID % 2) * 16)
+    } else {
+      bvhBuilder.clearBuffer(
+        commandList: commandList,
+        clearValue: 0,
+        clearedBuffer: imageResources.varianceStatistics,
+        size: 32)
+    }
+    imageResources.varianceFrameID = frameID
+    
+    #if os(Windows)
+    bvhBuilder.computeUAVBarrier(commandList: commandList)
+    #endif
+  }
+  
   public func render() -> Image {
     guard frameID >= 0 else {
       fatalError("Not allowed to call render here.")
@@ -124,8 +217,36 @@ extension Application {
     checkExecutionTime(frameID: frameID)
     updateBVH(inFlightFrameID: frameID % 3)
     validateCameraArgs()
+    if updateStaticFrame() {
+      return reuseImage()
+    }
     writeCameraArgs()
+    updateAccumulation()
+    updateDirtyTiles()
+    encodeRender(isPipelined: false)
+    
+    forgetIdleState(inFlightFrameID: frameID % 3)
+    imageResources.renderedFrameID = frameID
     
+    if display.isOffline {
+      frameID += 1
+    }
+    launchPipelinedTransaction()
+    
+    var output = Image()
+    if display.isOffline {
+      output = readImage()
+      resolveConvergence(image: &output)
+      imageResources.renderedPixels = output.pixels
+    }
+    output.scaleFactor = 1
+    return output
+  }
+  
+  // Encodes the render pass for the current camera, in a single command list.
+  // Pipelined frames copy the render target into the readback ring, instead
+  // of the single output buffer.
+  func encodeRender(isPipelined: Bool) {
     device.commandQueue.withCommandList { commandList in
       #if os(Windows)
       try! commandList.d3d12CommandList.EndQuery(
@@ -142,14 +263,25 @@ extension Application {
         inFlightFrameID: frameID % 3)
       #endif
       
+      clearVarianceStatistics(commandList: commandList)
+      let renderArgs = createRenderArgs()
+      encodeDirtyTiles(
+        commandList: commandList,
+        renderArgs: renderArgs)
+      
       // Encode the compute command.
       commandList.withPipelineState(imageResources.renderShader) {
         bvhBuilder.counters.crashBuffer.setBufferBindings(
           commandList: commandList)
         
-        let renderArgs = createRenderArgs()
         commandList.set32BitConstants(
           renderArgs, index: RenderShader.renderArgs)
+        bindAOHistory(commandList: commandList)
+        bindAccumulation(commandList: commandList)
+        commandList.setBuffer(
+          imageResources.varianceStatistics,
+          index: RenderShader.varianceStatistics)
+        bindDirtyTiles(commandList: commandList)
         
         let cameraArgsBuffer = imageResources.cameraArgsBuffer
           .nativeBuffers[frameID % 3]
@@ -171,6 +303,9 @@ extension Application {
         commandList.setBuffer(
           bvhBuilder.voxels.group.occupiedMarks32,
           index: RenderShader.voxelGroup32OccupiedMarks)
+        commandList.setBuffer(
+          bvhBuilder.voxels.group.occupiedMarks128,
+          index: RenderShader.voxelGroup128OccupiedMarks)
         commandList.setBuffer(
           bvhBuilder.voxels.dense.assignedSlotIDs,
           index: RenderShader.assignedSlotIDs)
@@ -248,7 +383,7 @@ extension Application {
       #if os(Windows)
       bvhBuilder.computeUAVBarrier(commandList: commandList)
       
-      if display.isOffline {
+      if display.isOffline, !isPipelined {
         let nativeBuffer = imageResources.renderTarget.nativeBuffer!
         let outputBuffer = imageResources.renderTarget.outputBuffer!
         commandList.download(
@@ -270,8 +405,17 @@ extension Application {
         2,
         destinationBuffer.d3d12Resource,
         16)
+      bvhBuilder.counters.resolvedStages[frameID % 3][1] = 1
       #endif
       
+      if isPipelined {
+        let readbackRing = imageResources.readbackRing!
+        readbackRing.download(
+          commandList: commandList,
+          nativeBuffer: imageResources.renderTarget.nativeBuffer!,
+          inFlightFrameID: frameID % 3)
+      }
+      
       #if os(macOS)
       nonisolated(unsafe)
       let selfReference = self
@@ -284,35 +428,35 @@ extension Application {
           selfReference.bvhBuilder.counters
             .renderLatencies[inFlightFrameID] = latencyMicroseconds
         }
+        TraceRecorder.recordGPU(
+          "render",
+          startSeconds: commandBuffer.gpuStartTime,
+          endSeconds: commandBuffer.gpuEndTime)
       }
       #endif
     }
+  }
+  
+  // Offline rendering only. Waits for the GPU, then copies the pixels out of
+  // the render target.
+  func readImage() -> Image {
+    device.commandQueue.flush()
     
-    forgetIdleState(inFlightFrameID: frameID % 3)
+    #if os(macOS)
+    let buffer = imageResources.renderTarget.nativeBuffer!
+    #else
+    let buffer = imageResources.renderTarget.outputBuffer!
+    #endif
     
-    if display.isOffline {
-      frameID += 1
+    let frameBufferSize = display.frameBufferSize
+    let pixelCount = frameBufferSize[0] * frameBufferSize[1]
+    var data = [SIMD4<Float16>](repeating: .zero, count: pixelCount)
+    data.withUnsafeMutableBytes { bufferPointer in
+      buffer.read(output: bufferPointer)
     }
     
     var output = Image()
-    if display.isOffline {
-      device.commandQueue.flush()
-      
-      #if os(macOS)
-      let buffer = imageResources.renderTarget.nativeBuffer!
-      #else
-      let buffer = imageResources.renderTarget.outputBuffer!
-      #endif
-      
-      let frameBufferSize = display.frameBufferSize
-      let pixelCount = frameBufferSize[0] * frameBufferSize[1]
-      var data = [SIMD4<Float16>](repeating: .zero, count: pixelCount)
-      data.withUnsafeMutableBytes { bufferPointer in
-        buffer.read(output: bufferPointer)
-      }
-      
-      output.pixels = data
-    }
+    output.pixels = data
     output.scaleFactor = 1
     return output
   }
@@ -0,0 +1,80 @@
+extension Application {
+  // Features that carry state from one frame to the next. A batch renders the
+  // same frame from several cameras, so this state would be overwritten by
+  // every view.
+  private static func validateBatch(camera: Camera) {
+    guard camera.temporalSampleLimit == nil else {
+      fatalError("Batched rendering is not compatible with temporal reuse.")
+    }
+    guard camera.convergenceThreshold == nil else {
+      fatalError("Batched rendering is not compatible with accumulation.")
+    }
+    guard !camera.usesPartialRendering else {
+      fatalError(
+        "Batched rendering is not compatible with partial rendering.")
+    }
+  }
+  
+  // The next call to 'render()' must not treat its camera as stationary, as
+  // the render target was overwritten by the views of the batch.
+  private func forgetFrameHistory() {
+    imageResources.previousCameraArgs = nil
+    imageResources.staticFrameCount = .zero
+    imageResources.staticCamera = nil
+    imageResources.accumulatedFrameCount = .zero
+    imageResources.accumulatedCamera = nil
+    imageResources.dirtyTileFrameCount = .zero
+    imageResources.dirtyTileCamera = nil
+  }
+  
+  /// Render the same frame from several cameras. Offline rendering only.
+  ///
+  /// The atoms are uploaded, and the BVH is updated, once for the entire
+  /// batch. The views are traced and read back in order. Returns one image per
+  /// camera, and counts as a single frame.
+  ///
+  /// Afterward, 'camera' is restored to its value before the call.
+  public func render(cameras: [Camera]) -> [Image] {
+    guard frameID >= 0 else {
+      fatalError("Not allowed to call render here.")
+    }
+    guard display.isOffline else {
+      fatalError("Batched rendering requires offline rendering.")
+    }
+    guard cameras.count > 0 else {
+      fatalError("Batch had no cameras.")
+    }
+    for camera in cameras {
+      Self.validateBatch(camera: camera)
+    }
+    
+    checkCrashBuffer(frameID: frameID)
+    checkExecutionTime(frameID: frameID)
+    updateBVH(inFlightFrameID: frameID % 3)
+    
+    let originalCamera = camera
+    var output: [Image] = []
+    for viewCamera in cameras {
+      camera = viewCamera
+      validateCameraArgs()
+      
+      // Motion vectors have no meaning between two views.
+      imageResources.previousCameraArgs = nil
+      writeCameraArgs()
+      encodeRender(isPipelined: false)
+      
+      // Waits for this view before the next one overwrites the render target
+      // and the camera args.
+      output.append(readImage())
+    }
+    camera = originalCamera
+    
+    forgetIdleState(inFlightFrameID: frameID % 3)
+    forgetFrameHistory()
+    imageResources.renderedFrameID = frameID
+    frameID += 1
+    launchPipelinedTransaction()
+    
+    return output
+  }
+}
@@ -0,0 +1,48 @@
+extension Application {
+  // Number of consecutive static frames to render before reusing the image.
+  // Gives the upscaler and the temporal AO history time to converge.
+  private static var settlingFrameCount: Int { 16 }
+  
+  // Returns whether the previous image can be presented again. Must be called
+  // after 'updateBVH', while the transactionArgs are still available.
+  //
+  // Progressive accumulation always renders, as every frame adds samples.
+  func updateStaticFrame() -> Bool {
+    var isStatic = bvhBuilder.transactionArgs == nil
+    if let staticCamera = imageResources.staticCamera {
+      if !Self.matches(staticCamera, camera) {
+        isStatic = false
+      }
+    } else {
+      isStatic = false
+    }
+    if camera.convergenceThreshold != nil {
+      isStatic = false
+    }
+    imageResources.staticCamera = camera
+    
+    if isStatic {
+      imageResources.staticFrameCount += 1
+    } else {
+      imageResources.staticFrameCount = .zero
+    }
+    guard imageResources.renderedFrameID != nil else {
+      return false
+    }
+    return imageResources.staticFrameCount > Self.settlingFrameCount
+  }
+  
+  // Skips the render and forget processes. The crash buffer and execution
+  // times from the last rendered frame remain in place.
+  func reuseImage() -> Image {
+    var output = Image()
+    output.isReused = true
+    
+    if display.isOffline {
+      output.pixels = imageResources.renderedPixels
+      frameID += 1
+    }
+    output.scaleFactor = 1
+    return output
+  }
+}
@@ -1,3 +1,4 @@
+import MolecularRendererCPU
 #if os(Windows)
 import FidelityFX
 import SwiftCOM
@@ -113,9 +114,14 @@ extension Application {
     guard image.scaleFactor == 1 else {
       fatalError("Received image with incorrect scale factor.")
     }
-    standardUpscale()
     
+    // The upscaled texture from the rendered frame is still valid.
     var output = Image()
+    if image.isReused {
+      output.isReused = true
+    } else {
+      standardUpscale()
+    }
     output.scaleFactor = imageResources.renderTarget.upscaleFactor
     return output
   }
@@ -168,6 +174,10 @@ extension Application {
           selfReference.bvhBuilder.counters
             .upscaleLatencies[inFlightFrameID] = latencyMicroseconds
         }
+        TraceRecorder.recordGPU(
+          "upscale",
+          startSeconds: commandBuffer.gpuStartTime,
+          endSeconds: commandBuffer.gpuEndTime)
       }
     }
     #else
@@ -252,6 +262,7 @@ extension Application {
         2,
         destinationBuffer.d3d12Resource,
         48)
+      bvhBuilder.counters.resolvedStages[frameID % 3][3] = 1
     }
     #endif
   }
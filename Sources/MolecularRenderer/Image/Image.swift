@@ -3,5 +3,17 @@ public struct Image {
   /// offline rendering.
   public var pixels: [SIMD4<Float16>] = []
   
+  /// Whether progressive accumulation has met the convergence threshold.
+  /// Always `false` when the camera has no convergence threshold.
+  public var isConverged: Bool = false
+  
+  /// Number of frames accumulated into this image, including the current
+  /// one. Equals 1 when progressive accumulation is disabled.
+  public var accumulatedFrameCount: Int = 1
+  
+  /// Whether the image repeats the previous frame, because neither the atoms
+  /// nor the camera changed. No GPU work was encoded to create it.
+  public var isReused: Bool = false
+  
   var scaleFactor: Float = .zero
 }
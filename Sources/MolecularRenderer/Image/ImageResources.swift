@@ -3,6 +3,7 @@ struct ImageResourcesDescriptor {
   var display: Display?
   var memorySlotCount: Int?
   var upscaleFactor: Float?
+  var usesCoarseOccupancy: Bool = false
   var worldDimension: Float?
 }
 
@@ -14,6 +15,43 @@ class ImageResources {
   var cameraArgsBuffer: RingBuffer
   var previousCameraArgs: CameraArgs?
   
+  // Bound in place of optional buffers that were never allocated.
+  let placeholderBuffer: Buffer
+  
+  // Ping-pong buffers for temporal AO reuse. Allocated on the first frame
+  // that enables it.
+  var aoHistoryBuffers: [Buffer] = []
+  var aoHistoryFrameID: Int?
+  
+  // Progressive accumulation for offline rendering. Allocated on the first
+  // frame that enables it.
+  var accumulationBuffer: Buffer?
+  var accumulatedFrameCount: Int = .zero
+  var accumulatedCamera: Camera?
+  
+  // Per-frame variance statistics for adaptive sampling.
+  let varianceStatistics: Buffer
+  var varianceFrameID: Int?
+  
+  // State for reusing the previous frame while the scene is static.
+  var staticFrameCount: Int = .zero
+  var staticCamera: Camera?
+  var renderedFrameID: Int?
+  var renderedPixels: [SIMD4<Float16>] = []
+  
+  // Ping-pong masks of the tiles changed in each frame, for partial
+  // rendering. Allocated on the first frame that enables it.
+  let dirtyTileShader: Shader
+  var dirtyTiles: Buffer?
+  var dirtyTileFrameCount: Int = .zero
+  var dirtyTileCamera: Camera?
+  
+  // Frames in flight during pipelined offline rendering, and the images read
+  // back but not yet returned. Allocated on the first pipelined frame.
+  var readbackRing: ReadbackRing?
+  var pendingFrameIDs: [Int] = []
+  var completedImages: [Image] = []
+  
   init(descriptor: ImageResourcesDescriptor) {
     guard let device = descriptor.device,
           let display = descriptor.display,
@@ -21,6 +59,7 @@ class ImageResources {
       fatalError("Descriptor was incomplete.")
     }
     self.renderShader = Self.createRenderShader(descriptor: descriptor)
+    self.dirtyTileShader = Self.createDirtyTileShader(descriptor: descriptor)
 
     var renderTargetDesc = RenderTargetDescriptor()
     renderTargetDesc.device = device
@@ -40,8 +79,67 @@ class ImageResources {
     
     self.cameraArgsBuffer = Self.createCameraArgsBuffer(device: device)
     self.previousCameraArgs = nil
+    self.placeholderBuffer = Self.createPixelBuffer(
+      device: device, pixelCount: 1)
+    self.varianceStatistics = Self.createPixelBuffer(
+      device: device, pixelCount: 2)
+  }
+  
+  func allocateAOHistory(device: Device, display: Display) {
+    guard aoHistoryBuffers.isEmpty else {
+      return
+    }
+    
+    let intermediateSize = renderTarget.intermediateSize(display: display)
+    let pixelCount = intermediateSize[0] * intermediateSize[1]
+    for _ in 0..<2 {
+      let buffer = Self.createPixelBuffer(
+        device: device, pixelCount: pixelCount)
+      aoHistoryBuffers.append(buffer)
+    }
+  }
+  
+  func allocateAccumulation(device: Device, display: Display) {
+    guard accumulationBuffer == nil else {
+      return
+    }
+    
+    let intermediateSize = renderTarget.intermediateSize(display: display)
+    let pixelCount = intermediateSize[0] * intermediateSize[1]
+    accumulationBuffer = Self.createPixelBuffer(
+      device: device, pixelCount: pixelCount)
   }
 
+  func allocateReadbackRing(device: Device, display: Display) {
+    guard readbackRing == nil else {
+      return
+    }
+    
+    let frameBufferSize = display.frameBufferSize
+    var readbackRingDesc = ReadbackRingDescriptor()
+    readbackRingDesc.device = device
+    readbackRingDesc.size = frameBufferSize[0] * frameBufferSize[1] * 8
+    readbackRing = ReadbackRing(descriptor: readbackRingDesc)
+  }
+  
+  func allocateDirtyTiles(device: Device, display: Display) {
+    guard dirtyTiles == nil else {
+      return
+    }
+    
+    // 1 bit per tile, for 2 frames.
+    let tileSize = DirtyTileShader.tileSize
+    let intermediateSize = renderTarget.intermediateSize(display: display)
+    let tileCount = (intermediateSize &+ tileSize &- 1) / tileSize
+    let wordCount = (tileCount[0] * tileCount[1] + 31) / 32
+    
+    var bufferDesc = BufferDescriptor()
+    bufferDesc.device = device
+    bufferDesc.size = 2 * wordCount * 4
+    bufferDesc.type = .native(.device)
+    dirtyTiles = Buffer(descriptor: bufferDesc)
+  }
+  
   private static func createRenderShader(
     descriptor: ImageResourcesDescriptor
   ) -> Shader {
@@ -58,6 +156,7 @@ class ImageResources {
     renderShaderDesc.memorySlotCount = memorySlotCount
     renderShaderDesc.supports16BitTypes = device.supports16BitTypes
     renderShaderDesc.upscaleFactor = upscaleFactor
+    renderShaderDesc.usesCoarseOccupancy = descriptor.usesCoarseOccupancy
     renderShaderDesc.worldDimension = worldDimension
     let renderShaderSource = RenderShader.createSource(
       descriptor: renderShaderDesc)
@@ -73,6 +172,23 @@ class ImageResources {
     return Shader(descriptor: shaderDesc)
   }
   
+  private static func createDirtyTileShader(
+    descriptor: ImageResourcesDescriptor
+  ) -> Shader {
+    guard let device = descriptor.device,
+          let worldDimension = descriptor.worldDimension else {
+      fatalError("Descriptor was incomplete.")
+    }
+    
+    var shaderDesc = ShaderDescriptor()
+    shaderDesc.device = device
+    shaderDesc.name = "projectDirtyTiles"
+    shaderDesc.threadsPerGroup = SIMD3(64, 1, 1)
+    shaderDesc.source = DirtyTileShader.createSource(
+      worldDimension: worldDimension)
+    return Shader(descriptor: shaderDesc)
+  }
+  
   private static func createCameraArgsBuffer(
     device: Device
   ) -> RingBuffer {
@@ -82,4 +198,16 @@ class ImageResources {
     ringBufferDesc.size = MemoryLayout<CameraArgs>.stride * 2
     return RingBuffer(descriptor: ringBufferDesc)
   }
+  
+  // 16 bytes per pixel.
+  private static func createPixelBuffer(
+    device: Device,
+    pixelCount: Int
+  ) -> Buffer {
+    var bufferDesc = BufferDescriptor()
+    bufferDesc.device = device
+    bufferDesc.size = pixelCount * 16
+    bufferDesc.type = .native(.device)
+    return Buffer(descriptor: bufferDesc)
+  }
 }
@@ -0,0 +1,100 @@
+#if os(macOS)
+import Metal
+#endif
+
+// Pipelined offline rendering. Each frame in flight copies the render target
+// into its own host-visible buffer, so the CPU can read a finished frame
+// while the GPU renders the next ones.
+// - 3 download buffers, indexed by the in-flight frame ID
+// - The last command list of the frame that filled each buffer, for waiting
+//   or polling
+struct ReadbackRingDescriptor {
+  var device: Device?
+  
+  // Size in bytes, not number of pixels.
+  var size: Int?
+}
+
+class ReadbackRing {
+  unowned let device: Device
+  var outputBuffers: [Buffer] = []
+  var commandLists: [CommandList?] = [nil, nil, nil]
+  
+  init(descriptor: ReadbackRingDescriptor) {
+    guard let device = descriptor.device,
+          let size = descriptor.size else {
+      fatalError("Descriptor was incomplete.")
+    }
+    self.device = device
+    
+    for _ in 0..<3 {
+      var bufferDesc = BufferDescriptor()
+      bufferDesc.device = device
+      bufferDesc.size = size
+      #if os(macOS)
+      bufferDesc.type = .native(.device)
+      #else
+      bufferDesc.type = .output
+      #endif
+      let outputBuffer = Buffer(descriptor: bufferDesc)
+      outputBuffers.append(outputBuffer)
+    }
+  }
+  
+  func download(
+    commandList: CommandList,
+    nativeBuffer: Buffer,
+    inFlightFrameID: Int
+  ) {
+    let outputBuffer = outputBuffers[inFlightFrameID]
+    
+    #if os(macOS)
+    commandList.mtlCommandEncoder.endEncoding()
+    
+    let commandEncoder: MTLBlitCommandEncoder =
+    commandList.mtlCommandBuffer.makeBlitCommandEncoder()!
+    commandEncoder.copy(
+      from: nativeBuffer.mtlBuffer, sourceOffset: 0,
+      to: outputBuffer.mtlBuffer, destinationOffset: 0,
+      size: nativeBuffer.size)
+    commandEncoder.endEncoding()
+    
+    commandList.mtlCommandEncoder =
+    commandList.mtlCommandBuffer.makeComputeCommandEncoder()!
+    #else
+    commandList.download(
+      nativeBuffer: nativeBuffer,
+      outputBuffer: outputBuffer)
+    #endif
+  }
+  
+  // The frame is retired once this command list finishes, not the one that
+  // downloaded the pixels. Command lists committed after the download still
+  // write state that is read when retiring the frame.
+  func register(commandList: CommandList, inFlightFrameID: Int) {
+    commandLists[inFlightFrameID] = commandList
+  }
+  
+  func isCompleted(inFlightFrameID: Int) -> Bool {
+    guard let commandList = commandLists[inFlightFrameID] else {
+      return true
+    }
+    return device.commandQueue.isCompleted(commandList: commandList)
+  }
+  
+  // Stalls until the GPU has written the buffer.
+  func read(inFlightFrameID: Int) -> [SIMD4<Float16>] {
+    if let commandList = commandLists[inFlightFrameID] {
+      device.commandQueue.wait(commandList: commandList)
+      commandLists[inFlightFrameID] = nil
+    }
+    
+    let outputBuffer = outputBuffers[inFlightFrameID]
+    let pixelCount = outputBuffer.size / 8
+    var data = [SIMD4<Float16>](repeating: .zero, count: pixelCount)
+    data.withUnsafeMutableBytes { bufferPointer in
+      outputBuffer.read(output: bufferPointer)
+    }
+    return data
+  }
+}
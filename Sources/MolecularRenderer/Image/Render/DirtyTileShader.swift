@@ -0,0 +1,164 @@
+struct DirtyTileShader {
+  static let renderArgs: Int = 1
+  static let cameraArgs: Int = 2
+  static let rebuiltGroupCoords: Int = 3
+  static let dirtyTiles: Int = 4
+  
+  // Width and height of a tile, in pixels. Must be a multiple of the render
+  // shader's threadgroup size.
+  static var tileSize: Int { 32 }
+  
+  // [numthreads(64, 1, 1)]
+  // dispatch indirect groups SIMD3(rebuilt group count, 1, 1)
+  //
+  // Projects the bounding box of each rebuilt 8 nm voxel group onto the
+  // screen, and marks every tile it overlaps. The box is padded by the reach
+  // of AO rays, so the shading of neighboring atoms is also updated.
+  static func createSource(worldDimension: Float) -> String {
+    // voxels.group.rebuiltGroupCoords
+    // image.dirtyTiles
+    func functionSignature() -> String {
+      #if os(macOS)
+      """
+      kernel void projectDirtyTiles(
+        \(CrashBuffer.functionArguments),
+        constant RenderArgs &renderArgs [[buffer(\(Self.renderArgs))]],
+        constant CameraArgsList &cameraArgs [[buffer(\(Self.cameraArgs))]],
+        device uint *rebuiltGroupCoords [[buffer(\(Self.rebuiltGroupCoords))]],
+        device uint *dirtyTiles [[buffer(\(Self.dirtyTiles))]],
+        uint groupID [[threadgroup_position_in_grid]],
+        uint localID [[thread_position_in_threadgroup]])
+      """
+      #else
+      let byteCount = MemoryLayout<RenderArgs>.size
+      
+      return """
+      \(CrashBuffer.functionArguments)
+      ConstantBuffer<RenderArgs> renderArgs : register(b\(Self.renderArgs));
+      ConstantBuffer<CameraArgsList> cameraArgs : register(b\(Self.cameraArgs));
+      RWStructuredBuffer<uint> rebuiltGroupCoords : register(u\(Self.rebuiltGroupCoords));
+      RWStructuredBuffer<uint> dirtyTiles : register(u\(Self.dirtyTiles));
+      
+      [numthreads(64, 1, 1)]
+      [RootSignature(
+        \(CrashBuffer.rootSignatureArguments)
+        "RootConstants(b\(Self.renderArgs), num32BitConstants = \(byteCount / 4)),"
+        "CBV(b\(Self.cameraArgs)),"
+        "UAV(u\(Self.rebuiltGroupCoords)),"
+        "UAV(u\(Self.dirtyTiles)),"
+      )]
+      void projectDirtyTiles(
+        uint groupID : SV_GroupID,
+        uint localID : SV_GroupThreadID)
+      """
+      #endif
+    }
+    
+    func atomicOr() -> String {
+      #if os(macOS)
+      """
+      atomic_fetch_or_explicit(
+        (device atomic_uint*)dirtyTiles + address, // object
+        bit, // operand
+        memory_order_relaxed); // order
+      """
+      #else
+      """
+      InterlockedOr(
+        dirtyTiles[address], // dest
+        bit); // value
+      """
+      #endif
+    }
+    
+    func cutoffAO() -> Float {
+      Float(1) + 0.25 * Float(3).squareRoot()
+    }
+    
+    return """
+    \(Shader.importStandardLibrary)
+    
+    \(createMatrixUtility())
+    \(RenderArgs.shaderDeclaration)
+    \(CameraArgs.shaderDeclaration)
+    struct CameraArgsList {
+      CameraArgs data[2];
+    };
+    
+    \(functionSignature())
+    {
+      if (crashBuffer[0] != 1) {
+        return;
+      }
+      
+      uint encodedGroupCoords = rebuiltGroupCoords[groupID];
+      uint3 voxelGroupCoords =
+      \(VoxelResources.decode("encodedGroupCoords"));
+      float3 lowerCorner = float3(voxelGroupCoords) * 8;
+      lowerCorner -= \(worldDimension / 2) + \(cutoffAO());
+      float3 upperCorner = lowerCorner + 8 + \(2 * cutoffAO());
+      
+      // Project the corners of the box, as in the motion vectors.
+      float2 screenDimensions = float2(renderArgs.screenDimensions);
+      float2 minimumCoords = 1e38;
+      float2 maximumCoords = -1e38;
+      bool coversScreen = false;
+      for (uint i = 0; i < 8; ++i) {
+        float3 corner = lowerCorner;
+        corner.x = (i & 1) ? upperCorner.x : lowerCorner.x;
+        corner.y = (i & 2) ? upperCorner.y : lowerCorner.y;
+        corner.z = (i & 4) ? upperCorner.z : lowerCorner.z;
+        
+        float3 rayDirection = corner - cameraArgs.data[0].position;
+        Matrix3x3 cameraBasis = cameraArgs.data[0].basis;
+        rayDirection = cameraBasis.transpose().multiply(rayDirection);
+        
+        // Boxes crossing the camera plane cannot be projected.
+        if (rayDirection.z > -1e-3) {
+          coversScreen = true;
+          break;
+        }
+        rayDirection *= -1 / rayDirection.z;
+        
+        float2 screenCoords = rayDirection.xy;
+        screenCoords /= cameraArgs.data[0].tangentFactor;
+        screenCoords.y = -screenCoords.y;
+        screenCoords.x *= screenDimensions.y / screenDimensions.x;
+        screenCoords = (screenCoords + 1) / 2;
+        float2 pixelCoords = screenCoords * screenDimensions;
+        minimumCoords = min(minimumCoords, pixelCoords);
+        maximumCoords = max(maximumCoords, pixelCoords);
+      }
+      
+      // Convert the pixel range to a tile range, with 1 pixel of margin.
+      uint2 tileCount = (renderArgs.screenDimensions + \(tileSize - 1));
+      tileCount /= \(tileSize);
+      float2 tileMinimum = float2(0, 0);
+      float2 tileMaximum = float2(tileCount) - 1;
+      if (!coversScreen) {
+        float2 tileStart = floor((minimumCoords - 1) / \(tileSize));
+        float2 tileEnd = floor((maximumCoords + 1) / \(tileSize));
+        if (any(tileEnd < tileMinimum) || any(tileStart > tileMaximum)) {
+          return;
+        }
+        tileMinimum = max(tileStart, tileMinimum);
+        tileMaximum = min(tileEnd, tileMaximum);
+      }
+      
+      // Mark the tiles, spreading the work across the threadgroup.
+      uint2 rangeStart = uint2(tileMinimum);
+      uint2 rangeSize = uint2(tileMaximum) - rangeStart + 1;
+      uint wordCount = (tileCount.x * tileCount.y + 31) / 32;
+      for (uint i = localID; i < rangeSize.x * rangeSize.y; i += 64) {
+        uint2 tileCoords = rangeStart;
+        tileCoords += uint2(i % rangeSize.x, i / rangeSize.x);
+        uint tileID = tileCoords.y * tileCount.x + tileCoords.x;
+        
+        uint address = renderArgs.dirtyTileSlot * wordCount + tileID / 32;
+        uint bit = uint(1) << (tileID % 32);
+        \(atomicOr())
+      }
+    }
+    """
+  }
+}
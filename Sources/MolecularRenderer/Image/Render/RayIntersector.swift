@@ -60,37 +60,75 @@ private func createTestCell(memorySlotCount: Int) -> String {
     #endif
   }
   
+  // Lists of dense voxels may continue into continuation chunks. The cursor
+  // is relative to the start of the chain, and every 20480 references switch
+  // to the next chunk.
+  func followChain() -> String {
+    let continuationBase = MemorySlot.continuationsOffset / 4
+    
+    return """
+    uint chainSlotID = slotID;
+    uint chainOffset = referenceCursor;
+    if (chainOffset >= 20480) {
+      uint chainID = chainOffset / 20480;
+      uint headerAddress = slotID * \(MemorySlot.header.size / 4);
+      chainSlotID = headers[headerAddress + \(continuationBase - 1) + chainID];
+      chainOffset -= chainID * 20480;
+    }
+    """
+  }
+  
+  // The end of the cell's list is tested once, before the loop. Every cell
+  // that ends within the voxel's own slot takes the first loop, which has no
+  // chain lookup. Only the cells of dense voxels pay for it.
+  func testReferences(_ body: String) -> String {
+    """
+    if (referenceEnd <= 20480) {
+      while (referenceCursor < referenceEnd) {
+        uint chainSlotID = slotID;
+        uint chainOffset = referenceCursor;
+        \(body)
+        referenceCursor += 1;
+      }
+    } else {
+      while (referenceCursor < referenceEnd) {
+        \(followChain())
+        \(body)
+        referenceCursor += 1;
+      }
+    }
+    """
+  }
+  
   func createBody() -> String {
     let overflows16 = SparseVoxelResources.overflows16(
       memorySlotCount: memorySlotCount)
     
     if !overflows16  {
+      let loopBody = """
+      uint listAddress16 = chainSlotID * \(MemorySlot.reference16.size / 2);
+      uint reference16 = references16[listAddress16 + chainOffset];
+      uint atomID = references32[listAddress32 + reference16];
+      float4 atom = atoms[atomID];
+      
+      intersectAtom(result,
+                    query,
+                    atom,
+                    atomID);
+      """
+      
       return """
       uint listAddress32 = slotID * \(MemorySlot.reference32.size / 4);
-      uint listAddress16 = slotID * \(MemorySlot.reference16.size / 2);
       
       // Set the loop bounds register.
       uint referenceCursor = smallHeader & 0xFFFF;
       uint referenceEnd = smallHeader >> 16;
-      referenceCursor += listAddress16;
-      referenceEnd += listAddress16;
       
       // Prevent infinite loops from corrupted BVH data.
       referenceEnd = min(referenceEnd, referenceCursor + 128);
       
       // Test every atom in the voxel.
-      while (referenceCursor < referenceEnd) {
-        uint reference16 = references16[referenceCursor];
-        uint atomID = references32[listAddress32 + reference16];
-        float4 atom = atoms[atomID];
-        
-        intersectAtom(result,
-                      query,
-                      atom,
-                      atomID);
-        
-        referenceCursor += 1;
-      }
+      \(testReferences(loopBody))
       """
     } else {
       #if os(macOS)
@@ -125,10 +163,21 @@ private func createTestCell(memorySlotCount: Int) -> String {
         }
       }
       
+      let loopBody = """
+      device ushort *destination16 = references16 +
+      ulong(chainSlotID) * \(MemorySlot.reference16.size / 2);
+      uint reference16 = destination16[chainOffset];
+      \(getAtomID())
+      float4 atom = atoms[atomID];
+      
+      intersectAtom(result,
+                    query,
+                    atom,
+                    atomID);
+      """
+      
       return """
       \(initializeAddress32())
-      device ushort *destination16 = references16 +
-      ulong(slotID) * \(MemorySlot.reference16.size / 2);
       
       // Set the loop bounds register.
       uint referenceCursor = smallHeader & 0xFFFF;
@@ -138,52 +187,40 @@ private func createTestCell(memorySlotCount: Int) -> String {
       referenceEnd = min(referenceEnd, referenceCursor + 128);
       
       // Test every atom in the voxel.
-      while (referenceCursor < referenceEnd) {
-        uint reference16 = destination16[referenceCursor];
-        \(getAtomID())
-        float4 atom = atoms[atomID];
-        
-        intersectAtom(result,
-                      query,
-                      atom,
-                      atomID);
-        
-        referenceCursor += 1;
-      }
+      \(testReferences(loopBody))
       """
       #else
       let max32BitSlotCount = MemorySlot.reference16.max32BitSlotCount
       
-      return """
-      uint listAddress32 = slotID * \(MemorySlot.reference32.size / 4);
-      uint regionID = slotID / \(max32BitSlotCount);
-      uint listAddress16 = (slotID - regionID * \(max32BitSlotCount)) *
+      let loopBody = """
+      uint regionID = chainSlotID / \(max32BitSlotCount);
+      uint listAddress16 = (chainSlotID - regionID * \(max32BitSlotCount)) *
       \(MemorySlot.reference16.size / 2);
       RWBuffer<uint> destination16 =
       references16[NonUniformResourceIndex(regionID)];
       
+      uint reference16 = destination16[listAddress16 + chainOffset];
+      uint atomID = references32[listAddress32 + reference16];
+      float4 atom = atoms[atomID];
+      
+      intersectAtom(result,
+                    query,
+                    atom,
+                    atomID);
+      """
+      
+      return """
+      uint listAddress32 = slotID * \(MemorySlot.reference32.size / 4);
+      
       // Set the loop bounds register.
       uint referenceCursor = smallHeader & 0xFFFF;
       uint referenceEnd = smallHeader >> 16;
-      referenceCursor += listAddress16;
-      referenceEnd += listAddress16;
       
       // Prevent infinite loops from corrupted BVH data.
       referenceEnd = min(referenceEnd, referenceCursor + 128);
       
       // Test every atom in the voxel.
-      while (referenceCursor < referenceEnd) {
-        uint reference16 = destination16[referenceCursor];
-        uint atomID = references32[listAddress32 + reference16];
-        float4 atom = atoms[atomID];
-        
-        intersectAtom(result,
-                      query,
-                      atom,
-                      atomID);
-        
-        referenceCursor += 1;
-      }
+      \(testReferences(loopBody))
       """
       #endif
     }
@@ -201,6 +238,7 @@ private func createTestCell(memorySlotCount: Int) -> String {
 }
 
 private func createFillMemoryTape(
+  usesCoarseOccupancy: Bool,
   worldDimension: Float
 ) -> String {
   // Arguments for fillMemoryTape that vary by platform.
@@ -224,6 +262,42 @@ private func createFillMemoryTape(
     "float3(\(repeatedValue), \(repeatedValue), \(repeatedValue))"
   }
   
+  // Set the group spacing to 8 nm, 32 nm, or 128 nm based on the marks.
+  func selectGroupSpacing() -> String {
+    guard usesCoarseOccupancy else {
+      return """
+      if (mark32 > 0) {
+        groupSpacing = 8;
+        groupSpacingRecip = \(Float(1) / 8);
+      } else {
+        groupSpacing = 32;
+        groupSpacingRecip = \(Float(1) / 32);
+      }
+      """
+    }
+    
+    // Only read the 128 nm scoped mark when the 32 nm scoped mark is empty.
+    return """
+    if (mark32 > 0) {
+      groupSpacing = 8;
+      groupSpacingRecip = \(Float(1) / 8);
+    } else {
+      uint3 voxelGroup128Coords = voxelGroup32Coords / 4;
+      uint voxelGroup128ID =
+      \(VoxelResources.generate("voxelGroup128Coords", worldDimension / 128));
+      uint mark128 = voxelGroup128OccupiedMarks[voxelGroup128ID];
+      
+      if (mark128 > 0) {
+        groupSpacing = 32;
+        groupSpacingRecip = \(Float(1) / 32);
+      } else {
+        groupSpacing = 128;
+        groupSpacingRecip = \(Float(1) / 128);
+      }
+    }
+    """
+  }
+  
   func checkMemoryTape() -> String {
     outOfBoundsStatement(
       argument: "largeLowerCorner",
@@ -294,16 +368,10 @@ private func createFillMemoryTape(
         \(VoxelResources.generate("voxelGroup32Coords", worldDimension / 32));
         uint mark32 = voxelGroup32OccupiedMarks[voxelGroup32ID];
         
-        // Set the group spacing to 8 nm or 32 nm based on the mark.
+        // Set the group spacing based on the coarser marks.
         float groupSpacing;
         float groupSpacingRecip;
-        if (mark32 > 0) {
-          groupSpacing = 8;
-          groupSpacingRecip = \(Float(1) / 8);
-        } else {
-          groupSpacing = 32;
-          groupSpacingRecip = \(Float(1) / 32);
-        }
+        \(selectGroupSpacing())
         
         // Jump forward to the next cell group.
         //
@@ -313,8 +381,8 @@ private func createFillMemoryTape(
         // - Correct the final value upon exit.
         //
         // WARNING: This algorithm requires that voxel groups are aligned to a
-        // grid centered on the origin. If the number of 32 nm voxel groups is
-        // odd, it will render incorrectly.
+        // grid centered on the origin. If the number of 32 nm or 128 nm voxel
+        // groups is odd, it will render incorrectly.
         largeCellBorder = largeCellBorder * sign;
         largeCellBorder = dda.nextCellGroup(largeCellBorder,
                                             flippedRayOrigin,
@@ -557,6 +625,7 @@ private func createIntersectAO(
 
 func createRayIntersector(
   memorySlotCount: Int,
+  usesCoarseOccupancy: Bool,
   worldDimension: Float
 ) -> String {
   // atoms.atoms
@@ -569,6 +638,7 @@ func createRayIntersector(
     device float4 *atoms;
     device uint *voxelGroup8OccupiedMarks;
     device uint *voxelGroup32OccupiedMarks;
+    device uint *voxelGroup128OccupiedMarks;
     device uint *assignedSlotIDs;
     device uint *headers;
     device uint *references32;
@@ -591,6 +661,7 @@ func createRayIntersector(
     RWStructuredBuffer<float4> atoms;
     RWStructuredBuffer<uint> voxelGroup8OccupiedMarks;
     RWStructuredBuffer<uint> voxelGroup32OccupiedMarks;
+    RWStructuredBuffer<uint> voxelGroup128OccupiedMarks;
     RWStructuredBuffer<uint> assignedSlotIDs;
     RWStructuredBuffer<uint> headers;
     RWStructuredBuffer<uint> references32;
@@ -646,7 +717,9 @@ func createRayIntersector(
     
     \(createTestCell(memorySlotCount: memorySlotCount))
     
-    \(createFillMemoryTape(worldDimension: worldDimension))
+    \(createFillMemoryTape(
+        usesCoarseOccupancy: usesCoarseOccupancy,
+        worldDimension: worldDimension))
     
     \(createIntersectPrimary(worldDimension: worldDimension))
     
@@ -5,6 +5,14 @@ struct RenderArgs {
   var upscaleFactor: Float = .zero
   var secondaryRayCount: Float = .zero
   var criticalPixelCount: Float = .zero
+  var temporalSampleLimit: Float = .zero
+  var reusesHistory: UInt32 = .zero
+  var convergenceThreshold: Float = .zero
+  var accumulatedFrameCount: UInt32 = .zero
+  var pilotRayCount: Float = .zero
+  var varianceSlot: UInt32 = .zero
+  var usesDirtyTiles: UInt32 = .zero
+  var dirtyTileSlot: UInt32 = .zero
   
   static var shaderDeclaration: String {
     """
@@ -15,6 +23,14 @@ struct RenderArgs {
       float upscaleFactor;
       float secondaryRayCount;
       float criticalPixelCount;
+      float temporalSampleLimit;
+      uint reusesHistory;
+      float convergenceThreshold;
+      uint accumulatedFrameCount;
+      float pilotRayCount;
+      uint varianceSlot;
+      uint usesDirtyTiles;
+      uint dirtyTileSlot;
     };
     """
   }
@@ -5,19 +5,29 @@ extension RenderShader {
   static let motionVectors: Int = 4
   static let voxelGroup8OccupiedMarks: Int = 5
   static let voxelGroup32OccupiedMarks: Int = 6
-  static let assignedSlotIDs: Int = 7
-  static let headers: Int = 8
-  static let references32: Int = 9
-  static let references16: Int = 10
-  static let colorTexture: Int = 11
-  static let depthTexture: Int = 12
-  static let motionTexture: Int = 13
+  static let voxelGroup128OccupiedMarks: Int = 7
+  static let assignedSlotIDs: Int = 8
+  static let headers: Int = 9
+  static let references32: Int = 10
+  static let references16: Int = 11
+  static let aoHistory: Int = 12
+  static let previousAOHistory: Int = 13
+  static let accumulation: Int = 14
+  static let varianceStatistics: Int = 15
+  static let dirtyTiles: Int = 16
+  static let colorTexture: Int = 17
+  static let depthTexture: Int = 18
+  static let motionTexture: Int = 19
 
   // atoms.atoms
   // atoms.motionVectors
   // voxels.group.occupiedMarks
   // voxels.dense.assignedSlotIDs
   // voxels.sparse.memorySlots [32, 16]
+  // image.aoHistoryBuffers
+  // image.accumulationBuffer
+  // image.varianceStatistics
+  // image.dirtyTiles
   static func functionSignature(
     descriptor: RenderShaderDescriptor
   ) -> String {
@@ -103,10 +113,16 @@ extension RenderShader {
       device half4 *motionVectors [[buffer(\(Self.motionVectors))]],
       device uint *voxelGroup8OccupiedMarks [[buffer(\(Self.voxelGroup8OccupiedMarks))]],
       device uint *voxelGroup32OccupiedMarks [[buffer(\(Self.voxelGroup32OccupiedMarks))]],
+      device uint *voxelGroup128OccupiedMarks [[buffer(\(Self.voxelGroup128OccupiedMarks))]],
       device uint *assignedSlotIDs [[buffer(\(Self.assignedSlotIDs))]],
       device uint *headers [[buffer(\(Self.headers))]],
       device uint *references32 [[buffer(\(Self.references32))]],
       device ushort *references16 [[buffer(\(Self.references16))]],
+      device uint *aoHistory [[buffer(\(Self.aoHistory))]],
+      device uint *previousAOHistory [[buffer(\(Self.previousAOHistory))]],
+      device float4 *accumulation [[buffer(\(Self.accumulation))]],
+      device uint *varianceStatistics [[buffer(\(Self.varianceStatistics))]],
+      device uint *dirtyTiles [[buffer(\(Self.dirtyTiles))]],
       \(colorTextureArgument()),
       \(upscalingFunctionArguments())
       uint2 pixelCoords [[thread_position_in_grid]],
@@ -123,10 +139,16 @@ extension RenderShader {
     \(motionVectorsArgumentType()) motionVectors : register(u\(Self.motionVectors));
     RWStructuredBuffer<uint> voxelGroup8OccupiedMarks : register(u\(Self.voxelGroup8OccupiedMarks));
     RWStructuredBuffer<uint> voxelGroup32OccupiedMarks : register(u\(Self.voxelGroup32OccupiedMarks));
+    RWStructuredBuffer<uint> voxelGroup128OccupiedMarks : register(u\(Self.voxelGroup128OccupiedMarks));
     RWStructuredBuffer<uint> assignedSlotIDs : register(u\(Self.assignedSlotIDs));
     RWStructuredBuffer<uint> headers : register(u\(Self.headers));
     RWStructuredBuffer<uint> references32 : register(u\(Self.references32));
     \(SparseVoxelResources.ref16FunctionArgument(memorySlotCount))
+    RWStructuredBuffer<uint> aoHistory : register(u\(Self.aoHistory));
+    RWStructuredBuffer<uint> previousAOHistory : register(u\(Self.previousAOHistory));
+    RWStructuredBuffer<float4> accumulation : register(u\(Self.accumulation));
+    RWStructuredBuffer<uint> varianceStatistics : register(u\(Self.varianceStatistics));
+    RWStructuredBuffer<uint> dirtyTiles : register(u\(Self.dirtyTiles));
     \(colorTextureArgument())
     \(upscalingFunctionArguments())
     
@@ -139,10 +161,16 @@ extension RenderShader {
       "\(motionVectorsRootSignatureArgument()),"
       "UAV(u\(Self.voxelGroup8OccupiedMarks)),"
       "UAV(u\(Self.voxelGroup32OccupiedMarks)),"
+      "UAV(u\(Self.voxelGroup128OccupiedMarks)),"
       "UAV(u\(Self.assignedSlotIDs)),"
       "UAV(u\(Self.headers)),"
       "UAV(u\(Self.references32)),"
       "\(SparseVoxelResources.ref16RootSignatureArgument(memorySlotCount)),"
+      "UAV(u\(Self.aoHistory)),"
+      "UAV(u\(Self.previousAOHistory)),"
+      "UAV(u\(Self.accumulation)),"
+      "UAV(u\(Self.varianceStatistics)),"
+      "UAV(u\(Self.dirtyTiles)),"
       "DescriptorTable(UAV(u\(Self.colorTexture), numDescriptors = 1)),"
       \(upscalingRootSignatureArguments())
     )]
@@ -3,6 +3,7 @@ struct RenderShaderDescriptor {
   var memorySlotCount: Int?
   var supports16BitTypes: Bool?
   var upscaleFactor: Float?
+  var usesCoarseOccupancy: Bool = false
   var worldDimension: Float?
 }
 
@@ -47,7 +48,9 @@ struct RenderShader {
       #endif
     }
     
-    func writeColor() -> String {
+    // In offline mode, the alpha channel carries the standard error of the
+    // accumulated AO. It is cleared on the CPU after checking convergence.
+    func writeColor(alpha: String = "0") -> String {
       if !isOffline {
         return write("float4(color, 0)", texture: "colorTexture")
       } else {
@@ -62,7 +65,7 @@ struct RenderShader {
         return """
         uint pixelAddress = pixelCoords.x;
         pixelAddress += pixelCoords.y * renderArgs.screenDimensions.x;
-        colorBuffer[pixelAddress] = \(castHalf4("float4(color, 0)"));
+        colorBuffer[pixelAddress] = \(castHalf4("float4(color, \(alpha))"));
         """
       }
     }
@@ -115,12 +118,11 @@ struct RenderShader {
       """
     }
     
-    func computeMotionVector() -> String {
-      guard upscaleFactor > 1 else {
-        return ""
-      }
-      
-      return """
+    // Shared by the motion vectors and the temporal AO reuse.
+    func computePreviousPixelCoords() -> String {
+      """
+      float2 previousPixelCoords = 0;
+      float previousDistance = 0;
       if (intersect.accept) {
         // Intersection of jittered ray (pixelCoords are jittered).
         float3 currentHitPoint = query.rayOrigin;
@@ -132,7 +134,8 @@ struct RenderShader {
         // Invert mapping: ray intersection -> primary ray direction
         float3 cameraPosition = cameraArgs.data[1].position;
         float3 rayDirection = previousHitPoint - cameraPosition;
-        rayDirection = normalize(rayDirection);
+        previousDistance = length(rayDirection);
+        rayDirection /= previousDistance;
         
         // Undo camera basis mapping.
         Matrix3x3 cameraBasis = cameraArgs.data[1].basis;
@@ -148,9 +151,19 @@ struct RenderShader {
         screenCoords.x *= float(renderArgs.screenDimensions.y);
         screenCoords.x /= float(renderArgs.screenDimensions.x);
         screenCoords = (screenCoords + 1) / 2;
-        float2 previousPixelCoords = screenCoords;
+        previousPixelCoords = screenCoords;
         previousPixelCoords *= float2(renderArgs.screenDimensions);
-        
+      }
+      """
+    }
+    
+    func computeMotionVector() -> String {
+      guard upscaleFactor > 1 else {
+        return ""
+      }
+      
+      return """
+      if (intersect.accept) {
         // Compare against current coordinates.
         float2 currentPixelCoords = float2(pixelCoords) + 0.5;
         currentPixelCoords += renderArgs.jitterOffset;
@@ -169,13 +182,273 @@ struct RenderShader {
       """
     }
     
+    // Layout of each pixel in the AO history, 4 x UInt32:
+    // - atom ID at the primary hit point (UInt32.max if invalid)
+    // - distance from the camera to the primary hit point
+    // - diffuse and specular AO, packed as two 16-bit unorms
+    // - number of accumulated samples
+    func invalidateHistory() -> String {
+      """
+      uint historyAddress = pixelCoords.x;
+      historyAddress += pixelCoords.y * renderArgs.screenDimensions.x;
+      historyAddress *= 4;
+      if (renderArgs.temporalSampleLimit > 0) {
+        aoHistory[historyAddress] = \(UInt32.max);
+      }
+      """
+    }
+    
+    func reuseHistory() -> String {
+      """
+      float historySampleCount = 0;
+      float2 historyAO = 0;
+      if (renderArgs.reusesHistory != 0) {
+        int2 coords = int2(floor(previousPixelCoords));
+        int2 dimensions = int2(renderArgs.screenDimensions);
+        if (all(coords >= 0) && all(coords < dimensions)) {
+          uint address = uint(coords.y * dimensions.x + coords.x) * 4;
+          uint historyAtomID = previousAOHistory[address + 0];
+          uint historyDistance = previousAOHistory[address + 1];
+          uint packedAO = previousAOHistory[address + 2];
+          uint storedSampleCount = previousAOHistory[address + 3];
+          
+          // Reject the history on disocclusion. The same atom at a different
+          // depth happens when its address was reused for another atom.
+          float depthError = \(Shader.asfloat)(historyDistance);
+          depthError = abs(depthError - previousDistance);
+          float depthTolerance = max(float(0.1), 0.02 * previousDistance);
+          if (historyAtomID == intersect.atomID &&
+              depthError < depthTolerance) {
+            historySampleCount = \(Shader.asfloat)(storedSampleCount);
+            historyAO[0] = float(packedAO & 0xFFFF);
+            historyAO[1] = float(packedAO >> 16);
+            historyAO /= 65535;
+          }
+        }
+      }
+      
+      // Weight the history by its sample count.
+      float totalSampleCount = historySampleCount + sampleCount;
+      ambientOcclusion.diffuseAccumulator *= sampleCount;
+      ambientOcclusion.diffuseAccumulator +=
+      historyAO[0] * historySampleCount;
+      ambientOcclusion.diffuseAccumulator /= totalSampleCount;
+      ambientOcclusion.specularAccumulator *= sampleCount;
+      ambientOcclusion.specularAccumulator +=
+      historyAO[1] * historySampleCount;
+      ambientOcclusion.specularAccumulator /= totalSampleCount;
+      
+      // Cap the sample count, so shadows follow moving atoms.
+      totalSampleCount = min(totalSampleCount,
+                             renderArgs.temporalSampleLimit);
+      
+      float2 outputAO = float2(ambientOcclusion.diffuseAccumulator,
+                               ambientOcclusion.specularAccumulator);
+      uint2 quantizedAO = uint2(saturate(outputAO) * 65535 + 0.5);
+      aoHistory[historyAddress + 0] = intersect.atomID;
+      aoHistory[historyAddress + 1] = \(Shader.asuint)(intersect.distance);
+      aoHistory[historyAddress + 2] = quantizedAO[0] | (quantizedAO[1] << 16);
+      aoHistory[historyAddress + 3] = \(Shader.asuint)(totalSampleCount);
+      """
+    }
+    
+    // Layout of each pixel in the accumulation buffer, 4 x FP32:
+    // - sum of the per-frame diffuse AO
+    // - sum of the squared per-frame diffuse AO
+    // - sum of the per-frame specular AO
+    // - number of accumulated frames
+    func accumulateAO() -> String {
+      guard isOffline else {
+        return ""
+      }
+      
+      return """
+      uint accumulationAddress = pixelCoords.x;
+      accumulationAddress += pixelCoords.y * renderArgs.screenDimensions.x;
+      
+      float4 accumulator = 0;
+      if (renderArgs.accumulatedFrameCount > 0) {
+        accumulator = accumulation[accumulationAddress];
+      }
+      float diffuseAO = ambientOcclusion.diffuseAccumulator;
+      float specularAO = ambientOcclusion.specularAccumulator;
+      accumulator += float4(diffuseAO,
+                            diffuseAO * diffuseAO,
+                            specularAO,
+                            1);
+      accumulation[accumulationAddress] = accumulator;
+      
+      // Replace the AO with the mean over all frames.
+      float frameCount = accumulator[3];
+      float diffuseMean = accumulator[0] / frameCount;
+      ambientOcclusion.diffuseAccumulator = diffuseMean;
+      ambientOcclusion.specularAccumulator = accumulator[2] / frameCount;
+      
+      // Standard error of the mean, from the unbiased sample variance. With
+      // a single frame, the error is unknown.
+      if (frameCount > 1) {
+        float variance = accumulator[1] / frameCount;
+        variance -= diffuseMean * diffuseMean;
+        variance = max(variance, float(0));
+        variance *= frameCount / (frameCount - 1);
+        convergenceError = sqrt(variance / frameCount);
+      } else {
+        convergenceError = 1;
+      }
+      """
+    }
+    
+    func declareConvergenceError() -> String {
+      guard isOffline else {
+        return ""
+      }
+      return "float convergenceError = 0;"
+    }
+    
+    // Statistics for adaptive sampling, 2 slots x 4 x UInt32:
+    // - sum of the per-pixel variance, in fixed point with 10 fractional bits
+    //   (low and high words of a 64-bit integer)
+    // - number of pixels
+    // - number of extra rays requested
+    //
+    // The current frame accumulates into one slot, while the previous frame's
+    // slot provides the mean variance and the pixel count. The 64-bit sum
+    // cannot overflow at any resolution.
+    //
+    // The extra rays are a fixed budget per frame: the previous frame's pixel
+    // count, times the extra rays per pixel of the camera ('secondaryRayCount'
+    // minus 'pilotRayCount'). Pixels reserve rays from the budget in the
+    // order they finish their pilot rays. Once it runs out, the remaining
+    // pixels only keep their pilot rays.
+    func allocateExtraRays() -> String {
+      func atomicAdd(_ address: String, _ operand: String) -> String {
+        #if os(macOS)
+        """
+        atomic_fetch_add_explicit(
+          (device atomic_uint*)varianceStatistics + \(address), // object
+          \(operand), // operand
+          memory_order_relaxed); // order
+        """
+        #else
+        """
+        InterlockedAdd(
+          varianceStatistics[\(address)], // dest
+          \(operand)); // value
+        """
+        #endif
+      }
+      
+      func atomicFetchAdd(
+        _ address: String,
+        _ operand: String,
+        output: String
+      ) -> String {
+        #if os(macOS)
+        let buffer = "(device atomic_uint*)varianceStatistics"
+        #else
+        let buffer = "varianceStatistics"
+        #endif
+        
+        return Reduction.atomicFetchAdd(
+          buffer: buffer,
+          address: address,
+          operand: operand,
+          output: output)
+      }
+      
+      return """
+      float pilotMean = ambientOcclusion.diffuseAccumulator / pilotCount;
+      float variance = diffuseSquaredSum / pilotCount;
+      variance -= pilotMean * pilotMean;
+      variance = max(variance, float(0));
+      variance *= pilotCount / (pilotCount - 1);
+      
+      // Reduce within the SIMD before the atomics.
+      uint fixedPointVariance = uint(variance * 1024 + 0.5);
+      uint varianceSum = \(Reduction.waveActiveSum("fixedPointVariance"));
+      uint pixelCount = \(Reduction.waveActiveCountBits("true"));
+      uint slotAddress = renderArgs.varianceSlot * 4;
+      if (\(Reduction.waveIsFirstLane())) {
+        // Carry into the high word when the low word wraps around.
+        uint lowWord;
+        \(atomicFetchAdd("slotAddress", "varianceSum", output: "lowWord"))
+        if (lowWord + varianceSum < lowWord) {
+          \(atomicAdd("slotAddress + 1", "1"))
+        }
+        \(atomicAdd("slotAddress + 2", "pixelCount"))
+      }
+      
+      // Spend the remaining budget in proportion to the variance. Without
+      // statistics from the previous frame, spend it uniformly.
+      uint previousAddress = (1 - renderArgs.varianceSlot) * 4;
+      float previousSum = float(varianceStatistics[previousAddress + 0]);
+      float previousHigh = float(varianceStatistics[previousAddress + 1]);
+      previousSum += previousHigh * 4.294967296e9;
+      float previousCount = float(varianceStatistics[previousAddress + 2]);
+      float extraCount = sampleCount - pilotCount;
+      if (previousSum > 0) {
+        float meanVariance = previousSum / (1024 * previousCount);
+        extraCount *= variance / meanVariance;
+      }
+      extraCount = round(extraCount);
+      extraCount = clamp(extraCount, float(0), 100 - pilotCount);
+      
+      // Reserve the rays from this frame's budget.
+      if (previousSum > 0) {
+        uint requestedCount = uint(extraCount);
+        uint requestedPrefix =
+        \(Reduction.wavePrefixSum("requestedCount"));
+        uint requestedSum = \(Reduction.waveActiveSum("requestedCount"));
+        uint requestedBase = 0;
+        if (\(Reduction.waveIsFirstLane())) {
+          \(atomicFetchAdd(
+            "slotAddress + 3", "requestedSum", output: "requestedBase"))
+        }
+        requestedBase = \(Reduction.waveReadLaneFirst("requestedBase"));
+        
+        // The same limit for every lane. 'sampleCount' varies between
+        // pixels when 'criticalPixelCount' reduces distant pixels.
+        float budgetPerPixel = min(renderArgs.secondaryRayCount, float(100));
+        budgetPerPixel -= renderArgs.pilotRayCount;
+        budgetPerPixel = max(budgetPerPixel, float(0));
+        float budget = budgetPerPixel * previousCount;
+        float remaining = budget - float(requestedBase + requestedPrefix);
+        extraCount = clamp(remaining, float(0), extraCount);
+      }
+      loopCount = pilotCount + extraCount;
+      """
+    }
+    
     func atomicNumber(_ input: String) -> String {
       "\(Shader.asuint)(\(input)) & 0xFF"
     }
 
+    // Keep the color from two frames ago, unless the tile changed during
+    // this frame or the previous one. Uniform across the threadgroup.
+    func skipCleanTile() -> String {
+      let tileSize = DirtyTileShader.tileSize
+      
+      return """
+      if (renderArgs.usesDirtyTiles) {
+        uint2 tileCount = (renderArgs.screenDimensions + \(tileSize - 1));
+        tileCount /= \(tileSize);
+        uint2 tileCoords = pixelCoords / \(tileSize);
+        uint tileID = tileCoords.y * tileCount.x + tileCoords.x;
+        
+        uint wordCount = (tileCount.x * tileCount.y + 31) / 32;
+        uint word = dirtyTiles[tileID / 32];
+        word |= dirtyTiles[wordCount + tileID / 32];
+        if ((word & (uint(1) << (tileID % 32))) == 0) {
+          return;
+        }
+      }
+      """
+    }
+    
     func rayIntersector() -> String {
       createRayIntersector(
         memorySlotCount: memorySlotCount,
+        usesCoarseOccupancy: descriptor.usesCoarseOccupancy,
         worldDimension: worldDimension)
     }
     
@@ -211,11 +484,14 @@ struct RenderShader {
         return;
       }
       
+      \(skipCleanTile())
+      
       // Prepare the ray intersector.
       RayIntersector rayIntersector;
       rayIntersector.atoms = atoms;
       rayIntersector.voxelGroup8OccupiedMarks = voxelGroup8OccupiedMarks;
       rayIntersector.voxelGroup32OccupiedMarks = voxelGroup32OccupiedMarks;
+      rayIntersector.voxelGroup128OccupiedMarks = voxelGroup128OccupiedMarks;
       rayIntersector.assignedSlotIDs = assignedSlotIDs;
       rayIntersector.headers = headers;
       rayIntersector.references32 = references32;
@@ -240,11 +516,14 @@ struct RenderShader {
       IntersectionResult intersect = rayIntersector.intersectPrimary(query);
       
       // Write the depth and motion vector ASAP, reducing register pressure.
+      \(computePreviousPixelCoords())
       \(computeDepth())
       \(computeMotionVector())
+      \(invalidateHistory())
       
       // Background color.
       float3 color = float3(0.707, 0.707, 0.707);
+      \(declareConvergenceError())
       
       // Use the color of the hit atom.
       if (intersect.accept) {
@@ -289,12 +568,31 @@ struct RenderShader {
           generationContext.seed = RayGeneration::createSeed(
             pixelCoords, renderArgs.frameSeed);
           
+          // With adaptive sampling, the loop is extended after the pilot
+          // rays. The pilot and extra rays are stratified separately.
+          float pilotCount = sampleCount;
+          if (renderArgs.pilotRayCount > 0) {
+            pilotCount = min(renderArgs.pilotRayCount, sampleCount);
+          }
+          float loopCount = pilotCount;
+          float diffuseSquaredSum = 0;
+          
           // Iterate over the AO samples.
-          for (float i = 0; i < sampleCount; ++i) {
+          for (float i = 0; i < loopCount; ++i) {
+            float stratumID = i;
+            float stratumCount = pilotCount;
+            if (i >= pilotCount) {
+              stratumID = i - pilotCount;
+              stratumCount = loopCount - pilotCount;
+            }
+            
             // Spawn a secondary ray.
             float3 secondaryRayOrigin = hitPoint + 1e-4 * float3(hitNormal);
             float3 secondaryRayDirection = generationContext
-              .secondaryRayDirection(i, sampleCount, hitPoint, hitNormal);
+              .secondaryRayDirection(stratumID,
+                                     stratumCount,
+                                     hitPoint,
+                                     hitNormal);
             
             // Intersect the secondary ray.
             IntersectionQuery query;
@@ -317,11 +615,28 @@ struct RenderShader {
             // Accumulate into the sum of AO samples.
             ambientOcclusion.diffuseAccumulator += diffuseAmbient;
             ambientOcclusion.specularAccumulator += specularAmbient;
+            diffuseSquaredSum += diffuseAmbient * diffuseAmbient;
+            
+            // After the last pilot ray, pick the number of extra rays.
+            if (renderArgs.pilotRayCount > 0 && i == pilotCount - 1) {
+              \(allocateExtraRays())
+            }
           }
+          sampleCount = loopCount;
           
           // Divide the sum by the AO sample count.
           ambientOcclusion.diffuseAccumulator /= sampleCount;
           ambientOcclusion.specularAccumulator /= sampleCount;
+          
+          // Blend with the AO samples from previous frames.
+          if (renderArgs.temporalSampleLimit > 0) {
+            \(reuseHistory())
+          }
+          
+          // Accumulate the AO across frames of a static scene.
+          if (renderArgs.convergenceThreshold > 0) {
+            \(accumulateAO())
+          }
         }
         
         // Prepare the Blinn-Phong lighting.
@@ -338,7 +653,7 @@ struct RenderShader {
       }
       
       // Write the pixel to the screen.
-      \(writeColor())
+      \(writeColor(alpha: isOffline ? "convergenceError" : "0"))
     }
     """
   }
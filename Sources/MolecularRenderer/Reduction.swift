@@ -24,6 +24,22 @@ struct Reduction {
     #endif
   }
   
+  static func waveReadLaneFirst(_ input: String) -> String {
+    #if os(macOS)
+    "simd_broadcast_first(\(input))"
+    #else
+    "WaveReadLaneFirst(\(input))"
+    #endif
+  }
+  
+  static func waveActiveSum(_ input: String) -> String {
+    #if os(macOS)
+    "simd_sum(\(input))"
+    #else
+    "WaveActiveSum(\(input))"
+    #endif
+  }
+  
   static func waveIsFirstLane() -> String {
     #if os(macOS)
     "simd_is_first()"
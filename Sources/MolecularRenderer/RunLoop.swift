@@ -126,6 +126,9 @@ extension RunLoop {
     application.frameID += 1
     application.clock.increment(
       frameStatistics: outputTime.pointee)
+    application.telemetry.integrate(
+      clockFrames: application.clock.frames,
+      frameID: application.frameID)
     
     // There is a bug where CVDisplayLink doesn't register transitions to an
     // external display. We detect this bug by first
@@ -168,7 +171,11 @@ extension RunLoop {
     }
     
     // Invoke the user-supplied closure.
-    self.closure()
+    application.telemetry.measure(
+      stage: .closure, frameID: application.frameID
+    ) {
+      self.closure()
+    }
     
     return kCVReturnSuccess
   }
@@ -202,9 +209,16 @@ extension RunLoop {
     // Synchronize and update the clock.
     waitOnObject()
     updateClock()
+    application.telemetry.integrate(
+      clockFrames: application.clock.frames,
+      frameID: application.frameID)
     
     // Invoke the user-supplied closure.
-    self.closure()
+    application.telemetry.measure(
+      stage: .closure, frameID: application.frameID
+    ) {
+      self.closure()
+    }
   }
   #endif
 }
@@ -1,3 +1,4 @@
+import MolecularRendererCPU
 #if os(macOS)
 import Metal
 #else
@@ -48,6 +49,10 @@ class Shader {
           let threadsPerGroup = descriptor.threadsPerGroup else {
       fatalError("Descriptor was incomplete.")
     }
+    let traceStartTime = TraceRecorder.startTime()
+    defer {
+      TraceRecorder.record("compile \(name)", startTime: traceStartTime)
+    }
     
     #if os(macOS)
     // Create the library.
@@ -0,0 +1,69 @@
+// Log-linear histogram of latencies in microseconds, in the style of
+// HdrHistogram. Values below 128 have exact bins. Every power of 2 above
+// that is split into 64 bins, bounding the relative error to 1.6%.
+//
+// Recording is O(1) and allocation-free, so the histogram can run on every
+// frame without affecting the frame time.
+struct LatencyHistogram {
+  private static var subBucketCount: Int { 64 }
+  private static var maximumShift: Int { 40 }
+  static var binCount: Int { 128 + maximumShift * subBucketCount }
+  
+  private(set) var counts: [Int]
+  private(set) var sampleCount: Int = .zero
+  private(set) var sum: Int = .zero
+  private(set) var minimum: Int = .max
+  private(set) var maximum: Int = .min
+  
+  init() {
+    counts = [Int](repeating: .zero, count: Self.binCount)
+  }
+  
+  static func binID(value: Int) -> Int {
+    guard value >= 128 else {
+      return max(value, 0)
+    }
+    let mostSignificantBit = Int.bitWidth - value.leadingZeroBitCount - 1
+    let shift = min(mostSignificantBit - 6, maximumShift)
+    let mantissa = min(value >> shift, 2 * subBucketCount - 1)
+    return 128 + (shift - 1) * subBucketCount + (mantissa - subBucketCount)
+  }
+  
+  // The largest value that maps to the bin.
+  static func upperBound(binID: Int) -> Int {
+    guard binID >= 128 else {
+      return binID
+    }
+    let shift = (binID - 128) / subBucketCount + 1
+    let mantissa = (binID - 128) % subBucketCount + subBucketCount
+    return ((mantissa + 1) << shift) - 1
+  }
+  
+  mutating func record(_ value: Int) {
+    counts[Self.binID(value: value)] += 1
+    sampleCount += 1
+    sum += value
+    minimum = Swift.min(minimum, value)
+    maximum = Swift.max(maximum, value)
+  }
+  
+  // Nearest-rank percentile, reported as the upper bound of the bin. Never
+  // exceeds the largest recorded value.
+  func percentile(_ fraction: Double) -> Int? {
+    guard sampleCount > 0 else {
+      return nil
+    }
+    var rank = Int((fraction * Double(sampleCount)).rounded(.up))
+    rank = Swift.max(1, Swift.min(rank, sampleCount))
+    
+    var cumulativeCount = 0
+    for binID in counts.indices {
+      cumulativeCount += counts[binID]
+      if cumulativeCount >= rank {
+        let value = Self.upperBound(binID: binID)
+        return Swift.min(Swift.max(value, minimum), maximum)
+      }
+    }
+    return maximum
+  }
+}
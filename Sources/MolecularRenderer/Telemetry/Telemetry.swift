@@ -0,0 +1,203 @@
+import Dispatch
+import MolecularRendererCPU
+
+/// A stage of the frame, with its own latency histogram.
+public enum TelemetryStage: String, CaseIterable {
+  // GPU stages, measured with timestamps. They lag the CPU by 3 frames.
+  case update
+  case render
+  case forget
+  case upscale
+  
+  // CPU stages, measured with the host clock.
+  case registerChanges
+  case upload
+  case closure
+  case present
+  
+  /// Whether the latency was measured on the GPU timeline.
+  public var isGPU: Bool {
+    switch self {
+    case .update, .render, .forget, .upscale:
+      return true
+    default:
+      return false
+    }
+  }
+}
+
+/// Latency statistics for one stage, in microseconds.
+public struct LatencySummary {
+  public var sampleCount: Int = .zero
+  public var mean: Double = .zero
+  public var minimum: Int = .zero
+  public var p50: Int = .zero
+  public var p95: Int = .zero
+  public var p99: Int = .zero
+  public var maximum: Int = .zero
+}
+
+/// Per-stage latency histograms, and the number of frames the display
+/// refreshed without a new image.
+///
+/// The first frames are skipped, as their latencies are not representative
+/// while the scene is still loading.
+public class Telemetry {
+  /// Number of frames to skip before recording samples.
+  public var warmupFrameCount: Int = 60
+  
+  private let queue = DispatchQueue(label: "Telemetry.queue")
+  private var histograms: [LatencyHistogram]
+  private var _droppedFrameCount: Int = .zero
+  private var previousClockFrames: Int?
+  
+  init() {
+    let stageCount = TelemetryStage.allCases.count
+    histograms = Array(repeating: LatencyHistogram(), count: stageCount)
+  }
+  
+  private static func index(stage: TelemetryStage) -> Int {
+    TelemetryStage.allCases.firstIndex(of: stage)!
+  }
+  
+  // Records a latency in microseconds.
+  func record(_ latency: Int, stage: TelemetryStage, frameID: Int) {
+    guard frameID > warmupFrameCount else {
+      return
+    }
+    let index = Self.index(stage: stage)
+    queue.sync {
+      histograms[index].record(latency)
+    }
+  }
+  
+  // Host time in nanoseconds, for CPU stages.
+  static var currentTime: UInt64 {
+    DispatchTime.now().uptimeNanoseconds
+  }
+  
+  // Records the time elapsed since the start of a CPU stage.
+  func record(startTime: UInt64, stage: TelemetryStage, frameID: Int) {
+    let latency = Int(Self.currentTime - startTime) / 1000
+    record(latency, stage: stage, frameID: frameID)
+  }
+  
+  // Records the latency of a CPU-side closure.
+  func measure<T>(
+    stage: TelemetryStage,
+    frameID: Int,
+    _ closure: () -> T
+  ) -> T {
+    let startTime = Self.currentTime
+    let traceStartTime = TraceRecorder.startTime()
+    let output = closure()
+    record(startTime: startTime, stage: stage, frameID: frameID)
+    TraceRecorder.record(stage.rawValue, startTime: traceStartTime)
+    return output
+  }
+  
+  // The clock normally advances by 1 frame per callback. Larger jumps mean
+  // the display refreshed without a new frame.
+  func integrate(clockFrames: Int, frameID: Int) {
+    defer {
+      previousClockFrames = clockFrames
+    }
+    guard frameID > warmupFrameCount,
+          let previousClockFrames else {
+      return
+    }
+    let skippedFrames = clockFrames - previousClockFrames - 1
+    if skippedFrames > 0 {
+      queue.sync {
+        _droppedFrameCount += skippedFrames
+      }
+    }
+  }
+}
+
+extension Telemetry {
+  /// The number of display refreshes that repeated the previous image.
+  public var droppedFrameCount: Int {
+    queue.sync {
+      _droppedFrameCount
+    }
+  }
+  
+  /// The latency statistics of a stage, or nil if it has no samples.
+  public func summary(stage: TelemetryStage) -> LatencySummary? {
+    let index = Self.index(stage: stage)
+    let histogram = queue.sync {
+      histograms[index]
+    }
+    guard histogram.sampleCount > 0 else {
+      return nil
+    }
+    
+    var output = LatencySummary()
+    output.sampleCount = histogram.sampleCount
+    output.mean = Double(histogram.sum) / Double(histogram.sampleCount)
+    output.minimum = histogram.minimum
+    output.p50 = histogram.percentile(0.50)!
+    output.p95 = histogram.percentile(0.95)!
+    output.p99 = histogram.percentile(0.99)!
+    output.maximum = histogram.maximum
+    return output
+  }
+  
+  /// Discard every sample, for example after changing the scene.
+  public func reset() {
+    queue.sync {
+      for index in histograms.indices {
+        histograms[index] = LatencyHistogram()
+      }
+      _droppedFrameCount = .zero
+    }
+  }
+  
+  /// One row per stage with samples. Latencies are in microseconds.
+  public func exportCSV() -> String {
+    var output = "stage,timeline,samples,mean,min,p50,p95,p99,max\n"
+    for stage in TelemetryStage.allCases {
+      guard let summary = summary(stage: stage) else {
+        continue
+      }
+      let timeline = stage.isGPU ? "gpu" : "cpu"
+      let mean = (summary.mean * 10).rounded() / 10
+      output += "\(stage.rawValue),\(timeline),\(summary.sampleCount),"
+      output += "\(mean),\(summary.minimum),\(summary.p50),"
+      output += "\(summary.p95),\(summary.p99),\(summary.maximum)\n"
+    }
+    return output
+  }
+  
+  /// The same statistics as the CSV, plus the dropped frame count.
+  public func exportJSON() -> String {
+    var stageEntries: [String] = []
+    for stage in TelemetryStage.allCases {
+      guard let summary = summary(stage: stage) else {
+        continue
+      }
+      let timeline = stage.isGPU ? "gpu" : "cpu"
+      let mean = (summary.mean * 10).rounded() / 10
+      var entry = "    \"\(stage.rawValue)\": {"
+      entry += "\"timeline\": \"\(timeline)\", "
+      entry += "\"samples\": \(summary.sampleCount), "
+      entry += "\"mean\": \(mean), "
+      entry += "\"min\": \(summary.minimum), "
+      entry += "\"p50\": \(summary.p50), "
+      entry += "\"p95\": \(summary.p95), "
+      entry += "\"p99\": \(summary.p99), "
+      entry += "\"max\": \(summary.maximum)}"
+      stageEntries.append(entry)
+    }
+    
+    var output = "{\n"
+    output += "  \"unit\": \"microseconds\",\n"
+    output += "  \"droppedFrames\": \(droppedFrameCount),\n"
+    output += "  \"stages\": {\n"
+    output += stageEntries.joined(separator: ",\n")
+    output += "\n  }\n"
+    output += "}\n"
+    return output
+  }
+}
@@ -0,0 +1,37 @@
+import MolecularRendererCPU
+
+extension TransactionBenchmark {
+  /// Also measure 'upload(transaction:)'. The upload writes into the real
+  /// transaction buffers of the device, but nothing is dispatched to update
+  /// the BVH.
+  public convenience init(
+    descriptor: TransactionBenchmarkDescriptor,
+    device: Device
+  ) {
+    self.init(descriptor: descriptor)
+    
+    // The upload only touches the transaction buffers, whose size does not
+    // depend on the address space.
+    var bvhBuilderDesc = BVHBuilderDescriptor()
+    bvhBuilderDesc.addressSpaceSize = descriptor.baseline.addressSpaceSize
+    bvhBuilderDesc.device = device
+    bvhBuilderDesc.voxelAllocationSize = 100_000_000
+    bvhBuilderDesc.worldDimension = 64
+    let bvhBuilder = BVHBuilder(descriptor: bvhBuilderDesc)
+    
+    maxChangedCount = AtomResources.maxTransactionSize
+    upload = { transaction, threadCount in
+      let startTime = TraceRecorder.currentTime
+      device.commandQueue.withCommandList { commandList in
+        bvhBuilder.upload(
+          transaction: transaction,
+          commandList: commandList,
+          inFlightFrameID: 0,
+          threadCount: threadCount)
+      }
+      let endTime = TraceRecorder.currentTime
+      device.commandQueue.flush()
+      return endTime - startTime
+    }
+  }
+}
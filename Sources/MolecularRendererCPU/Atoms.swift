@@ -0,0 +1,670 @@
+import Dispatch
+
+public class Atoms {
+  /// The user specifies a desired limit to address space size in the
+  /// application descriptor, to put an upper bound on its memory allocation
+  /// size. However, the actual size will be slightly smaller. Users should
+  /// either give some generous wiggle room to the address space size, or
+  /// check the exact value from 'application.atoms.addressSpaceSize'.
+  public let addressSpaceSize: Int
+  
+  // Number of addresses per modification mark, and maximum number of atoms
+  // per task in 'registerChanges()'. Only the microbenchmarks change the
+  // defaults.
+  package let blockSize: Int
+  package let taskSize: Int
+  
+  // Maximum number of threads for 'registerChanges()'. Nil uses every worker
+  // in the pool.
+  package var threadCount: Int?
+  
+  private let positions: UnsafeMutablePointer<SIMD4<Float>>
+  private let previousOccupied: UnsafeMutablePointer<Bool>
+  private let occupied: UnsafeMutablePointer<Bool>
+  private let positionsModified: UnsafeMutablePointer<Bool>
+  private let blocksModified: UnsafeMutablePointer<Bool>
+  private let allocations: [PageAllocation]
+  
+  // Set when another process writes the atoms, through 'SharedAtomWriter'.
+  let sharedRegion: SharedAtomRegion?
+  
+  // Set while a worker thread owns the atoms, during a pipelined
+  // transaction. Only the thread that calls 'render()' reads or writes it.
+  private var lendingGroup: DispatchGroup?
+  
+  package init(
+    addressSpaceSize originalAddressSpaceSize: Int,
+    blockSize: Int = 512,
+    taskSize: Int = 50_000,
+    prefaultsMemory: Bool = false,
+    usesLargePages: Bool = false,
+    sharedMemoryName: String? = nil
+  ) {
+    guard blockSize > 0, taskSize >= blockSize else {
+      fatalError("Task size must be at least the block size.")
+    }
+    self.blockSize = blockSize
+    self.taskSize = taskSize
+    
+    addressSpaceSize = Self.createReducedAddressSpaceSize(
+      original: originalAddressSpaceSize, blockSize: blockSize)
+    guard addressSpaceSize % blockSize == 0 else {
+      fatalError("Address space size was not divisible by block size.")
+    }
+    guard addressSpaceSize > 0 else {
+      fatalError("Address space size was zero.")
+    }
+    
+    // Pages arrive zero-filled, which reads as 'false' for every flag. The
+    // positions are only read where 'occupied' is set.
+    //
+    // Prefaulting splits each array into the tasks 'registerChanges()' uses
+    // when every block is modified.
+    let blockCount = addressSpaceSize / blockSize
+    let prefaultTaskSize = Atoms.createTaskSize(
+      modifiedBlockCount: blockCount,
+      blockSize: blockSize,
+      taskSize: taskSize,
+      threadCount: nil)
+    var prefaultTaskCount = blockCount + prefaultTaskSize - 1
+    prefaultTaskCount /= prefaultTaskSize
+    var allocations: [PageAllocation] = []
+    func allocate<T>(_: T.Type, capacity: Int) -> UnsafeMutablePointer<T> {
+      let allocation = PageAllocation(
+        size: capacity * MemoryLayout<T>.stride,
+        requestsLargePages: usesLargePages)
+      if prefaultsMemory {
+        // One element per atom, or one per block for 'blocksModified'.
+        let elementsPerBlock = capacity / blockCount
+        let elementsPerTask = prefaultTaskSize * elementsPerBlock
+        allocation.prefault(
+          taskSize: elementsPerTask * MemoryLayout<T>.stride,
+          taskCount: prefaultTaskCount)
+      }
+      allocations.append(allocation)
+      return allocation.pointer.bindMemory(to: T.self, capacity: capacity)
+    }
+    self.previousOccupied = allocate(Bool.self, capacity: addressSpaceSize)
+    
+    // Everything the other process writes lives in the shared region.
+    // 'previousOccupied' is only touched by 'registerChanges()'.
+    if let sharedMemoryName {
+      let sharedRegion = SharedAtomRegion(
+        creating: sharedMemoryName,
+        addressSpaceSize: addressSpaceSize,
+        blockSize: blockSize)
+      self.positions = sharedRegion.positions
+      self.occupied = sharedRegion.occupied
+      self.positionsModified = sharedRegion.positionsModified
+      self.blocksModified = sharedRegion.blocksModified
+      self.sharedRegion = sharedRegion
+    } else {
+      self.positions = allocate(SIMD4<Float>.self, capacity: addressSpaceSize)
+      self.occupied = allocate(Bool.self, capacity: addressSpaceSize)
+      self.positionsModified = allocate(Bool.self, capacity: addressSpaceSize)
+      self.blocksModified = allocate(Bool.self, capacity: blockCount)
+      self.sharedRegion = nil
+    }
+    self.allocations = allocations
+  }
+  
+  deinit {
+    for allocation in allocations {
+      allocation.deallocate()
+    }
+  }
+  
+  static func createReducedAddressSpaceSize(
+    original: Int,
+    blockSize: Int
+  ) -> Int {
+    var output = original / blockSize
+    output *= blockSize
+    return output
+  }
+  
+  // This ergonomic Swift API is not the CPU-side bottleneck! Very well done.
+  public subscript(index: Int) -> SIMD4<Float>? {
+    get {
+      reclaim()
+      if occupied[index] {
+        return positions[index]
+      } else {
+        return nil
+      }
+    }
+    set {
+      reclaim()
+      guard sharedRegion == nil else {
+        fatalError("Atoms are written by another process.")
+      }
+      blocksModified[index / blockSize] = true
+      positionsModified[index] = true
+      
+      if let newValue {
+        occupied[index] = true
+        positions[index] = newValue
+      } else {
+        occupied[index] = false
+      }
+    }
+  }
+  
+  /// The last generation registered from a 'SharedAtomWriter'. Nil unless
+  /// the application descriptor set a shared memory name.
+  public var sharedGeneration: UInt64? {
+    sharedRegion?.readerGeneration.load(ordering: .relaxed)
+  }
+  
+  // Hands the atoms to a worker thread, which registers the changes for the
+  // next frame. Any access from the user stalls until the closure returns.
+  package func lend(
+    queue: DispatchQueue,
+    _ closure: @escaping @Sendable () -> Void
+  ) {
+    guard lendingGroup == nil else {
+      fatalError("Atoms were already lent to a worker thread.")
+    }
+    let group = DispatchGroup()
+    queue.async(group: group, execute: closure)
+    lendingGroup = group
+  }
+  
+  // Stalls until the worker thread returns the atoms.
+  package func reclaim() {
+    guard let lendingGroup else {
+      return
+    }
+    lendingGroup.wait()
+    self.lendingGroup = nil
+  }
+  
+  // Writes positions into a contiguous range of addresses, skipping the ones
+  // that did not change. Tasks are aligned to blocks, so no two threads share
+  // a modification mark.
+  package func update(
+    positions: UnsafeBufferPointer<SIMD4<Float>>,
+    startAddress: Int
+  ) {
+    reclaim()
+    guard sharedRegion == nil else {
+      fatalError("Atoms are written by another process.")
+    }
+    let endAddress = startAddress + positions.count
+    guard startAddress >= 0, endAddress <= addressSpaceSize else {
+      fatalError("Positions exceeded the address space.")
+    }
+    
+    let blockSize = self.blockSize
+    let startBlockID = startAddress / blockSize
+    let endBlockID = (endAddress + blockSize - 1) / blockSize
+    let blocksPerTask = max(taskSize / blockSize, 1)
+    var taskCount = endBlockID - startBlockID + blocksPerTask - 1
+    taskCount /= blocksPerTask
+    
+    nonisolated(unsafe)
+    let safePositions = self.positions
+    nonisolated(unsafe)
+    let safeOccupied = self.occupied
+    nonisolated(unsafe)
+    let safePositionsModified = self.positionsModified
+    nonisolated(unsafe)
+    let safeBlocksModified = self.blocksModified
+    WorkerPool.shared.perform(
+      iterations: taskCount, maxWorkerCount: threadCount
+    ) { taskID in
+      let taskStartBlockID = startBlockID + taskID * blocksPerTask
+      let taskEndBlockID = taskStartBlockID + blocksPerTask
+      let start = max(taskStartBlockID * blockSize, startAddress)
+      let end = min(taskEndBlockID * blockSize, endAddress)
+      for atomID in start..<end {
+        let position = positions[atomID - startAddress]
+        if safeOccupied[atomID], safePositions[atomID] == position {
+          continue
+        }
+        safeOccupied[atomID] = true
+        safePositions[atomID] = position
+        safePositionsModified[atomID] = true
+        safeBlocksModified[atomID / blockSize] = true
+      }
+    }
+  }
+  
+  // Changes to the acceleration structure in a single frame.
+  package class Transaction {
+    package var removedCount: UInt32 = .zero
+    package var addedCount: UInt32 = .zero
+    package var movedCount: UInt32 = .zero
+    
+    package var removedIDs: UnsafeMutablePointer<UInt32>
+    package var movedIDs: UnsafeMutablePointer<UInt32>
+    package var movedPositions: UnsafeMutablePointer<SIMD4<Float>>
+    package var addedIDs: UnsafeMutablePointer<UInt32>
+    package var addedPositions: UnsafeMutablePointer<SIMD4<Float>>
+    
+    package init(maxAtomCount: Int) {
+      removedIDs = .allocate(capacity: maxAtomCount)
+      movedIDs = .allocate(capacity: maxAtomCount)
+      movedPositions = .allocate(capacity: maxAtomCount)
+      addedIDs = .allocate(capacity: maxAtomCount)
+      addedPositions = .allocate(capacity: maxAtomCount)
+    }
+    
+    deinit {
+      removedIDs.deallocate()
+      movedIDs.deallocate()
+      movedPositions.deallocate()
+      addedIDs.deallocate()
+      addedPositions.deallocate()
+    }
+  }
+  
+  // Originally, this function caused the majority of the CPU-side latency.
+  // In the rotating beam benchmark, its contribution was 42%. If the rendering
+  // cost is zero, CPU-side latency/atom/frame would be the bottleneck holding
+  // back the entire application's performance.
+  //
+  // Therefore, I spent an extra day (Oct 16 2025) during the acceleration
+  // structure PR, addressing this problem. I optimized the latency of
+  // 'registerChanges()' and 'upload(transaction:)' with multicore CPU
+  // parallelism. Here are the results of the development time invested.
+  
+  //                      | macOS | Windows
+  // -------------------- | ----: | ----: |
+  // before optimizations | 42.1% | 36.6% |
+  //  after optimizations | 18.2% | 29.7% |
+  //
+  // 'registerChanges()' as percent of CPU-side latency. The macOS system
+  // should benefit more from this optimization, as it has more CPU cores.
+  
+  // macOS system:
+  // - M1 Max (10-core CPU, 32-core GPU)
+  // - 120 Hz display
+  // - original latency estimate: 9.25 nm/atom
+  //   - limited to 0.901M atoms/frame @ 120 Hz
+  //   - GPU time at this atom count: 1.52 ms / 8.33 ms
+  // - optimized latency estimate: 5.39 ns/atom
+  //   - limited to 1.546M atoms/frame @ 120 Hz
+  //   - GPU time at this atom count: 2.61 ms / 8.33 ms
+  //
+  // Windows system:
+  // - Intel Core i5-4460 (4-core), GTX 970 (13-core)
+  // - 60 Hz display
+  // - original latency estimate: 21.16 ns/atom
+  //   - limited to 0.788M atoms/frame @ 60 Hz
+  //   - GPU time at this atom count: 5.78 ms / 16.67 ms
+  // - optimized latency estimate: 17.47 ns/atom
+  //   - limited to 0.954M atoms/frame @ 60 Hz
+  //   - GPU time at this atom count: 6.99 ms / 16.67 ms
+  //
+  // Real-world performance can probably come very close to the limits stated
+  // above. While the GPU is occupied with a second demanding task besides
+  // updating the BVH, the CPU is not.
+  //
+  // On macOS, I ran a test of actual performance with an empty render kernel.
+  // The Metal Performance HUD showed the 120 FPS target could be sustained at
+  // up to beamDepth = 57, or 0.934M atoms/frame. The lower bound to the time
+  // reported for the GPU timeline was 3.39 ms. The GPU time is not reliable
+  // because the GPU was underclocking. Powermetrics showed 77% duty cycle at
+  // the 389 MHz mode and 0% for the other modes, up to 1296 MHz. Power
+  // consumption was 2.05 W, but the maximum power I've ever recorded for this
+  // chip is 52 W.
+  //
+  // In conclusion, the optimization boosted the practical achievable atom
+  // count from ~500,000 to ~800,000 on the macOS system.
+  
+  // The tables below were measured by hand. To measure the register and
+  // upload latencies on another machine, and sweep the block size, task size,
+  // and thread count, run 'swift run -c release Benchmark --transactions'.
+  // 'BenchmarkCPU --transactions' measures the register latency alone, and
+  // also runs on Linux.
+  
+  // 0.1M atoms/frame
+  //
+  // | CPU-side contributor | macOS   | Windows |
+  // | -------------------- | ------: | ------: |
+  // |                      | ns/atom | ns/atom |
+  // | rotate animation     |    2.60 |    5.80 |
+  // | API usage            |    1.43 |    4.24 |
+  // | register transaction |    2.58 |    7.89 |
+  // | memcpy to GPU buffer |    0.38 |    1.68 |
+  // | total                |    6.99 |   19.61 |
+  //
+  // | GPU-side contributor | macOS   | Windows |
+  // | -------------------- | ------: | ------: |
+  // |                      | ns/atom | ns/atom |
+  // | PCIe transfer        |    0.00 |    1.61 |
+  // | update BVH           |    2.75 |    7.08 |
+  // | total (concurrent)   |    2.75 |    7.08 |
+  
+  // 1M atoms/frame
+  //
+  // | CPU-side contributor | macOS   | Windows |
+  // | -------------------- | ------: | ------: |
+  // |                      | ns/atom | ns/atom |
+  // | rotate animation     |    2.51 |    5.65 |
+  // | API usage            |    1.60 |    4.57 |
+  // | register transaction |    0.98 |    5.19 |
+  // | memcpy to GPU buffer |    0.30 |    2.06 |
+  // | total                |    5.39 |   17.47 |
+  //
+  // | GPU-side contributor | macOS   | Windows |
+  // | -------------------- | ------: | ------: |
+  // |                      | ns/atom | ns/atom |
+  // | PCIe transfer        |    0.00 |    1.59 |
+  // | update BVH           |    1.69 |    7.33 |
+  // | total (concurrent)   |    1.69 |    7.33 |
+  
+  // 100M address space size
+  //
+  // | Block Size | macOS     | Windows   |
+  // | ---------- | --------: | --------: |
+  // |            | s/address | s/address |
+  // | 256        |  1.30E-12 |  1.86E-12 |
+  // | 512        |  6.50E-13 |  9.90E-13 |
+  // | 1024       |  3.30E-13 |  5.50E-13 |
+  //
+  // | Block Size | macOS     | Windows   |
+  // | ---------- | --------: | --------: |
+  // |            | ms        | ms        |
+  // | 256        |     0.130 |     0.186 |
+  // | 512        |     0.065 |     0.099 |
+  // | 1024       |     0.033 |     0.055 |
+  
+  // GPU is reaching 78-80% PCIe utilization, with PCIe 3 x16 = 15.76 GB/s.
+  // That means 1.61 ns/atom (0.1M atoms), 1.59 ns/atom (1M atoms) on the GPU
+  // timeline.
+  //
+  // In performance calculations, assume "PCIe transfer" and "update BVH"
+  // happen concurrently on the GPU timeline.
+  // Aim for 4 tasks per worker, so idle workers have something to steal.
+  // Small transactions still spread across every core, while large ones
+  // are capped at 'taskSize' atoms per task. Measured in blocks, not atoms.
+  static func createTaskSize(
+    modifiedBlockCount: Int,
+    blockSize: Int,
+    taskSize: Int,
+    threadCount: Int?
+  ) -> Int {
+    let workerCount = min(
+      WorkerPool.shared.workerCount, threadCount ?? .max)
+    let maxTaskSize = max(taskSize / blockSize, 1)
+    let minTaskSize = min(max(4096 / blockSize, 1), maxTaskSize)
+    var output = (modifiedBlockCount + 4 * workerCount - 1)
+    output /= 4 * workerCount
+    output = max(minTaskSize, min(output, maxTaskSize))
+    return output
+  }
+  
+  package func registerChanges() -> [Transaction] {
+    // The other process owns the arrays, until it publishes a generation.
+    var sharedGeneration: UInt64?
+    if let sharedRegion {
+      sharedGeneration = sharedRegion.publishedGeneration()
+      guard sharedGeneration != nil else {
+        return []
+      }
+    }
+    defer {
+      if let sharedRegion, let sharedGeneration {
+        sharedRegion.acknowledge(generation: sharedGeneration)
+      }
+    }
+    
+    func createModifiedBlockIDs() -> [UInt32] {
+      var modifiedBlockIDs: [UInt32] = []
+      for blockID in 0..<(addressSpaceSize / blockSize) {
+        // Reset blocksModified
+        guard blocksModified[blockID] else {
+          continue
+        }
+        blocksModified[blockID] = false
+        
+        modifiedBlockIDs.append(UInt32(blockID))
+      }
+      return modifiedBlockIDs
+    }
+    let modifiedBlockIDs = createModifiedBlockIDs()
+    
+    let blockSize = self.blockSize
+    let taskSize = Self.createTaskSize(
+      modifiedBlockCount: modifiedBlockIDs.count,
+      blockSize: blockSize,
+      taskSize: self.taskSize,
+      threadCount: threadCount)
+    let taskCount = (modifiedBlockIDs.count + taskSize - 1) / taskSize
+    
+    func createChunks() -> [Transaction] {
+      var output: [Transaction] = []
+      for taskID in 0..<taskCount {
+        let start = taskID * taskSize
+        let end = min(start + taskSize, modifiedBlockIDs.count)
+        
+        let chunk = Transaction(maxAtomCount: (end - start) * blockSize)
+        output.append(chunk)
+      }
+      return output
+    }
+    nonisolated(unsafe)
+    let output = createChunks()
+    
+    nonisolated(unsafe)
+    let safePositionsModified = self.positionsModified
+    nonisolated(unsafe)
+    let safePreviousOccupied = self.previousOccupied
+    nonisolated(unsafe)
+    let safeOccupied = self.occupied
+    nonisolated(unsafe)
+    let safePositions = self.positions
+    WorkerPool.shared.perform(
+      iterations: taskCount, maxWorkerCount: threadCount
+    ) { taskID in
+      let traceStartTime = TraceRecorder.startTime()
+      let chunk = output[taskID]
+      
+      let start = taskID * taskSize
+      let end = min(start + taskSize, modifiedBlockIDs.count)
+      for i in start..<end {
+        let blockID = modifiedBlockIDs[i]
+        
+        let startAtomID = blockID * UInt32(blockSize)
+        let endAtomID = startAtomID + UInt32(blockSize)
+        for atomID in startAtomID..<endAtomID {
+          // Reset positionsModified
+          guard safePositionsModified[Int(atomID)] else {
+            continue
+          }
+          safePositionsModified[Int(atomID)] = false
+          
+          // Read occupied
+          let atomPreviousOccupied = safePreviousOccupied[Int(atomID)]
+          let atomOccupied = safeOccupied[Int(atomID)]
+          
+          // Save changes to previousOccupied
+          safePreviousOccupied[Int(atomID)] = atomOccupied
+          
+          if !atomOccupied {
+            if atomPreviousOccupied {
+              chunk.removedIDs[Int(chunk.removedCount)] = atomID
+              chunk.removedCount += 1
+            }
+          } else {
+            // Read positions
+            let position = safePositions[Int(atomID)]
+            
+            if atomPreviousOccupied {
+              chunk.movedIDs[Int(chunk.movedCount)] = atomID
+              chunk.movedPositions[Int(chunk.movedCount)] = position
+              chunk.movedCount += 1
+            } else {
+              chunk.addedIDs[Int(chunk.addedCount)] = atomID
+              chunk.addedPositions[Int(chunk.addedCount)] = position
+              chunk.addedCount += 1
+            }
+          }
+        }
+      }
+      TraceRecorder.record("registerChanges chunk", startTime: traceStartTime)
+    }
+    
+    return output
+  }
+}
+
+extension Atoms {
+  // Spread the lower 21 bits of the input, leaving two zeroes between each
+  // pair of bits.
+  private static func spreadBits(_ input: UInt64) -> UInt64 {
+    var x = input & 0x1F_FFFF
+    x = (x | (x << 32)) & 0x1F_0000_0000_FFFF
+    x = (x | (x << 16)) & 0x1F_0000_FF00_00FF
+    x = (x | (x << 8)) & 0x100F_00F0_0F00_F00F
+    x = (x | (x << 4)) & 0x10C3_0C30_C30C_30C3
+    x = (x | (x << 2)) & 0x1249_2492_4924_9249
+    return x
+  }
+  
+  // Sorts the occupied addresses along a Morton curve through their current
+  // positions. Returns the new address of every old address.
+  //
+  // Occupied atoms are packed to the front of the address space, in curve
+  // order. The remaining addresses follow in increasing order, so the output
+  // is a bijection. Atoms pending removal keep a valid address, and are
+  // removed from there during the next transaction.
+  package func createMortonPermutation() -> [UInt32] {
+    reclaim()
+    var occupiedIDs: [UInt32] = []
+    var boxMin = SIMD3<Float>(repeating: .greatestFiniteMagnitude)
+    var boxMax = SIMD3<Float>(repeating: -.greatestFiniteMagnitude)
+    for atomID in 0..<addressSpaceSize where occupied[atomID] {
+      let position = positions[atomID]
+      let xyz = SIMD3(position.x, position.y, position.z)
+      boxMin.replace(with: xyz, where: xyz .< boxMin)
+      boxMax.replace(with: xyz, where: xyz .> boxMax)
+      occupiedIDs.append(UInt32(atomID))
+    }
+    
+    // Quantize the positions to 21 bits per axis, within the bounding box.
+    var keys = [SIMD2<UInt64>](repeating: .zero, count: occupiedIDs.count)
+    if occupiedIDs.count > 0 {
+      let extent = max((boxMax - boxMin).max(), .leastNormalMagnitude)
+      let maxCoord = Float((1 << 21) - 1)
+      let scale = maxCoord / extent
+      
+      nonisolated(unsafe)
+      let safePositions = self.positions
+      let taskSize = self.taskSize
+      let taskCount = (occupiedIDs.count + taskSize - 1) / taskSize
+      keys.withUnsafeMutableBufferPointer { bufferPointer in
+        nonisolated(unsafe)
+        let safeKeys = bufferPointer
+        WorkerPool.shared.perform(
+          iterations: taskCount, maxWorkerCount: threadCount
+        ) { taskID in
+          let start = taskID * taskSize
+          let end = min(start + taskSize, occupiedIDs.count)
+          for i in start..<end {
+            let atomID = occupiedIDs[i]
+            let position = safePositions[Int(atomID)]
+            var xyz = SIMD3(position.x, position.y, position.z)
+            xyz = (xyz - boxMin) * scale
+            xyz.replace(with: 0, where: .!(xyz .>= 0))
+            xyz.replace(with: maxCoord, where: xyz .> maxCoord)
+            
+            let coords = SIMD3<UInt64>(xyz.rounded(.down))
+            var code = Self.spreadBits(coords.x)
+            code |= Self.spreadBits(coords.y) << 1
+            code |= Self.spreadBits(coords.z) << 2
+            safeKeys[i] = SIMD2(code, UInt64(atomID))
+          }
+        }
+      }
+    }
+    
+    // Sort by Morton code, breaking ties with the original address.
+    keys.sort { lhs, rhs in
+      if lhs[0] != rhs[0] {
+        return lhs[0] < rhs[0]
+      } else {
+        return lhs[1] < rhs[1]
+      }
+    }
+    
+    var output = [UInt32](repeating: .max, count: addressSpaceSize)
+    for newID in keys.indices {
+      let oldID = Int(keys[newID][1])
+      output[oldID] = UInt32(newID)
+    }
+    var nextID = UInt32(keys.count)
+    for oldID in 0..<addressSpaceSize where output[oldID] == .max {
+      output[oldID] = nextID
+      nextID += 1
+    }
+    return output
+  }
+  
+  // Moves every piece of per-address state to its new address. The GPU side
+  // of the address space must be permuted in the same way, before the next
+  // transaction is registered.
+  package func permute(_ permutation: [UInt32]) {
+    reclaim()
+    guard permutation.count == addressSpaceSize else {
+      fatalError("Permutation did not match the address space size.")
+    }
+    
+    // Every task writes a disjoint set of new addresses, because the
+    // permutation is a bijection.
+    let taskSize = self.taskSize
+    let taskCount = (addressSpaceSize + taskSize - 1) / taskSize
+    func scatter<T>(_ pointer: UnsafeMutablePointer<T>) {
+      let copy = UnsafeMutablePointer<T>.allocate(capacity: addressSpaceSize)
+      defer { copy.deallocate() }
+      copy.update(from: pointer, count: addressSpaceSize)
+      
+      nonisolated(unsafe)
+      let safePointer = pointer
+      nonisolated(unsafe)
+      let safeCopy = copy
+      WorkerPool.shared.perform(
+        iterations: taskCount, maxWorkerCount: threadCount
+      ) { taskID in
+        let start = taskID * taskSize
+        let end = min(start + taskSize, addressSpaceSize)
+        for oldID in start..<end {
+          let newID = Int(permutation[oldID])
+          safePointer[newID] = safeCopy[oldID]
+        }
+      }
+    }
+    scatter(positions)
+    scatter(previousOccupied)
+    scatter(occupied)
+    scatter(positionsModified)
+    
+    // Pending edits now live in different blocks.
+    let blockSize = self.blockSize
+    let blockCount = addressSpaceSize / blockSize
+    let blocksPerTask = max(taskSize / blockSize, 1)
+    let blockTaskCount = (blockCount + blocksPerTask - 1) / blocksPerTask
+    nonisolated(unsafe)
+    let safePositionsModified = self.positionsModified
+    nonisolated(unsafe)
+    let safeBlocksModified = self.blocksModified
+    WorkerPool.shared.perform(
+      iterations: blockTaskCount, maxWorkerCount: threadCount
+    ) { taskID in
+      let startBlockID = taskID * blocksPerTask
+      let endBlockID = min(startBlockID + blocksPerTask, blockCount)
+      for blockID in startBlockID..<endBlockID {
+        let start = blockID * blockSize
+        let end = start + blockSize
+        var modified = false
+        for atomID in start..<end where safePositionsModified[atomID] {
+          modified = true
+          break
+        }
+        safeBlocksModified[blockID] = modified
+      }
+    }
+  }
+}
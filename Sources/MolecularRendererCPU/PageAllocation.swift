@@ -0,0 +1,221 @@
+#if os(macOS)
+import Darwin
+#elseif os(Linux)
+import Glibc
+#else
+import WinSDK
+#endif
+
+// Virtual memory for the per-address arrays of 'Atoms'. The OS hands out
+// pages that are already zero, and only backs each page with physical memory
+// the first time it is written. Large address spaces start without a serial
+// initialization pass, and untouched ranges take no physical memory.
+//
+// On Windows, the whole allocation still counts against the commit limit
+// from the start. Reserving the range and committing it on demand would
+// need every write to the arrays to check whether its page is committed.
+struct PageAllocation {
+  let pointer: UnsafeMutableRawPointer
+  let size: Int
+  
+  // Whether the OS granted large pages.
+  let usesLargePages: Bool
+  
+  init(size: Int, requestsLargePages: Bool) {
+    guard size > 0 else {
+      fatalError("Allocation size was zero.")
+    }
+    
+    if requestsLargePages,
+       let largePageSize = Self.largePageSize {
+      // Large pages must tile the allocation exactly.
+      var largeSize = size + largePageSize - 1
+      largeSize /= largePageSize
+      largeSize *= largePageSize
+      
+      if let pointer = Self.allocateLargePages(size: largeSize) {
+        self.pointer = pointer
+        self.size = largeSize
+        self.usesLargePages = true
+        return
+      }
+    }
+    
+    self.pointer = Self.allocateRegularPages(size: size)
+    self.size = size
+    self.usesLargePages = false
+  }
+  
+  func deallocate() {
+    #if os(Windows)
+    VirtualFree(pointer, 0, DWORD(MEM_RELEASE))
+    #else
+    munmap(pointer, size)
+    #endif
+  }
+  
+  // Writes zero to every page, in parallel across the worker pool. Moves the
+  // page faults from the first frames to startup.
+  //
+  // Task 'i' covers the bytes starting at 'i * taskSize', and the last task
+  // covers the rest of the allocation. The tasks are not stolen, so each
+  // worker touches the range it is first assigned in 'registerChanges()'.
+  // With several NUMA nodes, first-touch placement puts those pages on the
+  // worker's node. The placement only holds while the worker stays on that
+  // node, which 'pinsWorkerThreads' ensures on Windows.
+  func prefault(taskSize: Int, taskCount: Int) {
+    guard taskSize > 0, taskCount > 0 else {
+      fatalError("Prefault tasks were empty.")
+    }
+    
+    nonisolated(unsafe)
+    let safePointer = pointer
+    let size = self.size
+    WorkerPool.shared.perform(
+      iterations: taskCount, stealsWork: false
+    ) { taskID in
+      let start = min(taskID * taskSize, size)
+      var end = min(start + taskSize, size)
+      if taskID == taskCount - 1 {
+        end = size
+      }
+      (safePointer + start).initializeMemory(
+        as: UInt8.self, repeating: 0, count: end - start)
+    }
+  }
+}
+
+extension PageAllocation {
+  // Nil if the platform has no large pages for user memory.
+  private static var largePageSize: Int? {
+    #if os(macOS)
+    #if arch(x86_64)
+    return 2 * 1024 * 1024
+    #else
+    // Apple silicon already uses 16 KB pages, and has no superpages.
+    return nil
+    #endif
+    #elseif os(Linux)
+    // Only the CPU benchmarks run on Linux. Transparent huge pages are left
+    // to the kernel.
+    return nil
+    #else
+    let output = Int(GetLargePageMinimum())
+    return output > 0 ? output : nil
+    #endif
+  }
+  
+  private static func allocateRegularPages(
+    size: Int
+  ) -> UnsafeMutableRawPointer {
+    #if os(macOS) || os(Linux)
+    let pointer = mmap(
+      nil, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0)
+    guard let pointer, pointer != MAP_FAILED else {
+      fatalError("Could not allocate \(size) bytes.")
+    }
+    return pointer
+    #else
+    // Committed pages are zero-filled on demand, so physical memory is still
+    // assigned lazily. The commit charge is not.
+    let pointer = VirtualAlloc(
+      nil,
+      SIZE_T(size),
+      DWORD(MEM_RESERVE | MEM_COMMIT),
+      DWORD(PAGE_READWRITE))
+    guard let pointer else {
+      fatalError("Could not allocate \(size) bytes.")
+    }
+    return pointer
+    #endif
+  }
+  
+  // Returns nil if the OS refused, for example because the memory is too
+  // fragmented, or the process lacks the privilege.
+  private static func allocateLargePages(
+    size: Int
+  ) -> UnsafeMutableRawPointer? {
+    #if os(macOS)
+    // VM_FLAGS_SUPERPAGE_SIZE_2MB, passed in place of the file descriptor.
+    // The macro does not import into Swift.
+    let superpageFlags: Int32 = 2 << 16
+    let pointer = mmap(
+      nil, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON,
+      superpageFlags, 0)
+    guard let pointer, pointer != MAP_FAILED else {
+      print(
+        "[PageAllocation] Could not allocate \(size) bytes of superpages. " +
+        "Falling back to regular pages.")
+      return nil
+    }
+    return pointer
+    #elseif os(Windows)
+    // Large pages are committed and locked immediately. The account needs
+    // the "Lock pages in memory" right, and the process must enable it.
+    guard hasLockMemoryPrivilege else {
+      return nil
+    }
+    let pointer = VirtualAlloc(
+      nil,
+      SIZE_T(size),
+      DWORD(MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES),
+      DWORD(PAGE_READWRITE))
+    guard let pointer else {
+      print(
+        "[PageAllocation] Could not allocate \(size) bytes of large pages " +
+        "(error \(GetLastError())). Falling back to regular pages.")
+      return nil
+    }
+    return pointer
+    #else
+    return nil
+    #endif
+  }
+  
+  #if os(Windows)
+  // Enabled once per process. The fallback is reported once, rather than for
+  // every array.
+  private static let hasLockMemoryPrivilege: Bool = {
+    let output = enableLockMemoryPrivilege()
+    if !output {
+      print(
+        "[PageAllocation] SeLockMemoryPrivilege was not granted. " +
+        "Falling back to regular pages.")
+    }
+    return output
+  }()
+  
+  // Enables SeLockMemoryPrivilege in the token of the process. Returns false
+  // if the account was never assigned the right.
+  private static func enableLockMemoryPrivilege() -> Bool {
+    var token: HANDLE?
+    guard OpenProcessToken(
+      GetCurrentProcess(),
+      DWORD(TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY),
+      &token).boolValue,
+      let token else {
+      return false
+    }
+    defer { CloseHandle(token) }
+    
+    var privileges = TOKEN_PRIVILEGES()
+    privileges.PrivilegeCount = 1
+    privileges.Privileges.Attributes = DWORD(SE_PRIVILEGE_ENABLED)
+    let foundPrivilege = "SeLockMemoryPrivilege"
+      .withCString(encodedAs: UTF16.self) { name in
+        LookupPrivilegeValueW(nil, name, &privileges.Privileges.Luid)
+      }
+    guard foundPrivilege.boolValue else {
+      return false
+    }
+    
+    // Succeeds even when the privilege was not assigned. In that case, it
+    // reports ERROR_NOT_ALL_ASSIGNED.
+    guard AdjustTokenPrivileges(
+      token, false, &privileges, 0, nil, nil).boolValue else {
+      return false
+    }
+    return GetLastError() == DWORD(ERROR_SUCCESS)
+  }
+  #endif
+}
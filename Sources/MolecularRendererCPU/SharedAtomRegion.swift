@@ -0,0 +1,306 @@
+import Atomics
+#if os(macOS) || os(Linux)
+import CSharedMemory
+#endif
+#if os(macOS)
+import Darwin
+#elseif os(Linux)
+import Glibc
+#else
+import WinSDK
+#endif
+
+// Named memory shared with another process, which writes the per-address
+// arrays of 'Atoms' directly. 'registerChanges()' reads them in place, so
+// nothing is serialized between the processes.
+//
+// | offset | contents                                   |
+// | -----: | ------------------------------------------ |
+// |      0 | magic number                               |
+// |      8 | address space size                         |
+// |     16 | block size                                 |
+// |     64 | writer generation (atomic)                 |
+// |    128 | reader generation (atomic)                 |
+// |   4096 | positions, 16 bytes per address            |
+// |    ... | occupied marks, 1 byte per address         |
+// |    ... | modified marks, 1 byte per address         |
+// |    ... | modified block marks, 1 byte per block     |
+//
+// The generations hand the arrays back and forth. The writer only touches
+// them while both generations are equal. After writing, it increments the
+// writer generation. The renderer registers the changes, then copies the
+// writer generation into the reader generation.
+final class SharedAtomRegion: @unchecked Sendable {
+  // "MRATOMS1" in little-endian ASCII.
+  static var magic: UInt64 { 0x3153_4D4F_5441_524D }
+  static var headerSize: Int { 4096 }
+  
+  let name: String
+  let isCreator: Bool
+  let pointer: UnsafeMutableRawPointer
+  let size: Int
+  let addressSpaceSize: Int
+  let blockSize: Int
+  
+  let writerGeneration: UnsafeAtomic<UInt64>
+  let readerGeneration: UnsafeAtomic<UInt64>
+  
+  #if os(Windows)
+  let mappingHandle: HANDLE
+  #endif
+  
+  // Renderer side. Creates the region, zero-filled.
+  init(creating name: String, addressSpaceSize: Int, blockSize: Int) {
+    let size = Self.regionSize(
+      addressSpaceSize: addressSpaceSize, blockSize: blockSize)
+    
+    #if os(macOS) || os(Linux)
+    // Remove a region left behind by a renderer that crashed. Its size
+    // cannot change after the first 'ftruncate'.
+    let path = Self.path(name: name)
+    shm_unlink(path)
+    let fileDescriptor = shared_memory_open(
+      path, O_CREAT | O_EXCL | O_RDWR, 0o600)
+    guard fileDescriptor >= 0 else {
+      fatalError("Could not create shared memory '\(name)'.")
+    }
+    defer { close(fileDescriptor) }
+    guard ftruncate(fileDescriptor, off_t(size)) == 0,
+          let pointer = Self.map(
+            fileDescriptor: fileDescriptor, size: size) else {
+      shm_unlink(path)
+      fatalError("Could not allocate shared memory '\(name)'.")
+    }
+    self.pointer = pointer
+    #else
+    let mappingHandle = Self.path(name: name).withCString(
+      encodedAs: UTF16.self
+    ) { pathPointer in
+      CreateFileMappingW(
+        HANDLE(bitPattern: -1),
+        nil,
+        DWORD(PAGE_READWRITE),
+        DWORD(UInt64(size) >> 32),
+        DWORD(UInt64(size) & 0xFFFF_FFFF),
+        pathPointer)
+    }
+    guard let mappingHandle else {
+      fatalError("Could not create shared memory '\(name)'.")
+    }
+    
+    // The region is destroyed with its last handle.
+    guard let pointer = Self.map(
+      mappingHandle: mappingHandle, size: size) else {
+      CloseHandle(mappingHandle)
+      fatalError("Could not map shared memory '\(name)'.")
+    }
+    self.mappingHandle = mappingHandle
+    self.pointer = pointer
+    #endif
+    
+    self.name = name
+    self.isCreator = true
+    self.size = size
+    self.addressSpaceSize = addressSpaceSize
+    self.blockSize = blockSize
+    self.writerGeneration = Self.atomic(pointer: pointer, offset: 64)
+    self.readerGeneration = Self.atomic(pointer: pointer, offset: 128)
+    
+    // Publish the header last, so a writer never sees a partial one.
+    let header = pointer.assumingMemoryBound(to: UInt64.self)
+    header[1] = UInt64(addressSpaceSize)
+    header[2] = UInt64(blockSize)
+    writerGeneration.store(0, ordering: .relaxed)
+    readerGeneration.store(0, ordering: .relaxed)
+    Self.atomic(pointer: pointer, offset: 0)
+      .store(Self.magic, ordering: .releasing)
+  }
+  
+  // Writer side. Opens a region created by the renderer.
+  init(opening name: String) {
+    #if os(macOS) || os(Linux)
+    let fileDescriptor = shared_memory_open(Self.path(name: name), O_RDWR, 0)
+    guard fileDescriptor >= 0 else {
+      fatalError("Could not open shared memory '\(name)'.")
+    }
+    defer { close(fileDescriptor) }
+    var fileStatus = stat()
+    guard fstat(fileDescriptor, &fileStatus) == 0 else {
+      fatalError("Could not query shared memory '\(name)'.")
+    }
+    let size = Int(fileStatus.st_size)
+    guard let pointer = Self.map(
+      fileDescriptor: fileDescriptor, size: size) else {
+      fatalError("Could not map shared memory '\(name)'.")
+    }
+    self.pointer = pointer
+    #else
+    let mappingHandle = Self.path(name: name).withCString(
+      encodedAs: UTF16.self
+    ) { pathPointer in
+      OpenFileMappingW(DWORD(FILE_MAP_ALL_ACCESS), false, pathPointer)
+    }
+    guard let mappingHandle else {
+      fatalError("Could not open shared memory '\(name)'.")
+    }
+    self.mappingHandle = mappingHandle
+    
+    // Zero maps the entire region.
+    guard let pointer = Self.map(
+      mappingHandle: mappingHandle, size: 0) else {
+      fatalError("Could not map shared memory '\(name)'.")
+    }
+    self.pointer = pointer
+    var memoryInfo = MEMORY_BASIC_INFORMATION()
+    VirtualQuery(
+      pointer, &memoryInfo, SIZE_T(MemoryLayout.size(ofValue: memoryInfo)))
+    let size = Int(memoryInfo.RegionSize)
+    #endif
+    
+    let magic = Self.atomic(pointer: pointer, offset: 0)
+      .load(ordering: .acquiring)
+    guard magic == Self.magic else {
+      fatalError("Shared memory '\(name)' was not an atom region.")
+    }
+    
+    self.name = name
+    self.isCreator = false
+    self.size = size
+    let header = pointer.assumingMemoryBound(to: UInt64.self)
+    self.addressSpaceSize = Int(header[1])
+    self.blockSize = Int(header[2])
+    self.writerGeneration = Self.atomic(pointer: pointer, offset: 64)
+    self.readerGeneration = Self.atomic(pointer: pointer, offset: 128)
+    
+    let expectedSize = Self.regionSize(
+      addressSpaceSize: addressSpaceSize, blockSize: blockSize)
+    guard size >= expectedSize else {
+      fatalError("Shared memory '\(name)' was too small.")
+    }
+  }
+  
+  deinit {
+    #if os(macOS) || os(Linux)
+    munmap(pointer, size)
+    if isCreator {
+      shm_unlink(Self.path(name: name))
+    }
+    #else
+    UnmapViewOfFile(pointer)
+    CloseHandle(mappingHandle)
+    #endif
+  }
+}
+
+extension SharedAtomRegion {
+  // POSIX shared memory on macOS and Linux, which is not backed by a file,
+  // so the pages are never written back to disk. macOS limits the names to
+  // 31 bytes, including the leading slash.
+  private static func path(name: String) -> String {
+    #if os(macOS) || os(Linux)
+    guard name.utf8.count < 31 else {
+      fatalError("Shared memory name '\(name)' was too long.")
+    }
+    return "/\(name)"
+    #else
+    return "Local\\\(name)"
+    #endif
+  }
+  
+  #if os(macOS) || os(Linux)
+  private static func map(
+    fileDescriptor: Int32,
+    size: Int
+  ) -> UnsafeMutableRawPointer? {
+    let pointer = mmap(
+      nil, size, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0)
+    guard let pointer, pointer != MAP_FAILED else {
+      return nil
+    }
+    return pointer
+  }
+  #else
+  private static func map(
+    mappingHandle: HANDLE,
+    size: Int
+  ) -> UnsafeMutableRawPointer? {
+    MapViewOfFile(
+      mappingHandle, DWORD(FILE_MAP_ALL_ACCESS), 0, 0, SIZE_T(size))
+  }
+  #endif
+  
+  private static func atomic(
+    pointer: UnsafeMutableRawPointer,
+    offset: Int
+  ) -> UnsafeAtomic<UInt64> {
+    let storage = (pointer + offset)
+      .assumingMemoryBound(to: UnsafeAtomic<UInt64>.Storage.self)
+    return UnsafeAtomic(at: storage)
+  }
+}
+
+extension SharedAtomRegion {
+  // Byte offsets of the arrays. Each starts on a 64-byte boundary.
+  struct Offsets {
+    var positions: Int = .zero
+    var occupied: Int = .zero
+    var positionsModified: Int = .zero
+    var blocksModified: Int = .zero
+    var end: Int = .zero
+  }
+  
+  static func offsets(addressSpaceSize: Int, blockSize: Int) -> Offsets {
+    func align(_ offset: Int) -> Int {
+      (offset + 63) / 64 * 64
+    }
+    
+    var output = Offsets()
+    output.positions = headerSize
+    output.occupied = align(output.positions + addressSpaceSize * 16)
+    output.positionsModified = align(output.occupied + addressSpaceSize)
+    output.blocksModified = align(output.positionsModified + addressSpaceSize)
+    output.end = align(output.blocksModified + addressSpaceSize / blockSize)
+    return output
+  }
+  
+  static func regionSize(addressSpaceSize: Int, blockSize: Int) -> Int {
+    offsets(addressSpaceSize: addressSpaceSize, blockSize: blockSize).end
+  }
+  
+  var offsets: Offsets {
+    Self.offsets(addressSpaceSize: addressSpaceSize, blockSize: blockSize)
+  }
+  
+  var positions: UnsafeMutablePointer<SIMD4<Float>> {
+    (pointer + offsets.positions)
+      .bindMemory(to: SIMD4<Float>.self, capacity: addressSpaceSize)
+  }
+  
+  var occupied: UnsafeMutablePointer<Bool> {
+    (pointer + offsets.occupied)
+      .bindMemory(to: Bool.self, capacity: addressSpaceSize)
+  }
+  
+  var positionsModified: UnsafeMutablePointer<Bool> {
+    (pointer + offsets.positionsModified)
+      .bindMemory(to: Bool.self, capacity: addressSpaceSize)
+  }
+  
+  var blocksModified: UnsafeMutablePointer<Bool> {
+    (pointer + offsets.blocksModified)
+      .bindMemory(to: Bool.self, capacity: addressSpaceSize / blockSize)
+  }
+  
+  // Renderer side. Returns the generation to register, or nil if the writer
+  // has not published since the last one.
+  func publishedGeneration() -> UInt64? {
+    let published = writerGeneration.load(ordering: .acquiring)
+    let registered = readerGeneration.load(ordering: .relaxed)
+    return published > registered ? published : nil
+  }
+  
+  // Renderer side. Hands the arrays back to the writer.
+  func acknowledge(generation: UInt64) {
+    readerGeneration.store(generation, ordering: .releasing)
+  }
+}
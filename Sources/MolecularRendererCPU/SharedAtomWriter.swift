@@ -0,0 +1,91 @@
+import class Foundation.Thread
+
+/// Writes atoms into the shared memory of a renderer in another process.
+///
+/// The renderer creates the region, by setting
+/// 'ApplicationDescriptor.sharedMemoryName'. Open it with the same name after
+/// the application has been created. The writer and the renderer take turns
+/// owning the atoms: call 'waitUntilWritable()', write any number of atoms,
+/// then 'publish()'. The changes appear in the next frame that calls
+/// 'render()'.
+///
+/// Only links the renderer for the region layout. It does not need a device.
+public final class SharedAtomWriter {
+  private let region: SharedAtomRegion
+  private let positions: UnsafeMutablePointer<SIMD4<Float>>
+  private let occupied: UnsafeMutablePointer<Bool>
+  private let positionsModified: UnsafeMutablePointer<Bool>
+  private let blocksModified: UnsafeMutablePointer<Bool>
+  private var ownsAtoms: Bool = false
+  
+  /// Matches 'application.atoms.addressSpaceSize' in the renderer.
+  public var addressSpaceSize: Int {
+    region.addressSpaceSize
+  }
+  
+  /// Number of times this region was published, by any writer.
+  public var generation: UInt64 {
+    region.writerGeneration.load(ordering: .relaxed)
+  }
+  
+  public init(name: String) {
+    self.region = SharedAtomRegion(opening: name)
+    self.positions = region.positions
+    self.occupied = region.occupied
+    self.positionsModified = region.positionsModified
+    self.blocksModified = region.blocksModified
+  }
+  
+  /// Whether the renderer has registered the last published changes, so the
+  /// atoms may be written again. Does not stall.
+  public var isWritable: Bool {
+    if ownsAtoms {
+      return true
+    }
+    let published = region.writerGeneration.load(ordering: .relaxed)
+    let registered = region.readerGeneration.load(ordering: .acquiring)
+    ownsAtoms = published == registered
+    return ownsAtoms
+  }
+  
+  /// Stall until the renderer has registered the last published changes.
+  public func waitUntilWritable() {
+    while !isWritable {
+      Thread.sleep(forTimeInterval: 100e-6)
+    }
+  }
+  
+  /// Same semantics as 'Atoms'. Writing requires ownership of the atoms.
+  public subscript(index: Int) -> SIMD4<Float>? {
+    get {
+      if occupied[index] {
+        return positions[index]
+      } else {
+        return nil
+      }
+    }
+    set {
+      guard ownsAtoms else {
+        fatalError("Call 'waitUntilWritable()' before writing atoms.")
+      }
+      blocksModified[index / region.blockSize] = true
+      positionsModified[index] = true
+      
+      if let newValue {
+        occupied[index] = true
+        positions[index] = newValue
+      } else {
+        occupied[index] = false
+      }
+    }
+  }
+  
+  /// Hand the atoms to the renderer.
+  public func publish() {
+    guard ownsAtoms else {
+      fatalError("Call 'waitUntilWritable()' before publishing.")
+    }
+    ownsAtoms = false
+    region.writerGeneration.wrappingIncrement(ordering: .releasing)
+  }
+}
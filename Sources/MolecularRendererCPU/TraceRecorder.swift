@@ -0,0 +1,253 @@
+import Dispatch
+import Foundation
+#if os(Windows)
+import WinSDK
+#endif
+
+/// Records spans of CPU and GPU work in the Chrome trace event format. Open
+/// the exported JSON in Perfetto (ui.perfetto.dev) or chrome://tracing.
+///
+/// Every thread writes into its own ring buffer, which keeps the most recent
+/// spans. The GPU stages share the host clock with the CPU spans, so both
+/// appear on the same timeline.
+public enum TraceRecorder {
+  /// Whether spans are recorded. Disabled by default, where the only cost is
+  /// checking this flag.
+  nonisolated(unsafe)
+  public static var isEnabled: Bool = false
+  
+  /// Maximum number of spans kept for each thread.
+  public static var capacity: Int { 65536 }
+  
+  // Thread 0 is the GPU timeline.
+  nonisolated(unsafe)
+  private static let registryLock = NSLock()
+  nonisolated(unsafe)
+  private static var buffers: [TraceBuffer] = []
+  nonisolated(unsafe)
+  private static let gpuBuffer = TraceBuffer(threadID: 0, threadName: "GPU")
+  
+  private static var threadDictionaryKey: String { "TraceRecorder.buffer" }
+}
+
+struct TraceEvent {
+  var name: String
+  var startTime: UInt64
+  var endTime: UInt64
+}
+
+final class TraceBuffer {
+  let threadID: Int
+  let threadName: String
+  private let lock = NSLock()
+  private var events: [TraceEvent] = []
+  private var nextIndex: Int = .zero
+  
+  init(threadID: Int, threadName: String) {
+    self.threadID = threadID
+    self.threadName = threadName
+  }
+  
+  func append(_ event: TraceEvent) {
+    lock.lock()
+    if events.count < TraceRecorder.capacity {
+      events.append(event)
+    } else {
+      events[nextIndex] = event
+      nextIndex = (nextIndex + 1) % TraceRecorder.capacity
+    }
+    lock.unlock()
+  }
+  
+  func snapshot() -> [TraceEvent] {
+    lock.lock()
+    let output = Array(events[nextIndex...] + events[..<nextIndex])
+    lock.unlock()
+    return output
+  }
+  
+  func removeAll() {
+    lock.lock()
+    events.removeAll()
+    nextIndex = .zero
+    lock.unlock()
+  }
+}
+
+// MARK: - Recording
+
+extension TraceRecorder {
+  // Host time in nanoseconds. On Windows, this is the performance counter,
+  // which the GPU timestamps are calibrated against.
+  package static var currentTime: UInt64 {
+    #if os(Windows)
+    var counter = LARGE_INTEGER()
+    QueryPerformanceCounter(&counter)
+    return hostTime(performanceCounter: UInt64(counter.QuadPart))
+    #else
+    return DispatchTime.now().uptimeNanoseconds
+    #endif
+  }
+  
+  #if os(Windows)
+  package static func hostTime(performanceCounter: UInt64) -> UInt64 {
+    var frequency = LARGE_INTEGER()
+    QueryPerformanceFrequency(&frequency)
+    let seconds = Double(performanceCounter) / Double(frequency.QuadPart)
+    return UInt64(seconds * 1e9)
+  }
+  #endif
+  
+  // Returns zero while disabled, so the matching 'record' does nothing.
+  package static func startTime() -> UInt64 {
+    guard isEnabled else {
+      return 0
+    }
+    return currentTime
+  }
+  
+  // Records a span on the calling thread, from 'startTime' until now. The
+  // name is only built when tracing is enabled.
+  package static func record(
+    _ name: @autoclosure () -> String,
+    startTime: UInt64
+  ) {
+    guard isEnabled, startTime > 0 else {
+      return
+    }
+    let event = TraceEvent(
+      name: name(), startTime: startTime, endTime: currentTime)
+    currentBuffer().append(event)
+  }
+  
+  package static func span<T>(
+    _ name: @autoclosure () -> String,
+    _ closure: () -> T
+  ) -> T {
+    let startTime = startTime()
+    let output = closure()
+    record(name(), startTime: startTime)
+    return output
+  }
+  
+  // Records a span on the GPU timeline, in host nanoseconds.
+  package static func recordGPU(
+    _ name: String,
+    startTime: UInt64,
+    endTime: UInt64
+  ) {
+    guard isEnabled, endTime > startTime else {
+      return
+    }
+    let event = TraceEvent(
+      name: name, startTime: startTime, endTime: endTime)
+    gpuBuffer.append(event)
+  }
+  
+  #if os(macOS)
+  // Metal reports GPU times in seconds, on the same host clock as
+  // 'DispatchTime'.
+  package static func recordGPU(
+    _ name: String,
+    startSeconds: Double,
+    endSeconds: Double
+  ) {
+    recordGPU(
+      name,
+      startTime: UInt64(startSeconds * 1e9),
+      endTime: UInt64(endSeconds * 1e9))
+  }
+  #endif
+  
+  private static func currentBuffer() -> TraceBuffer {
+    let threadDictionary = Thread.current.threadDictionary
+    if let buffer = threadDictionary[threadDictionaryKey] as? TraceBuffer {
+      return buffer
+    }
+    
+    registryLock.lock()
+    let threadID = buffers.count + 1
+    var threadName = Thread.current.name ?? ""
+    if Thread.isMainThread {
+      threadName = "Main"
+    } else if threadName.isEmpty {
+      threadName = "Thread \(threadID)"
+    }
+    let buffer = TraceBuffer(threadID: threadID, threadName: threadName)
+    buffers.append(buffer)
+    registryLock.unlock()
+    
+    threadDictionary[threadDictionaryKey] = buffer
+    return buffer
+  }
+}
+
+// MARK: - Export
+
+extension TraceRecorder {
+  /// Discard every recorded span.
+  public static func reset() {
+    registryLock.lock()
+    let allBuffers = buffers + [gpuBuffer]
+    registryLock.unlock()
+    
+    for buffer in allBuffers {
+      buffer.removeAll()
+    }
+  }
+  
+  /// Serialize the recorded spans as Chrome trace event JSON. Times are in
+  /// microseconds, relative to the earliest span.
+  public static func exportJSON() -> String {
+    registryLock.lock()
+    let allBuffers = [gpuBuffer] + buffers
+    registryLock.unlock()
+    
+    let snapshots = allBuffers.map { $0.snapshot() }
+    var originTime = UInt64.max
+    for snapshot in snapshots {
+      for event in snapshot {
+        originTime = min(originTime, event.startTime)
+      }
+    }
+    
+    func escape(_ string: String) -> String {
+      var output = ""
+      for character in string {
+        switch character {
+        case "\"": output += "\\\""
+        case "\\": output += "\\\\"
+        default: output.append(character)
+        }
+      }
+      return output
+    }
+    func microseconds(_ nanoseconds: UInt64) -> String {
+      let value = Double(nanoseconds) / 1000
+      return String(format: "%.3f", value)
+    }
+    
+    var entries: [String] = []
+    for (buffer, snapshot) in zip(allBuffers, snapshots) {
+      var metadata = "{\"name\": \"thread_name\", \"ph\": \"M\", "
+      metadata += "\"pid\": 1, \"tid\": \(buffer.threadID), "
+      metadata += "\"args\": {\"name\": \"\(escape(buffer.threadName))\"}}"
+      entries.append(metadata)
+      
+      for event in snapshot {
+        let start = event.startTime - originTime
+        let duration = event.endTime - event.startTime
+        var entry = "{\"name\": \"\(escape(event.name))\", \"ph\": \"X\", "
+        entry += "\"ts\": \(microseconds(start)), "
+        entry += "\"dur\": \(microseconds(duration)), "
+        entry += "\"pid\": 1, \"tid\": \(buffer.threadID)}"
+        entries.append(entry)
+      }
+    }
+    
+    var output = "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n"
+    output += entries.joined(separator: ",\n")
+    output += "\n]}\n"
+    return output
+  }
+}
@@ -0,0 +1,271 @@
+import Dispatch
+
+/// How the changed atoms are split between the three kinds of edits.
+public enum TransactionMix: CaseIterable {
+  case added
+  case moved
+  case removed
+  
+  /// One third of each kind, interleaved.
+  case mixed
+}
+
+/// Parameters of the transaction microbenchmarks. Each sweep varies one
+/// parameter, while the others keep their baseline values.
+public struct TransactionBenchmarkDescriptor {
+  public var addressSpaceSizes: [Int] = [1_000_000, 4_000_000, 16_000_000]
+  public var changedFractions: [Float] = [0.01, 0.1, 0.5]
+  public var mixes: [TransactionMix] = TransactionMix.allCases
+  public var blockSizes: [Int] = [256, 512, 1024, 2048]
+  public var taskSizes: [Int] = [12_500, 25_000, 50_000, 100_000, 200_000]
+  
+  /// Nil uses every worker in the pool.
+  public var threadCounts: [Int?] = [1, 2, 4, 8, nil]
+  
+  /// The baseline matches the library: 4M addresses, 10% moved, blocks of
+  /// 512 atoms, tasks of at most 50,000 atoms, every worker.
+  public var baseline = TransactionBenchmarkParameters()
+  
+  /// Number of measurements per data point. The median is reported.
+  public var trialCount: Int = 5
+  
+  public init() {
+    
+  }
+}
+
+public struct TransactionBenchmarkParameters {
+  public var addressSpaceSize: Int = 4_000_000
+  public var changedFraction: Float = 0.1
+  public var mix: TransactionMix = .moved
+  public var blockSize: Int = 512
+  public var taskSize: Int = 50_000
+  public var threadCount: Int?
+  
+  public init() {
+    
+  }
+}
+
+// Measures 'registerChanges()' in isolation, on synthetic edits to a
+// contiguous range of addresses. Needs no GPU, so it also runs on Linux.
+// The renderer can attach a device, to measure 'upload(transaction:)' as
+// well. Results are in nanoseconds per changed atom.
+public class TransactionBenchmark {
+  let descriptor: TransactionBenchmarkDescriptor
+  
+  // Set by the renderer. Uploads the transaction, and returns the latency in
+  // nanoseconds.
+  package var upload: (([Atoms.Transaction], Int?) -> UInt64)?
+  
+  // Transactions with more changed atoms are skipped. Limited by the size of
+  // the upload buffers, when measuring the upload.
+  package var maxChangedCount: Int = .max
+  
+  public init(descriptor: TransactionBenchmarkDescriptor) {
+    guard descriptor.trialCount > 0 else {
+      fatalError("Trial count must be at least 1.")
+    }
+    self.descriptor = descriptor
+  }
+  
+  /// Run every sweep, and format the results as Markdown tables.
+  public func run() -> String {
+    var tables: [String] = []
+    func sweep<T>(
+      name: String,
+      values: [T],
+      label: (T) -> String,
+      apply: (inout TransactionBenchmarkParameters, T) -> Void
+    ) {
+      var rows: [(String, Latencies?)] = []
+      for value in values {
+        var parameters = descriptor.baseline
+        apply(&parameters, value)
+        rows.append((label(value), measure(parameters: parameters)))
+      }
+      tables.append(Self.createTable(
+        name: name, rows: rows, includesUpload: upload != nil))
+    }
+    
+    sweep(
+      name: "address space size",
+      values: descriptor.addressSpaceSizes,
+      label: { String($0) },
+      apply: { $0.addressSpaceSize = $1 })
+    sweep(
+      name: "changed fraction",
+      values: descriptor.changedFractions,
+      label: { String($0) },
+      apply: { $0.changedFraction = $1 })
+    sweep(
+      name: "mix",
+      values: descriptor.mixes,
+      label: { String(describing: $0) },
+      apply: { $0.mix = $1 })
+    sweep(
+      name: "block size",
+      values: descriptor.blockSizes,
+      label: { String($0) },
+      apply: { $0.blockSize = $1 })
+    sweep(
+      name: "task size",
+      values: descriptor.taskSizes,
+      label: { String($0) },
+      apply: { $0.taskSize = $1 })
+    sweep(
+      name: "thread count",
+      values: descriptor.threadCounts,
+      label: { $0.map { String($0) } ?? "all" },
+      apply: { $0.threadCount = $1 })
+    
+    return tables.joined(separator: "\n")
+  }
+}
+
+extension TransactionBenchmark {
+  // Median latencies of one data point, in nanoseconds per changed atom.
+  struct Latencies {
+    var registerChanges: Double
+    var upload: Double?
+  }
+  
+  // Returns nil if the transaction exceeds 'maxChangedCount'.
+  func measure(parameters: TransactionBenchmarkParameters) -> Latencies? {
+    guard parameters.taskSize >= parameters.blockSize else {
+      return nil
+    }
+    let atoms = Atoms(
+      addressSpaceSize: parameters.addressSpaceSize,
+      blockSize: parameters.blockSize,
+      taskSize: parameters.taskSize)
+    atoms.threadCount = parameters.threadCount
+    
+    let changedCount = Int(
+      parameters.changedFraction * Float(atoms.addressSpaceSize))
+    guard changedCount > 0,
+          changedCount <= maxChangedCount else {
+      return nil
+    }
+    
+    func kind(atomID: Int) -> TransactionMix {
+      guard parameters.mix == .mixed else {
+        return parameters.mix
+      }
+      switch atomID % 3 {
+      case 0: return .added
+      case 1: return .moved
+      default: return .removed
+      }
+    }
+    func position(atomID: Int, trialID: Int) -> SIMD4<Float> {
+      var output = SIMD4<Float>(
+        Float(atomID % 128),
+        Float(atomID / 128 % 128),
+        Float(atomID / 16384),
+        6)
+      output.x += 0.01 * Float(trialID)
+      return output
+    }
+    
+    var registerSamples: [Double] = []
+    var uploadSamples: [Double] = []
+    for trialID in 0..<descriptor.trialCount {
+      // Restore the state before the edits, without measuring.
+      for atomID in 0..<changedCount {
+        if kind(atomID: atomID) == .added {
+          atoms[atomID] = nil
+        } else {
+          atoms[atomID] = position(atomID: atomID, trialID: 0)
+        }
+      }
+      _ = atoms.registerChanges()
+      
+      for atomID in 0..<changedCount {
+        switch kind(atomID: atomID) {
+        case .removed:
+          atoms[atomID] = nil
+        default:
+          atoms[atomID] = position(atomID: atomID, trialID: trialID + 1)
+        }
+      }
+      
+      let startTime = TraceRecorder.currentTime
+      let transaction = atoms.registerChanges()
+      let endTime = TraceRecorder.currentTime
+      registerSamples.append(Double(endTime - startTime))
+      
+      if let upload {
+        let latency = upload(transaction, parameters.threadCount)
+        uploadSamples.append(Double(latency))
+      }
+    }
+    
+    func median(_ samples: [Double]) -> Double {
+      let sorted = samples.sorted()
+      return sorted[sorted.count / 2] / Double(changedCount)
+    }
+    return Latencies(
+      registerChanges: median(registerSamples),
+      upload: uploadSamples.isEmpty ? nil : median(uploadSamples))
+  }
+  
+  static func createTable(
+    name: String,
+    rows: [(String, Latencies?)],
+    includesUpload: Bool
+  ) -> String {
+    func pad(_ string: String, _ width: Int) -> String {
+      String(repeating: " ", count: max(width - string.count, 0)) + string
+    }
+    func format(_ value: Double) -> String {
+      let rounded = (value * 100).rounded() / 100
+      var output = String(rounded)
+      if let dotIndex = output.firstIndex(of: ".") {
+        let decimals = output.distance(from: dotIndex, to: output.endIndex) - 1
+        output += String(repeating: "0", count: max(2 - decimals, 0))
+      }
+      return output
+    }
+    
+    // Without a device, only the register column is reported.
+    let width = max(name.count, rows.map { $0.0.count }.max() ?? 0)
+    var output = ""
+    output += "| \(pad(name, width)) | register |"
+    if includesUpload {
+      output += " upload  | total   |"
+    }
+    output += "\n"
+    output += "| \(String(repeating: "-", count: width - 1)): | -------: |"
+    if includesUpload {
+      output += " ------: | ------: |"
+    }
+    output += "\n"
+    output += "| \(pad("", width)) | ns/atom  |"
+    if includesUpload {
+      output += " ns/atom | ns/atom |"
+    }
+    output += "\n"
+    
+    for (label, latencies) in rows {
+      output += "| \(pad(label, width)) | "
+      guard let latencies else {
+        output += "\(pad("-", 8)) |"
+        if includesUpload {
+          output += " \(pad("-", 7)) | \(pad("-", 7)) |"
+        }
+        output += "\n"
+        continue
+      }
+      
+      output += "\(pad(format(latencies.registerChanges), 8)) |"
+      if includesUpload, let upload = latencies.upload {
+        let total = latencies.registerChanges + upload
+        output += " \(pad(format(upload), 7)) |"
+        output += " \(pad(format(total), 7)) |"
+      }
+      output += "\n"
+    }
+    return output
+  }
+}
@@ -0,0 +1,235 @@
+import Dispatch
+import Foundation
+#if os(Windows)
+import WinSDK
+#endif
+
+// Persistent threads for the parallel CPU work of the render thread:
+// registering changes, uploading transactions, and reordering atoms. Unlike
+// 'concurrentPerform', the threads stay awake between frames, and the
+// scaling does not depend on how the platform's implementation of GCD
+// spreads the iterations. Callers are serialized, so work from background
+// threads (such as image export) should not use the shared pool.
+//
+// Each participant starts with a contiguous range of iterations. Once its
+// range is empty, it steals half of the remaining range of another
+// participant. The thread that calls 'perform' is participant 0.
+package final class WorkerPool: @unchecked Sendable {
+  package let workerCount: Int
+  let pinsThreads: Bool
+  
+  private let jobLock = NSLock()
+  private let queues: [WorkQueue]
+  private let wakeSemaphores: [DispatchSemaphore]
+  private let completionSemaphore = DispatchSemaphore(value: 0)
+  private var job: Job?
+  private var isShutDown: Bool = false
+  
+  // Replaced by the application descriptor, before the first frame.
+  nonisolated(unsafe)
+  package static var shared = WorkerPool(
+    workerCount: ProcessInfo.processInfo.activeProcessorCount,
+    pinsThreads: false)
+  
+  private static var workerKey: String { "WorkerPool.isWorker" }
+  
+  package init(workerCount: Int, pinsThreads: Bool) {
+    guard workerCount > 0 else {
+      fatalError("Worker count must be at least 1.")
+    }
+    self.workerCount = workerCount
+    self.pinsThreads = pinsThreads
+    self.queues = (0..<workerCount).map { _ in WorkQueue() }
+    self.wakeSemaphores = (0..<workerCount).map { _ in
+      DispatchSemaphore(value: 0)
+    }
+    
+    for workerID in 1..<workerCount {
+      let thread = Thread { [self] in
+        runWorker(workerID: workerID)
+      }
+      thread.name = "WorkerPool \(workerID)"
+      thread.qualityOfService = .userInteractive
+      thread.start()
+    }
+  }
+  
+  // Lets the background threads exit. The pool must not be used afterward.
+  package func shutdown() {
+    jobLock.lock()
+    isShutDown = true
+    for workerID in 1..<workerCount {
+      wakeSemaphores[workerID].signal()
+    }
+    jobLock.unlock()
+  }
+}
+
+extension WorkerPool {
+  // Calls 'work' once for every iteration, and returns once all of them have
+  // finished. 'maxWorkerCount' limits the number of participants. Without
+  // 'stealsWork', every participant only runs its own contiguous range, so
+  // the mapping from iterations to threads is fixed.
+  //
+  // Calls from inside an iteration run serially on the calling thread. Calls
+  // from several threads at once are serialized.
+  package func perform(
+    iterations: Int,
+    maxWorkerCount: Int? = nil,
+    stealsWork: Bool = true,
+    _ work: (Int) -> Void
+  ) {
+    var participantCount = min(workerCount, iterations)
+    if let maxWorkerCount {
+      guard maxWorkerCount > 0 else {
+        fatalError("Worker count must be at least 1.")
+      }
+      participantCount = min(participantCount, maxWorkerCount)
+    }
+    
+    let threadDictionary = Thread.current.threadDictionary
+    if participantCount <= 1 || threadDictionary[Self.workerKey] != nil {
+      for iteration in 0..<iterations {
+        work(iteration)
+      }
+      return
+    }
+    
+    jobLock.lock()
+    defer { jobLock.unlock() }
+    guard !isShutDown else {
+      fatalError("Worker pool was shut down.")
+    }
+    
+    withoutActuallyEscaping(work) { work in
+      for workerID in 0..<participantCount {
+        let start = iterations * workerID / participantCount
+        let end = iterations * (workerID + 1) / participantCount
+        queues[workerID].assign(start..<end)
+      }
+      let job = Job(
+        work: work,
+        participantCount: participantCount,
+        stealsWork: stealsWork)
+      self.job = job
+      for workerID in 1..<participantCount {
+        wakeSemaphores[workerID].signal()
+      }
+      
+      threadDictionary[Self.workerKey] = true
+      execute(workerID: 0, job: job)
+      threadDictionary[Self.workerKey] = nil
+      
+      for _ in 1..<participantCount {
+        completionSemaphore.wait()
+      }
+      self.job = nil
+    }
+  }
+  
+  private func runWorker(workerID: Int) {
+    Thread.current.threadDictionary[Self.workerKey] = true
+    if pinsThreads {
+      Self.pinCurrentThread(coreID: workerID)
+    }
+    
+    while true {
+      wakeSemaphores[workerID].wait()
+      guard !isShutDown, let job else {
+        return
+      }
+      execute(workerID: workerID, job: job)
+      completionSemaphore.signal()
+    }
+  }
+  
+  private func execute(workerID: Int, job: Job) {
+    let queue = queues[workerID]
+    while true {
+      while let iteration = queue.popFront() {
+        job.work(iteration)
+      }
+      guard job.stealsWork else {
+        return
+      }
+      
+      // Search the other participants, starting with the next one.
+      var stolenRange: Range<Int>?
+      for offset in 1..<job.participantCount {
+        let victimID = (workerID + offset) % job.participantCount
+        if let range = queues[victimID].stealHalf() {
+          stolenRange = range
+          break
+        }
+      }
+      guard let stolenRange else {
+        return
+      }
+      queue.assign(stolenRange)
+    }
+  }
+  
+  // The calling thread is not pinned, so core 0 stays free for it. macOS
+  // does not expose thread affinity, so the option is ignored there.
+  private static func pinCurrentThread(coreID: Int) {
+    #if os(Windows)
+    let mask = DWORD_PTR(1) << DWORD_PTR(coreID % DWORD_PTR.bitWidth)
+    SetThreadAffinityMask(GetCurrentThread(), mask)
+    #endif
+  }
+}
+
+extension WorkerPool {
+  private final class Job {
+    let work: (Int) -> Void
+    let participantCount: Int
+    let stealsWork: Bool
+    
+    init(
+      work: @escaping (Int) -> Void,
+      participantCount: Int,
+      stealsWork: Bool
+    ) {
+      self.work = work
+      self.participantCount = participantCount
+      self.stealsWork = stealsWork
+    }
+  }
+  
+  // The remaining iterations of one participant. The owner takes from the
+  // front, while thieves take from the back.
+  private final class WorkQueue {
+    private let lock = NSLock()
+    private var start: Int = .zero
+    private var end: Int = .zero
+    
+    func assign(_ range: Range<Int>) {
+      lock.lock()
+      start = range.lowerBound
+      end = range.upperBound
+      lock.unlock()
+    }
+    
+    func popFront() -> Int? {
+      lock.lock()
+      defer { lock.unlock() }
+      guard start < end else {
+        return nil
+      }
+      start += 1
+      return start - 1
+    }
+    
+    func stealHalf() -> Range<Int>? {
+      lock.lock()
+      defer { lock.unlock() }
+      let remainingCount = end - start
+      guard remainingCount > 0 else {
+        return nil
+      }
+      let stolenCount = (remainingCount + 1) / 2
+      end -= stolenCount
+      return end..<(end + stolenCount)
+    }
+  }
+}